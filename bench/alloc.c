@@ -0,0 +1,119 @@
+#include "bench.h"
+#include <stdc.h>
+#include <alloc.h>
+#include <utf8.h>
+#include <strbuf.h>
+#include <vec.h>
+#include <hash.h>
+
+typedef char* tokval_t;
+#include <parse.h>
+
+enum { NUM_REQUESTS = 20000, TOKENS_PER_REQUEST = 256, ARENA_SIZE = 1 << 20 };
+
+typedef struct {
+    hash_entry_t link;
+    char* name;
+} sym_node_t;
+
+typedef struct {
+    allocator_t* alloc;
+    uint64_t seed;
+} lexer_state_t;
+
+static unsigned int hash_func(const hash_entry_t* entry) {
+    sym_node_t* node = container_of(entry, sym_node_t, link);
+    return hash_bytes(node->name, strlen(node->name));
+}
+
+static int compare_func(const hash_entry_t* entry1, const hash_entry_t* entry2) {
+    sym_node_t* node1 = container_of(entry1, sym_node_t, link);
+    sym_node_t* node2 = container_of(entry2, sym_node_t, link);
+    return strcmp(node1->name, node2->name);
+}
+
+static void delete_func(hash_entry_t* entry) {
+    (void)entry;
+}
+
+/* Produce identifier tokens of 4 to 19 characters built up in a strbuf */
+static void lex_func(void* data, token_t* tok) {
+    lexer_state_t* lex = (lexer_state_t*)data;
+    strbuf_t buf;
+    uint64_t r = bench_rand(&(lex->seed));
+    strbuf_init_alloc(&buf, lex->alloc);
+    for (unsigned int i = 0; i < 4u + (r & 15u); i++)
+        strbuf_add_char(&buf, (char)('a' + ((r >> (4 + i)) % 8)));
+    tok->type  = 1;
+    tok->value = strbuf_finish(&buf);
+}
+
+/* Parse one request's worth of tokens into a vector and a symbol table,
+ * then release everything. A bump allocator is simply reset instead. */
+static void run_request(allocator_t* alloc, bump_alloc_t* bump, uint64_t seed) {
+    lexer_state_t lex = { alloc, seed };
+    parser_t ctx;
+    vec_t names;
+    hash_t symbols;
+    parse_init_alloc(&ctx, lex_func, &lex, alloc);
+    vec_init_alloc(&names, sizeof(char*), alloc);
+    hash_init_alloc(&symbols, hash_func, compare_func, delete_func, 0, alloc);
+    /* Look ahead speculatively, then back up and consume for real */
+    mark(&ctx);
+    peektok(&ctx, TOKENS_PER_REQUEST);
+    release(&ctx);
+    for (size_t i = 0; i < TOKENS_PER_REQUEST; i++) {
+        char* name = peektok(&ctx, 1)->value;
+        vec_push_back(&names, &name);
+        sym_node_t* node = (sym_node_t*)alloc_new(alloc, sizeof(sym_node_t));
+        node->name = name;
+        if (hash_get(&symbols, &(node->link)))
+            alloc_free(alloc, node, sizeof(sym_node_t));
+        else
+            hash_set(&symbols, &(node->link));
+        if (i + 1 < TOKENS_PER_REQUEST)
+            consume(&ctx);
+    }
+    Bench_Sink = hash_size(&symbols);
+    if (bump != NULL) {
+        bump_reset(bump);
+        return;
+    }
+    hash_iter_t iter;
+    hash_foreach(elem, iter, &symbols) {
+        sym_node_t* node = container_of(elem, sym_node_t, link);
+        hash_del(&symbols, elem);
+        alloc_free(alloc, node, sizeof(sym_node_t));
+    }
+    for (size_t i = 0; i < vec_size(&names); i++) {
+        char* name = *(char**)vec_at(&names, i);
+        alloc_free(alloc, name, strlen(name) + 1);
+    }
+    hash_deinit(&symbols);
+    vec_deinit(&names);
+    parse_deinit(&ctx);
+}
+
+BENCH_SUITE(Alloc) {
+    static const char* modes[] = { "libc malloc", "bump allocator (reset per request)", "size-class pool" };
+    printf("  parse workload, %d tokens per request\n", TOKENS_PER_REQUEST);
+    for (int mode = 0; mode < 3; mode++) {
+        bump_alloc_t bump;
+        pool_alloc_t pool;
+        allocator_t* alloc = NULL;
+        void* arena = malloc(ARENA_SIZE);
+        bump_init(&bump, arena, ARENA_SIZE);
+        pool_init(&pool);
+        if (mode == 1)
+            alloc = &(bump.base);
+        else if (mode == 2)
+            alloc = &(pool.base);
+        uint64_t seed = 0x9E3779B97F4A7C15ull;
+        uint64_t start = bench_now();
+        for (size_t i = 0; i < NUM_REQUESTS; i++)
+            run_request(alloc, (mode == 1) ? &bump : NULL, bench_rand(&seed));
+        bench_report(modes[mode], NUM_REQUESTS, bench_now() - start);
+        pool_deinit(&pool);
+        free(arena);
+    }
+}
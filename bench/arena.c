@@ -0,0 +1,62 @@
+#include "bench.h"
+#include <stdc.h>
+#include <arena.h>
+
+enum { NUM_REQUESTS = 2000, STRINGS_PER_REQUEST = 2000 };
+
+static const char* Words[] = {
+    "content-type", "application/json", "accept", "keep-alive", "x-request-id",
+    "user-agent", "cache-control", "no-cache", "authorization", "bearer",
+};
+
+/* Each request builds thousands of short strings, as a handler parsing
+ * headers and formatting a response would */
+static uint64_t run_heap(uint64_t seed) {
+    static char* strs[STRINGS_PER_REQUEST];
+    uintptr_t sink = 0;
+    uint64_t start = bench_now();
+    for (size_t r = 0; r < NUM_REQUESTS; r++) {
+        for (size_t i = 0; i < STRINGS_PER_REQUEST; i++) {
+            uint64_t x = bench_rand(&seed);
+            if (x & 1)
+                strs[i] = estrdup(Words[(x >> 1) % nelem(Words)]);
+            else
+                strs[i] = smprintf("%s: %u", Words[(x >> 1) % nelem(Words)], (unsigned)(x >> 40));
+            sink += (uintptr_t)strs[i][0];
+        }
+        for (size_t i = 0; i < STRINGS_PER_REQUEST; i++)
+            free(strs[i]);
+    }
+    Bench_Sink = sink;
+    return bench_now() - start;
+}
+
+static uint64_t run_arena(arena_t* arena, uint64_t seed) {
+    uintptr_t sink = 0;
+    uint64_t start = bench_now();
+    for (size_t r = 0; r < NUM_REQUESTS; r++) {
+        for (size_t i = 0; i < STRINGS_PER_REQUEST; i++) {
+            uint64_t x = bench_rand(&seed);
+            char* str;
+            if (x & 1)
+                str = arena_strdup(arena, Words[(x >> 1) % nelem(Words)]);
+            else
+                str = arena_smprintf(arena, "%s: %u", Words[(x >> 1) % nelem(Words)], (unsigned)(x >> 40));
+            sink += (uintptr_t)str[0];
+        }
+        arena_reset(arena);
+    }
+    Bench_Sink = sink;
+    return bench_now() - start;
+}
+
+BENCH_SUITE(Arena) {
+    arena_t arena;
+    size_t total = (size_t)NUM_REQUESTS * STRINGS_PER_REQUEST;
+    printf("  %d requests of %d short strings\n", NUM_REQUESTS, STRINGS_PER_REQUEST);
+    bench_report("estrdup/smprintf + free (per string)", total, run_heap(0x9E3779B97F4A7C15ull));
+    arena_init(&arena, 0);
+    bench_report("arena_strdup/arena_smprintf + reset (per string)", total, run_arena(&arena, 0x9E3779B97F4A7C15ull));
+    printf("    high-water mark %zu KiB per request\n", arena_high_water(&arena) / 1024u);
+    arena_deinit(&arena);
+}
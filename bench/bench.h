@@ -0,0 +1,52 @@
+/**
+  @file bench.h
+  @brief Minimal benchmark harness for the Aardvark Library.
+*/
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+typedef void (*bench_suite_t)(void);
+
+/* Sink used to keep the optimizer from discarding benchmarked work */
+extern volatile uintptr_t Bench_Sink;
+
+bool bench_enabled(const char* suite);
+
+/* Return a monotonic timestamp in nanoseconds */
+static inline uint64_t bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+/* Simple xorshift generator so runs are reproducible across platforms */
+static inline uint64_t bench_rand(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return (*state = x);
+}
+
+/* Print a single result line in ns/op and millions of ops per second */
+static inline void bench_report(const char* name, size_t ops, uint64_t ns) {
+    double nsop = (ops ? (double)ns / (double)ops : 0.0);
+    double mops = (ns ? ((double)ops * 1000.0) / (double)ns : 0.0);
+    printf("    %-48s %10.2f ns/op %10.2f Mop/s\n", name, nsop, mops);
+}
+
+#define BENCH_SUITE(name) void name(void)
+
+#define RUN_EXTERN_BENCH_SUITE(name) \
+    do { \
+        extern BENCH_SUITE(name); \
+        if (bench_enabled(#name)) { printf("\n%s\n", #name); name(); } \
+    } while(0)
+
+#endif /* BENCH_H */
@@ -0,0 +1,100 @@
+#include "bench.h"
+#include <stdc.h>
+#include <arena.h>
+#include <bstree.h>
+#include <bptree.h>
+#include <sort.h>
+
+enum { NUM_KEYS = 1 << 21, NUM_LOOKUPS = 1 << 20, NUM_SCANS = 1 << 16, SCAN_LENGTH = 100 };
+
+typedef struct {
+    bstree_node_t node;
+    int64_t key;
+} key_node_t;
+
+static int compare(bstree_node_t* a, bstree_node_t* b) {
+    key_node_t* nodea = container_of(a, key_node_t, node);
+    key_node_t* nodeb = container_of(b, key_node_t, node);
+    return (nodea->key < nodeb->key) ? -1 : (nodea->key > nodeb->key) ? 1 : 0;
+}
+
+static void bench_bstree(int64_t* keys) {
+    key_node_t* nodes = (key_node_t*)emalloc(NUM_KEYS * sizeof(key_node_t));
+    key_node_t probe;
+    bstree_t tree;
+    bstree_init_balanced(&tree, compare, false);
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        nodes[i].key = keys[i];
+        bstree_insert(&tree, &(nodes[i].node));
+    }
+    bench_report("bstree_insert (balanced)", NUM_KEYS, bench_now() - start);
+
+    uint64_t seed = 0x2545F4914F6CDD1Dull;
+    start = bench_now();
+    for (size_t i = 0; i < NUM_LOOKUPS; i++) {
+        probe.key = keys[bench_rand(&seed) % NUM_KEYS];
+        Bench_Sink += (uintptr_t)bstree_lookup(&tree, &(probe.node));
+    }
+    bench_report("bstree_lookup", NUM_LOOKUPS, bench_now() - start);
+
+    start = bench_now();
+    for (size_t i = 0; i < NUM_SCANS; i++) {
+        probe.key = keys[bench_rand(&seed) % NUM_KEYS];
+        bstree_node_t* node = bstree_lookup(&tree, &(probe.node));
+        for (int n = 0; (node != NULL) && (n < SCAN_LENGTH); n++, node = bstree_next(node)) {
+            key_node_t* elem = container_of(node, key_node_t, node);
+            Bench_Sink += (uintptr_t)elem->key;
+        }
+    }
+    bench_report("bstree_lookup + 100 x bstree_next", NUM_SCANS, bench_now() - start);
+    free(nodes);
+}
+
+static void bench_bptree(int64_t* keys, int64_t* sorted) {
+    bptree_t tree;
+    bptree_init_int(&tree);
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < NUM_KEYS; i++)
+        bptree_insert_int(&tree, keys[i], NULL);
+    bench_report("bptree_insert_int", NUM_KEYS, bench_now() - start);
+    bptree_deinit(&tree);
+
+    bptree_init_int(&tree);
+    start = bench_now();
+    bptree_bulk_load_int(&tree, sorted, NULL, NUM_KEYS);
+    bench_report("bptree_bulk_load_int", NUM_KEYS, bench_now() - start);
+
+    uint64_t seed = 0x2545F4914F6CDD1Dull;
+    start = bench_now();
+    for (size_t i = 0; i < NUM_LOOKUPS; i++)
+        Bench_Sink += (uintptr_t)bptree_lookup_int(&tree, keys[bench_rand(&seed) % NUM_KEYS]);
+    bench_report("bptree_lookup_int", NUM_LOOKUPS, bench_now() - start);
+
+    start = bench_now();
+    for (size_t i = 0; i < NUM_SCANS; i++) {
+        bptree_iter_t iter;
+        bptree_seek_int(&tree, keys[bench_rand(&seed) % NUM_KEYS], &iter);
+        for (int n = 0; bptree_iter_valid(&iter) && (n < SCAN_LENGTH); n++, bptree_iter_next(&iter))
+            Bench_Sink += (uintptr_t)bptree_iter_key_int(&iter);
+    }
+    bench_report("bptree_seek_int + 100 x bptree_iter_next", NUM_SCANS, bench_now() - start);
+    bptree_deinit(&tree);
+}
+
+/* Random distinct keys, looked up at random and scanned 100 at a time */
+BENCH_SUITE(BPTree) {
+    int64_t* keys   = (int64_t*)emalloc(NUM_KEYS * sizeof(int64_t));
+    int64_t* sorted = (int64_t*)emalloc(NUM_KEYS * sizeof(int64_t));
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    /* The low bits hold the index, which keeps the keys distinct */
+    for (size_t i = 0; i < NUM_KEYS; i++)
+        keys[i] = (int64_t)((bench_rand(&seed) & ~(uint64_t)0xFFFFF) | i);
+    memcpy(sorted, keys, NUM_KEYS * sizeof(int64_t));
+    sort_radix_i64(sorted, NUM_KEYS);
+    printf("  %d keys, %d lookups, %d scans\n", NUM_KEYS, NUM_LOOKUPS, NUM_SCANS);
+    bench_bstree(keys);
+    bench_bptree(keys, sorted);
+    free(sorted);
+    free(keys);
+}
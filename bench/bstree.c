@@ -0,0 +1,70 @@
+#include "bench.h"
+#include <stdc.h>
+#include <bstree.h>
+
+enum { NUM_KEYS = 1 << 15 };
+
+typedef struct {
+    bstree_node_t node;
+    uint64_t key;
+} key_node_t;
+
+static int compare(bstree_node_t* a, bstree_node_t* b) {
+    key_node_t* nodea = container_of(a, key_node_t, node);
+    key_node_t* nodeb = container_of(b, key_node_t, node);
+    return (nodea->key < nodeb->key) ? -1 : (nodea->key > nodeb->key) ? 1 : 0;
+}
+
+/* Insert, look up and delete every key in the given order, checking the
+ * size once per key as a monitoring loop would */
+static void run_order(const char* order, key_node_t* nodes, bool balanced) {
+    char name[64];
+    bstree_t tree;
+    if (balanced)
+        bstree_init_balanced(&tree, compare, false);
+    else
+        bstree_init(&tree, compare, false);
+
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < NUM_KEYS; i++)
+        bstree_insert(&tree, &(nodes[i].node));
+    snprintf(name, sizeof(name), "%s insert %s", (balanced ? "balanced" : "plain"), order);
+    bench_report(name, NUM_KEYS, bench_now() - start);
+
+    start = bench_now();
+    for (size_t i = 0; i < NUM_KEYS; i++)
+        Bench_Sink += (uintptr_t)bstree_lookup(&tree, &(nodes[(i * 7919u) % NUM_KEYS].node));
+    snprintf(name, sizeof(name), "%s lookup %s", (balanced ? "balanced" : "plain"), order);
+    bench_report(name, NUM_KEYS, bench_now() - start);
+
+    start = bench_now();
+    for (size_t i = 0; i < NUM_KEYS; i++)
+        Bench_Sink += bstree_size(&tree);
+    snprintf(name, sizeof(name), "%s size %s", (balanced ? "balanced" : "plain"), order);
+    bench_report(name, NUM_KEYS, bench_now() - start);
+
+    start = bench_now();
+    for (size_t i = 0; i < NUM_KEYS; i++)
+        bstree_delete(&tree, &(nodes[i].node));
+    snprintf(name, sizeof(name), "%s delete %s", (balanced ? "balanced" : "plain"), order);
+    bench_report(name, NUM_KEYS, bench_now() - start);
+}
+
+BENCH_SUITE(BSTree) {
+    static key_node_t nodes[NUM_KEYS];
+    static const char* orders[] = { "sorted", "reverse", "random" };
+    printf("  %d keys\n", NUM_KEYS);
+    for (int order = 0; order < 3; order++) {
+        uint64_t seed = 0x9E3779B97F4A7C15ull;
+        for (size_t i = 0; i < NUM_KEYS; i++) {
+            if (order == 0)
+                nodes[i].key = i;
+            else if (order == 1)
+                nodes[i].key = NUM_KEYS - i;
+            else
+                nodes[i].key = bench_rand(&seed);
+        }
+        run_order(orders[order], nodes, false);
+        run_order(orders[order], nodes, true);
+    }
+}
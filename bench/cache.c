@@ -0,0 +1,122 @@
+#include "bench.h"
+#include <stdc.h>
+#include <hash.h>
+#include <list.h>
+#include <cache.h>
+
+enum {
+    NUM_KEYS   = 1 << 19, /* keys drawn from the Zipfian distribution */
+    SCAN_KEYS  = 1 << 19, /* separate keys walked in order by the scans */
+    NUM_OPS    = 1 << 22,
+    SCAN_EVERY = 1 << 17, /* ops between the start of each scan */
+    SCAN_LEN   = 1 << 14,
+};
+
+typedef struct {
+    cache_entry_t cache;
+    uint val;
+} item_t;
+
+static item_t* Items;
+
+static unsigned int hash_func(const hash_entry_t* entry) {
+    item_t* item = container_of(entry, item_t, cache.hash);
+    return item->val;
+}
+
+static int compare_func(const hash_entry_t* entry1, const hash_entry_t* entry2) {
+    item_t* item1 = container_of(entry1, item_t, cache.hash);
+    item_t* item2 = container_of(entry2, item_t, cache.hash);
+    return (item1->val < item2->val) ? -1 : (item1->val > item2->val) ? 1 : 0;
+}
+
+/* Items are preallocated, so there is nothing to release */
+static void evict_func(cache_entry_t* entry, void* arg) {
+    (void)entry;
+    (void)arg;
+}
+
+/* Items are charged between 64 and 1024 bytes */
+static size_t item_bytes(uint key) {
+    return 64u * (1u + (hash32(key) & 15u));
+}
+
+/* Draw keys with probability proportional to 1/rank (Zipf with an exponent
+ * of 1) by inverting the CDF with a binary search. Ranks are scattered over
+ * the key space so that popular keys are not also neighbours. */
+static void zipf_trace(uint* trace, size_t count) {
+    double* cdf = (double*)emalloc(NUM_KEYS * sizeof(double));
+    double sum = 0.0;
+    for (size_t i = 0; i < NUM_KEYS; i++)
+        cdf[i] = (sum += 1.0 / (double)(i + 1));
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < count; i++) {
+        double u = ((double)(bench_rand(&seed) >> 11) / 9007199254740992.0) * sum;
+        size_t lo = 0, hi = NUM_KEYS - 1;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (cdf[mid] < u)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        trace[i] = (uint)((lo * 2654435761u) & (NUM_KEYS - 1));
+    }
+    free(cdf);
+}
+
+/* Replace a run of the trace with a sequential scan every SCAN_EVERY ops */
+static void add_scans(uint* trace, size_t count) {
+    uint next = 0;
+    for (size_t start = SCAN_EVERY / 2; start < count; start += SCAN_EVERY) {
+        for (size_t i = start; (i < start + SCAN_LEN) && (i < count); i++) {
+            trace[i] = NUM_KEYS + next;
+            next = (next + 1) & (SCAN_KEYS - 1);
+        }
+    }
+}
+
+static void run(const char* trace_name, uint* trace, int policy, const char* policy_name, size_t budget) {
+    cache_t cache;
+    cache_init(&cache, policy, budget, hash_func, compare_func, evict_func, NULL);
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < NUM_OPS; i++) {
+        item_t search = { .val = trace[i] };
+        if (cache_get(&cache, &(search.cache)) == NULL)
+            cache_put(&cache, &(Items[trace[i]].cache), item_bytes(trace[i]));
+    }
+    uint64_t elapsed = bench_now() - start;
+    cache_stats_t stats = cache_stats(&cache);
+    char name[64];
+    snprintf(name, sizeof(name), "%-8s %-8s", trace_name, policy_name);
+    bench_report(name, NUM_OPS, elapsed);
+    printf("    %-48s %10.2f %% hits %10zu evictions\n", "",
+        (100.0 * (double)stats.hits) / (double)NUM_OPS, stats.evictions);
+    cache_deinit(&cache);
+}
+
+BENCH_SUITE(Cache) {
+    static const int policies[] = { CACHE_LRU, CACHE_CLOCK, CACHE_S3FIFO };
+    static const char* policy_names[] = { "lru", "clock", "s3fifo" };
+    uint* zipf = (uint*)emalloc(NUM_OPS * sizeof(uint));
+    uint* scan = (uint*)emalloc(NUM_OPS * sizeof(uint));
+    Items = (item_t*)emalloc((NUM_KEYS + SCAN_KEYS) * sizeof(item_t));
+    size_t total = 0;
+    for (uint i = 0; i < NUM_KEYS + SCAN_KEYS; i++) {
+        Items[i].val = i;
+        total += (i < NUM_KEYS ? item_bytes(i) : 0);
+    }
+    zipf_trace(zipf, NUM_OPS);
+    memcpy(scan, zipf, NUM_OPS * sizeof(uint));
+    add_scans(scan, NUM_OPS);
+    size_t budget = total / 20;
+    printf("  %d ops over %d keys, zipf exponent 1, %zu byte budget (5%% of keys)\n", NUM_OPS, NUM_KEYS, budget);
+    for (size_t p = 0; p < nelem(policies); p++)
+        run("zipf", zipf, policies[p], policy_names[p], budget);
+    printf("  same trace with a %d key scan every %d ops\n", SCAN_LEN, SCAN_EVERY);
+    for (size_t p = 0; p < nelem(policies); p++)
+        run("scan", scan, policies[p], policy_names[p], budget);
+    free(Items);
+    free(scan);
+    free(zipf);
+}
@@ -0,0 +1,133 @@
+#include "bench.h"
+#include <stdc.h>
+#include <hash.h>
+#include <chash.h>
+
+enum { NUM_KEYS = 1 << 20, TOTAL_OPS = 1 << 23 };
+
+typedef struct {
+    hash_entry_t link;
+    uint val;
+} int_node_t;
+
+enum { MUTEX, LOCKED_READS, EPOCH_READS };
+
+typedef struct {
+    int kind;
+    unsigned int write_pct;
+    size_t nops;
+    uint64_t seed;
+    chash_reader_t* reader;
+} worker_t;
+
+static hash_t Global;
+static pthread_mutex_t Global_Lock = PTHREAD_MUTEX_INITIALIZER;
+static chash_t Sharded;
+static chash_reader_t* Readers[64]; /* one per thread, as slots are never returned */
+
+static unsigned int hash_func(const hash_entry_t* entry) {
+    int_node_t* node = container_of(entry, int_node_t, link);
+    return node->val;
+}
+
+static int compare_func(const hash_entry_t* entry1, const hash_entry_t* entry2) {
+    int_node_t* node1 = container_of(entry1, int_node_t, link);
+    int_node_t* node2 = container_of(entry2, int_node_t, link);
+    return (node1->val < node2->val) ? -1 : (node1->val > node2->val) ? 1 : 0;
+}
+
+static void delete_func(hash_entry_t* entry) {
+    free(container_of(entry, int_node_t, link));
+}
+
+static void sum_visit(hash_entry_t* entry, void* arg) {
+    int_node_t* node = container_of(entry, int_node_t, link);
+    *(uintptr_t*)arg += node->val;
+}
+
+static int_node_t* new_node(uint val) {
+    int_node_t* node = (int_node_t*)emalloc(sizeof(int_node_t));
+    node->val = val;
+    return node;
+}
+
+/* Writes delete a key and insert a freshly allocated node for it, so the
+ * table size stays fixed for the whole run and removed nodes are freed
+ * through the delete function */
+static void* worker(void* arg) {
+    worker_t* work = (worker_t*)arg;
+    uintptr_t sink = 0;
+    chash_reader_t* reader = work->reader;
+    for (size_t i = 0; i < work->nops; i++) {
+        uint64_t r = bench_rand(&(work->seed));
+        int_node_t search = { .val = (uint)(r % NUM_KEYS) * 2654435761u };
+        bool write = ((r >> 32) % 100) < work->write_pct;
+        if (work->kind == MUTEX) {
+            pthread_mutex_lock(&Global_Lock);
+            if (write) {
+                hash_del(&Global, &(search.link));
+                hash_set(&Global, &(new_node(search.val)->link));
+            } else {
+                sink += (uintptr_t)hash_get(&Global, &(search.link));
+            }
+            pthread_mutex_unlock(&Global_Lock);
+        } else if (write) {
+            chash_del(&Sharded, &(search.link));
+            chash_set(&Sharded, &(new_node(search.val)->link));
+        } else if (work->kind == LOCKED_READS) {
+            chash_visit(&Sharded, &(search.link), sum_visit, &sink);
+        } else {
+            chash_read_enter(&Sharded, reader);
+            hash_entry_t* found = chash_find(&Sharded, &(search.link));
+            int_node_t* node = (found ? container_of(found, int_node_t, link) : NULL);
+            sink += (node ? node->val : 0);
+            chash_read_exit(reader);
+        }
+    }
+    Bench_Sink += sink;
+    return NULL;
+}
+
+static void run(int kind, unsigned int write_pct, size_t nthreads) {
+    static const char* names[] = { "mutex+hash_t", "chash locked", "chash epoch" };
+    pthread_t threads[64];
+    worker_t work[64];
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < nthreads; i++) {
+        work[i].kind      = kind;
+        work[i].reader    = Readers[i];
+        work[i].write_pct = write_pct;
+        work[i].nops      = TOTAL_OPS / nthreads;
+        work[i].seed      = 88172645463325252ull + (i * 7919);
+        pthread_create(&threads[i], NULL, worker, &work[i]);
+    }
+    for (size_t i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+    uint64_t elapsed = bench_now() - start;
+    char name[64];
+    sprintf(name, "%-14s %2u%% writes %2zu threads", names[kind], write_pct, nthreads);
+    bench_report(name, TOTAL_OPS, elapsed);
+}
+
+BENCH_SUITE(CHash) {
+    static const unsigned int writes[] = { 10, 50 };
+    static const size_t threads[] = { 1, 2, 4, 8, 16, 32, 64 };
+    hash_init(&Global, hash_func, compare_func, delete_func);
+    chash_init(&Sharded, 0, hash_func, compare_func, delete_func);
+    for (uint i = 0; i < NUM_KEYS; i++) {
+        hash_set(&Global, &(new_node(i * 2654435761u)->link));
+        chash_set(&Sharded, &(new_node(i * 2654435761u)->link));
+    }
+    for (size_t i = 0; i < nelem(Readers); i++)
+        Readers[i] = chash_reader(&Sharded);
+    printf("  %d keys, %d operations split across the threads\n", NUM_KEYS, TOTAL_OPS);
+    for (size_t w = 0; w < nelem(writes); w++) {
+        for (size_t t = 0; t < nelem(threads); t++) {
+            run(MUTEX, writes[w], threads[t]);
+            run(LOCKED_READS, writes[w], threads[t]);
+            run(EPOCH_READS, writes[w], threads[t]);
+        }
+    }
+    hash_deinit(&Global);
+    chash_deinit(&Sharded);
+}
@@ -0,0 +1,134 @@
+#include "bench.h"
+#include <stdc.h>
+#include <hash.h>
+#include <fhash.h>
+
+#define IMAGE_PATH "fhash_bench.img"
+
+enum { NUM_KEYS = 1 << 20, NUM_LOOKUPS = 1 << 22, NUM_PROBES = 100 };
+
+typedef struct {
+    hash_entry_t link;
+    char key[16];
+    uint64_t val;
+} str_node_t;
+
+static unsigned int hash_func(const hash_entry_t* entry) {
+    str_node_t* node = container_of(entry, str_node_t, link);
+    return hash_bytes(node->key, strlen(node->key));
+}
+
+static int compare_func(const hash_entry_t* entry1, const hash_entry_t* entry2) {
+    str_node_t* node1 = container_of(entry1, str_node_t, link);
+    str_node_t* node2 = container_of(entry2, str_node_t, link);
+    return strcmp(node1->key, node2->key);
+}
+
+static void delete_func(hash_entry_t* entry) {
+    (void)entry;
+}
+
+static void key_func(const hash_entry_t* entry, const void** data, size_t* len) {
+    str_node_t* node = container_of(entry, str_node_t, link);
+    *data = node->key;
+    *len  = strlen(node->key);
+}
+
+static void val_func(const hash_entry_t* entry, const void** data, size_t* len) {
+    str_node_t* node = container_of(entry, str_node_t, link);
+    *data = &(node->val);
+    *len  = sizeof(node->val);
+}
+
+/* Current resident set size in KiB, or 0 where /proc is unavailable */
+static size_t resident_kb(void) {
+    unsigned long size = 0, resident = 0;
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file != NULL) {
+        if (2 != fscanf(file, "%lu %lu", &size, &resident))
+            resident = 0;
+        fclose(file);
+    }
+    return (size_t)resident * ((size_t)sysconf(_SC_PAGESIZE) / 1024u);
+}
+
+static str_node_t* build_table(hash_t* hash) {
+    str_node_t* nodes = (str_node_t*)calloc(NUM_KEYS, sizeof(str_node_t));
+    hash_init(hash, hash_func, compare_func, delete_func);
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        sprintf(nodes[i].key, "key-%zu", i);
+        nodes[i].val = i;
+        hash_set(hash, &(nodes[i].link));
+    }
+    return nodes;
+}
+
+static uint64_t lookup_hash(hash_t* hash, size_t nlookups) {
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    uintptr_t sink = 0;
+    str_node_t search;
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < nlookups; i++) {
+        sprintf(search.key, "key-%zu", (size_t)(bench_rand(&seed) % NUM_KEYS));
+        sink += (uintptr_t)hash_get(hash, &(search.link));
+    }
+    Bench_Sink = sink;
+    return bench_now() - start;
+}
+
+static uint64_t lookup_fhash(fhash_t* fhash, size_t nlookups) {
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    uintptr_t sink = 0;
+    char key[16];
+    const void* val;
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < nlookups; i++) {
+        int len = sprintf(key, "key-%zu", (size_t)(bench_rand(&seed) % NUM_KEYS));
+        sink += fhash_get(fhash, key, (size_t)len, &val, NULL);
+    }
+    Bench_Sink = sink;
+    return bench_now() - start;
+}
+
+/* Compare building a table at startup against mapping a prebuilt image */
+static void bench_startup(void) {
+    hash_t hash;
+    fhash_t fhash;
+    char name[128];
+    static const char* modes[] = { "linear probing", "minimal perfect" };
+    printf("  startup with %d string keys\n", NUM_KEYS);
+    size_t rss = resident_kb();
+    uint64_t start = bench_now();
+    str_node_t* nodes = build_table(&hash);
+    uint64_t build_ns = bench_now() - start;
+    printf("    %-48s %10.2f ms %10zu KiB rss\n", "hash_t build", build_ns / 1e6, resident_kb() - rss);
+    bench_report("hash_get hit", NUM_LOOKUPS, lookup_hash(&hash, NUM_LOOKUPS));
+    for (unsigned int mode = 0; mode < 2; mode++) {
+        start = bench_now();
+        bool ok = fhash_write(&hash, IMAGE_PATH, key_func, val_func, mode ? FHASH_PERFECT : 0);
+        sprintf(name, "fhash_write %s", modes[mode]);
+        printf("    %-48s %10.2f ms\n", name, (bench_now() - start) / 1e6);
+        if (!ok)
+            continue;
+        /* The image stays in the page cache, so this is a warm start */
+        rss = resident_kb();
+        start = bench_now();
+        fhash_open(&fhash, IMAGE_PATH);
+        lookup_fhash(&fhash, 1);
+        sprintf(name, "fhash_open %s + first lookup", modes[mode]);
+        printf("    %-48s %10.2f ms %10zu KiB rss\n", name, (bench_now() - start) / 1e6, resident_kb() - rss);
+        lookup_fhash(&fhash, NUM_PROBES);
+        sprintf(name, "  after %d lookups (image %zu KiB)", NUM_PROBES, fhash.size / 1024u);
+        printf("    %-48s %10s    %10zu KiB rss\n", name, "", resident_kb() - rss);
+        sprintf(name, "fhash_get hit %s", modes[mode]);
+        bench_report(name, NUM_LOOKUPS, lookup_fhash(&fhash, NUM_LOOKUPS));
+        fhash_close(&fhash);
+    }
+    remove(IMAGE_PATH);
+    hash_deinit(&hash);
+    free(nodes);
+}
+
+BENCH_SUITE(FHash) {
+    bench_startup();
+}
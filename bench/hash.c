@@ -0,0 +1,304 @@
+#include "bench.h"
+#include <stdc.h>
+#include <hash.h>
+
+typedef struct {
+    hash_entry_t link;
+    uint val;
+} int_node_t;
+
+static unsigned int hash_func(const hash_entry_t* entry) {
+    int_node_t* node = container_of(entry, int_node_t, link);
+    return node->val;
+}
+
+static int compare_func(const hash_entry_t* entry1, const hash_entry_t* entry2) {
+    int_node_t* node1 = container_of(entry1, int_node_t, link);
+    int_node_t* node2 = container_of(entry2, int_node_t, link);
+    uint a = node1->val, b = node2->val;
+    return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+static void delete_func(hash_entry_t* entry) {
+    (void)entry;
+}
+
+/* Bijective scramble so keys are distinct but not sequential */
+static uint key_at(size_t i) {
+    return (uint)(i * 2654435761u);
+}
+
+static int_node_t* make_nodes(size_t count) {
+    int_node_t* nodes = (int_node_t*)emalloc(count * sizeof(int_node_t));
+    for (size_t i = 0; i < count; i++)
+        nodes[i].val = key_at(i);
+    return nodes;
+}
+
+static uint64_t lookup_chained(hash_t* hash, size_t count, size_t nlookups, bool hit) {
+    uint64_t seed = 88172645463325252ull;
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < nlookups; i++) {
+        size_t idx = bench_rand(&seed) % count;
+        int_node_t search = { .val = key_at(hit ? idx : idx + count) };
+        Bench_Sink += (uintptr_t)hash_get(hash, &(search.link));
+    }
+    return bench_now() - start;
+}
+
+static uint64_t lookup_robinhood(rhash_t* hash, size_t count, size_t nlookups, bool hit) {
+    uint64_t seed = 88172645463325252ull;
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < nlookups; i++) {
+        size_t idx = bench_rand(&seed) % count;
+        int_node_t search = { .val = key_at(hit ? idx : idx + count) };
+        Bench_Sink += (uintptr_t)rhash_get(hash, &(search.link));
+    }
+    return bench_now() - start;
+}
+
+static void bench_load_factors(void) {
+    static const unsigned int loads[] = { 50, 60, 70, 80, 90, 95 };
+    const size_t chain_buckets = 1572869; /* Primes[18] */
+    const size_t rhash_slots   = (size_t)1 << 20;
+    const size_t nlookups      = 4000000;
+    char name[64];
+    for (size_t l = 0; l < nelem(loads); l++) {
+        /* The chained table only stops growing on the target prime once it
+         * has passed the previous one, which is almost exactly half of it */
+        size_t count = (chain_buckets * loads[l]) / 100;
+        if (count <= 786433) count = 786434;
+        int_node_t* nodes = make_nodes(count);
+        hash_t chained;
+        hash_init(&chained, hash_func, compare_func, delete_func);
+        for (size_t i = 0; i < count; i++)
+            hash_set(&chained, &(nodes[i].link));
+        printf("  load factor %.2f\n", (double)hash_size(&chained) / num_buckets(&chained, chained.bkt_count));
+        sprintf(name, "hash_get hit");
+        bench_report(name, nlookups, lookup_chained(&chained, count, nlookups, true));
+        sprintf(name, "hash_get miss");
+        bench_report(name, nlookups, lookup_chained(&chained, count, nlookups, false));
+        hash_deinit(&chained);
+        free(nodes);
+
+        count = (rhash_slots * loads[l]) / 100;
+        nodes = make_nodes(count);
+        rhash_t robin;
+        rhash_init(&robin, hash_func, compare_func, delete_func);
+        robin.max_load = loads[l];
+        for (size_t i = 0; i < count; i++)
+            rhash_set(&robin, &(nodes[i].link));
+        printf("  load factor %.2f (robin hood)\n", (double)rhash_size(&robin) / robin.capacity);
+        sprintf(name, "rhash_get hit");
+        bench_report(name, nlookups, lookup_robinhood(&robin, count, nlookups, true));
+        sprintf(name, "rhash_get miss");
+        bench_report(name, nlookups, lookup_robinhood(&robin, count, nlookups, false));
+        rhash_deinit(&robin);
+        free(nodes);
+    }
+}
+
+static const struct { const char* name; unsigned int flags; } Bucket_Modes[] = {
+    { "prime modulo", 0 },
+    { "power of two mask", HASH_POW2 },
+};
+
+/* Cost of turning a hash into a bucket index, independent of memory */
+static void bench_bucket_index(void) {
+    const size_t nhashes = 100000000;
+    char name[64];
+    for (size_t m = 0; m < nelem(Bucket_Modes); m++) {
+        hash_t hash;
+        hash_init_flags(&hash, hash_func, compare_func, delete_func, Bucket_Modes[m].flags);
+        hash.bkt_count = 20;
+        uint acc = 0;
+        uint64_t start = bench_now();
+        for (size_t i = 0; i < nhashes; i++)
+            acc += bucket_index(&hash, hash.bkt_count, (uint)i + acc);
+        uint64_t elapsed = bench_now() - start;
+        Bench_Sink += acc;
+        hash.bkt_count = 0;
+        hash_deinit(&hash);
+        sprintf(name, "bucket_index %s", Bucket_Modes[m].name);
+        bench_report(name, nhashes, elapsed);
+    }
+}
+
+static void bench_bucket_modes(const char* keys, size_t count, uint stride) {
+    const size_t nlookups = 8000000;
+    char name[64];
+    int_node_t* nodes = (int_node_t*)emalloc(count * sizeof(int_node_t));
+    uint64_t keyseed = 2463534242ull;
+    for (size_t i = 0; i < count; i++)
+        nodes[i].val = (stride ? (uint)i * stride : (uint)bench_rand(&keyseed));
+    for (size_t m = 0; m < nelem(Bucket_Modes); m++) {
+        hash_t hash;
+        hash_init_flags(&hash, hash_func, compare_func, delete_func, Bucket_Modes[m].flags);
+        for (size_t i = 0; i < count; i++)
+            hash_set(&hash, &(nodes[i].link));
+        uint64_t seed = 88172645463325252ull;
+        uint64_t start = bench_now();
+        for (size_t i = 0; i < nlookups; i++)
+            Bench_Sink += (uintptr_t)hash_get(&hash, &(nodes[bench_rand(&seed) % count].link));
+        uint64_t elapsed = bench_now() - start;
+        sprintf(name, "%s (%zu %s, lf %.2f)", Bucket_Modes[m].name, count, keys,
+            (double)hash_size(&hash) / num_buckets(&hash, hash.bkt_count));
+        bench_report(name, nlookups, elapsed);
+        hash_deinit(&hash);
+    }
+    free(nodes);
+}
+
+/* The original byte-at-a-time hash_bytes, kept as a reference point */
+static uint32_t legacy_hash_bytes(const uint8_t* key, size_t len) {
+    uint32_t a=31415u, b=27183u, hash;
+    for (hash=0; len > 0; key++, len--, a*=b)
+        hash = (a * hash) + *key;
+    return hash32(hash);
+}
+
+static void bench_hash_bytes(void) {
+    static const size_t sizes[] = { 8, 16, 32, 64, 256, 4096, 1 << 20 };
+    const size_t total = (size_t)1 << 30;
+    uint8_t* buf = (uint8_t*)emalloc(sizes[nelem(sizes)-1] + 64);
+    for (size_t i = 0; i < sizes[nelem(sizes)-1] + 64; i++)
+        buf[i] = (uint8_t)(i * 131u);
+    for (size_t i = 0; i < nelem(sizes); i++) {
+        size_t iters = total / sizes[i];
+        /* Vary the start offset so short keys are not always aligned */
+        uint64_t start = bench_now();
+        for (size_t n = 0; n < iters; n++)
+            Bench_Sink += hash_bytes64(buf + (n & 7), sizes[i], 0);
+        uint64_t fast = bench_now() - start;
+        size_t legacy_iters = iters / 8;
+        start = bench_now();
+        for (size_t n = 0; n < legacy_iters; n++)
+            Bench_Sink += legacy_hash_bytes(buf + (n & 7), sizes[i]);
+        uint64_t legacy = bench_now() - start;
+        printf("    %8zu byte keys: hash_bytes64 %7.2f GB/s  %7.2f ns/key   legacy %5.2f GB/s\n", sizes[i],
+            (double)(iters * sizes[i]) / (double)fast, (double)fast / (double)iters,
+            (double)(legacy_iters * sizes[i]) / (double)legacy);
+    }
+    free(buf);
+}
+
+static void bench_batch_lookup(void) {
+    const size_t count = 8000000, nlookups = 8000000, batch = 1024;
+    int_node_t* nodes = make_nodes(count);
+    int_node_t* search = (int_node_t*)emalloc(batch * sizeof(int_node_t));
+    hash_entry_t** entries = (hash_entry_t**)emalloc(batch * sizeof(hash_entry_t*));
+    hash_entry_t** results = (hash_entry_t**)emalloc(batch * sizeof(hash_entry_t*));
+    hash_t hash;
+    hash_init(&hash, hash_func, compare_func, delete_func);
+    for (size_t i = 0; i < count; i++)
+        hash_set(&hash, &(nodes[i].link));
+    for (size_t i = 0; i < batch; i++)
+        entries[i] = &(search[i].link);
+    for (int batched = 0; batched < 2; batched++) {
+        uint64_t seed = 88172645463325252ull, elapsed = 0;
+        for (size_t done = 0; done < nlookups; done += batch) {
+            for (size_t i = 0; i < batch; i++)
+                search[i].val = key_at(bench_rand(&seed) % count);
+            uint64_t start = bench_now();
+            if (batched) {
+                hash_get_batch(&hash, entries, batch, results);
+            } else {
+                for (size_t i = 0; i < batch; i++)
+                    results[i] = hash_get(&hash, entries[i]);
+            }
+            elapsed += bench_now() - start;
+            Bench_Sink += (uintptr_t)results[batch - 1];
+        }
+        bench_report(batched ? "hash_get_batch (1024 keys per call)" : "hash_get loop", nlookups, elapsed);
+    }
+    hash_deinit(&hash);
+    free(results);
+    free(entries);
+    free(search);
+    free(nodes);
+}
+
+static void bench_bulk_load(void) {
+    const size_t count = 8000000;
+    int_node_t* nodes = make_nodes(count);
+    hash_entry_t** entries = (hash_entry_t**)emalloc(count * sizeof(hash_entry_t*));
+    for (size_t i = 0; i < count; i++)
+        entries[i] = &(nodes[i].link);
+    for (int mode = 0; mode < 3; mode++) {
+        hash_t hash;
+        hash_init(&hash, hash_func, compare_func, delete_func);
+        uint64_t start = bench_now();
+        if (mode == 2) {
+            hash_load(&hash, entries, count);
+        } else {
+            if (mode == 1)
+                hash_reserve(&hash, count);
+            for (size_t i = 0; i < count; i++)
+                hash_set(&hash, entries[i]);
+        }
+        uint64_t elapsed = bench_now() - start;
+        bench_report((mode == 0) ? "hash_set from empty" : (mode == 1) ? "hash_reserve + hash_set" : "hash_load",
+            count, elapsed);
+        if (mode == 2) {
+            hash_iter_t iter;
+            uintptr_t sum = 0;
+            start = bench_now();
+            hash_foreach(elem, iter, &hash) {
+                int_node_t* node = container_of(elem, int_node_t, link);
+                sum += node->val;
+            }
+            bench_report("hash_foreach", count, bench_now() - start);
+            Bench_Sink += sum;
+        }
+        hash_deinit(&hash);
+    }
+    free(entries);
+    free(nodes);
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static void bench_set_latency(const char* mode, unsigned int flags) {
+    const size_t count = 8000000;
+    int_node_t* nodes = make_nodes(count);
+    uint64_t* lat = (uint64_t*)emalloc(count * sizeof(uint64_t));
+    hash_t hash;
+    hash_init_flags(&hash, hash_func, compare_func, delete_func, flags);
+    uint64_t total = bench_now();
+    for (size_t i = 0; i < count; i++) {
+        uint64_t start = bench_now();
+        hash_set(&hash, &(nodes[i].link));
+        lat[i] = bench_now() - start;
+    }
+    total = bench_now() - total;
+    qsort(lat, count, sizeof(uint64_t), cmp_u64);
+    printf("    %-12s p50 %6llu ns  p99 %6llu ns  p999 %8llu ns  max %10llu ns  total %6.1f ms\n", mode,
+        (unsigned long long)lat[count/2], (unsigned long long)lat[(count*99)/100],
+        (unsigned long long)lat[(count*999)/1000], (unsigned long long)lat[count-1],
+        (double)total / 1e6);
+    hash_deinit(&hash);
+    free(lat);
+    free(nodes);
+}
+
+BENCH_SUITE(Hash) {
+    printf("  hash_bytes throughput\n");
+    bench_hash_bytes();
+    bench_load_factors();
+    printf("  bucket indexing\n");
+    bench_bucket_index();
+    bench_bucket_modes("random keys", 50000, 0);
+    bench_bucket_modes("strided keys", 50000, 64);
+    bench_bucket_modes("random keys", 2000000, 0);
+    bench_bucket_modes("strided keys", 2000000, 64);
+    printf("  loading and iterating (8M entries)\n");
+    bench_bulk_load();
+    printf("  batched lookups (8M entries)\n");
+    bench_batch_lookup();
+    printf("  hash_set latency (8M inserts)\n");
+    bench_set_latency("stop-the-world", 0);
+    bench_set_latency("incremental", HASH_INCREMENTAL);
+}
@@ -0,0 +1,174 @@
+#include "bench.h"
+#include <stdc.h>
+#include <slist.h>
+#include <lockfree.h>
+#include <pthread.h>
+#include <sched.h>
+
+enum { NUM_ITEMS = 1 << 20, MAX_THREADS = 16, RING_SIZE = 1024 };
+
+typedef struct {
+    slist_node_t link;
+    uint64_t stamp;
+} job_t;
+
+/* The mutex guarded queue we are replacing */
+typedef struct {
+    pthread_mutex_t lock;
+    squeue_t queue;
+} lockq_t;
+
+typedef struct {
+    const char* name;
+    bool (*push)(void* queue, slist_node_t* node);
+    slist_node_t* (*pop)(void* queue);
+    void* queue;
+} kind_t;
+
+typedef struct {
+    kind_t* kind;
+    job_t* jobs;
+    size_t njobs;
+} worker_t;
+
+static atomic_size_t Received;
+static uint64_t* Latency;
+
+static bool lockq_push(void* queue, slist_node_t* node) {
+    lockq_t* q = (lockq_t*)queue;
+    pthread_mutex_lock(&(q->lock));
+    squeue_enqueue(&(q->queue), node);
+    pthread_mutex_unlock(&(q->lock));
+    return true;
+}
+
+static slist_node_t* lockq_pop(void* queue) {
+    lockq_t* q = (lockq_t*)queue;
+    slist_node_t* node = NULL;
+    pthread_mutex_lock(&(q->lock));
+    if (!squeue_empty(&(q->queue)))
+        node = squeue_dequeue(&(q->queue));
+    pthread_mutex_unlock(&(q->lock));
+    return node;
+}
+
+static bool stack_push(void* queue, slist_node_t* node) {
+    lfstack_push((lfstack_t*)queue, node);
+    return true;
+}
+
+static slist_node_t* stack_pop(void* queue) {
+    return lfstack_pop((lfstack_t*)queue);
+}
+
+static bool mpsc_push(void* queue, slist_node_t* node) {
+    mpscq_push((mpscq_t*)queue, node);
+    return true;
+}
+
+static slist_node_t* mpsc_pop(void* queue) {
+    return mpscq_pop((mpscq_t*)queue);
+}
+
+static bool mpmc_push(void* queue, slist_node_t* node) {
+    return mpmcq_push((mpmcq_t*)queue, node);
+}
+
+static slist_node_t* mpmc_pop(void* queue) {
+    return mpmcq_pop((mpmcq_t*)queue);
+}
+
+static void* producer(void* arg) {
+    worker_t* work = (worker_t*)arg;
+    for (size_t i = 0; i < work->njobs; i++) {
+        work->jobs[i].stamp = bench_now();
+        while (!work->kind->push(work->kind->queue, &(work->jobs[i].link)))
+            sched_yield();
+    }
+    return NULL;
+}
+
+/* Consumers record how long each job sat between its push and its pop. Every
+ * pop claims the next slot in Latency, and there are exactly NUM_ITEMS pops. */
+static void* consumer(void* arg) {
+    worker_t* work = (worker_t*)arg;
+    while (atomic_load_explicit(&Received, memory_order_relaxed) < NUM_ITEMS) {
+        slist_node_t* node = work->kind->pop(work->kind->queue);
+        if (node == NULL) {
+            sched_yield();
+            continue;
+        }
+        job_t* job = container_of(node, job_t, link);
+        uint64_t waited = bench_now() - job->stamp;
+        Latency[atomic_fetch_add_explicit(&Received, 1, memory_order_relaxed)] = waited;
+    }
+    return NULL;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static void run(kind_t* kind, job_t* jobs, size_t nprod, size_t ncons) {
+    pthread_t prods[MAX_THREADS], conss[MAX_THREADS];
+    worker_t pwork[MAX_THREADS], cwork[MAX_THREADS];
+    atomic_store(&Received, 0);
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < ncons; i++) {
+        cwork[i].kind = kind;
+        pthread_create(&conss[i], NULL, consumer, &cwork[i]);
+    }
+    for (size_t i = 0; i < nprod; i++) {
+        pwork[i].kind  = kind;
+        pwork[i].jobs  = jobs + (i * (NUM_ITEMS / nprod));
+        pwork[i].njobs = NUM_ITEMS / nprod;
+        pthread_create(&prods[i], NULL, producer, &pwork[i]);
+    }
+    for (size_t i = 0; i < nprod; i++)
+        pthread_join(prods[i], NULL);
+    for (size_t i = 0; i < ncons; i++)
+        pthread_join(conss[i], NULL);
+    uint64_t elapsed = bench_now() - start;
+    qsort(Latency, NUM_ITEMS, sizeof(uint64_t), cmp_u64);
+
+    char name[64];
+    snprintf(name, sizeof(name), "%-13s %2zu prod %2zu cons", kind->name, nprod, ncons);
+    bench_report(name, NUM_ITEMS, elapsed);
+    printf("    %-48s %10llu ns p50 %10llu ns p99\n", "  push to pop latency",
+        (unsigned long long)Latency[NUM_ITEMS / 2],
+        (unsigned long long)Latency[(NUM_ITEMS / 100) * 99]);
+}
+
+BENCH_SUITE(LockFree) {
+    static const size_t threads[] = { 1, 2, 4, 8, 16 };
+    job_t* jobs = (job_t*)emalloc(NUM_ITEMS * sizeof(job_t));
+    Latency = (uint64_t*)emalloc(NUM_ITEMS * sizeof(uint64_t));
+    lockq_t lockq;
+    lfstack_t stack;
+    mpscq_t mpscq;
+    mpmcq_t mpmcq;
+    pthread_mutex_init(&(lockq.lock), NULL);
+    squeue_init(&(lockq.queue));
+    lfstack_init(&stack);
+    mpscq_init(&mpscq);
+    mpmcq_init(&mpmcq, RING_SIZE);
+    kind_t kinds[] = {
+        { "mutex+squeue", lockq_push, lockq_pop, &lockq },
+        { "lfstack",      stack_push, stack_pop, &stack },
+        { "mpscq",        mpsc_push,  mpsc_pop,  &mpscq },
+        { "mpmcq",        mpmc_push,  mpmc_pop,  &mpmcq },
+    };
+    printf("  %d jobs split across the producers\n", NUM_ITEMS);
+    for (size_t t = 0; t < nelem(threads); t++) {
+        for (size_t k = 0; k < nelem(kinds); k++) {
+            /* mpscq allows a single consumer */
+            size_t ncons = (kinds[k].pop == mpsc_pop ? 1 : threads[t]);
+            run(&kinds[k], jobs, threads[t], ncons);
+        }
+    }
+    mpmcq_deinit(&mpmcq);
+    pthread_mutex_destroy(&(lockq.lock));
+    free(Latency);
+    free(jobs);
+}
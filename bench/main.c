@@ -0,0 +1,40 @@
+#include "bench.h"
+#include <stdc.h>
+
+char* ARGV0;
+volatile uintptr_t Bench_Sink;
+static int Suite_Count;
+static char** Suite_Names;
+
+/* With no arguments every suite runs, otherwise only the named ones do */
+bool bench_enabled(const char* suite) {
+    if (Suite_Count == 0)
+        return true;
+    for (int i = 0; i < Suite_Count; i++)
+        if (0 == strcmp(Suite_Names[i], suite))
+            return true;
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    ARGV0 = argv[0];
+    Suite_Count = argc - 1;
+    Suite_Names = argv + 1;
+    RUN_EXTERN_BENCH_SUITE(BSTree);
+    RUN_EXTERN_BENCH_SUITE(BPTree);
+    RUN_EXTERN_BENCH_SUITE(SList);
+    RUN_EXTERN_BENCH_SUITE(LockFree);
+    RUN_EXTERN_BENCH_SUITE(Hash);
+    RUN_EXTERN_BENCH_SUITE(CHash);
+    RUN_EXTERN_BENCH_SUITE(Cache);
+    RUN_EXTERN_BENCH_SUITE(FHash);
+    RUN_EXTERN_BENCH_SUITE(Vec);
+    RUN_EXTERN_BENCH_SUITE(Alloc);
+    RUN_EXTERN_BENCH_SUITE(Arena);
+    RUN_EXTERN_BENCH_SUITE(Sort);
+    RUN_EXTERN_BENCH_SUITE(StrBuf);
+    RUN_EXTERN_BENCH_SUITE(Rope);
+    RUN_EXTERN_BENCH_SUITE(Utf8);
+    return 0;
+}
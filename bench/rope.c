@@ -0,0 +1,94 @@
+#include "bench.h"
+#include <stdc.h>
+#include <fcntl.h>
+#include <alloc.h>
+#include <utf8.h>
+#include <slist.h>
+#include <strbuf.h>
+#include <rope.h>
+
+enum { OUTPUT_SIZE = 256 << 20, LINE_SIZE = 64 };
+
+/* Wraps malloc to track the bytes live at once. During a realloc both the
+ * old and new blocks are counted, as they are whenever the block moves. */
+typedef struct {
+    allocator_t base;
+    size_t live;
+    size_t peak;
+} count_alloc_t;
+
+static void count_grow(count_alloc_t* count, size_t size) {
+    count->live += size;
+    if (count->live > count->peak)
+        count->peak = count->live;
+}
+
+static void* count_alloc(allocator_t* a, size_t size) {
+    count_grow((count_alloc_t*)a, size);
+    return malloc(size);
+}
+
+static void* count_realloc(allocator_t* a, void* ptr, size_t oldsize, size_t newsize) {
+    count_alloc_t* count = (count_alloc_t*)a;
+    count_grow(count, newsize);
+    count->live -= oldsize;
+    return realloc(ptr, newsize);
+}
+
+static void count_free(allocator_t* a, void* ptr, size_t size) {
+    ((count_alloc_t*)a)->live -= size;
+    free(ptr);
+}
+
+static void count_init(count_alloc_t* count) {
+    count->base.alloc   = count_alloc;
+    count->base.realloc = count_realloc;
+    count->base.free    = count_free;
+    count->live         = 0;
+    count->peak         = 0;
+}
+
+static void report(const char* name, uint64_t ns, count_alloc_t* count) {
+    size_t lines = OUTPUT_SIZE / LINE_SIZE;
+    printf("    %-48s %10.2f ns/op %10zu MiB peak\n", name, (double)ns / (double)lines, count->peak >> 20);
+}
+
+/* Append OUTPUT_SIZE bytes as fixed size lines, then write it all out */
+BENCH_SUITE(Rope) {
+    char line[LINE_SIZE];
+    count_alloc_t count;
+    int fd = open("/dev/null", O_WRONLY);
+    memset(line, 'x', sizeof(line));
+    line[LINE_SIZE - 1] = '\n';
+    printf("  %d MiB in %d byte lines\n", OUTPUT_SIZE >> 20, LINE_SIZE);
+
+    strbuf_t buf;
+    count_init(&count);
+    strbuf_init_alloc(&buf, &count.base);
+    uint64_t start = bench_now();
+    for (size_t i = 0; i < (OUTPUT_SIZE / LINE_SIZE); i++)
+        strbuf_add_bytes(&buf, line, sizeof(line));
+    report("strbuf_add_bytes", bench_now() - start, &count);
+    start = bench_now();
+    if (write(fd, buf.string, buf.index) < 0)
+        perror("write");
+    printf("    %-48s %10.2f ms\n", "write", (bench_now() - start) / 1e6);
+    Bench_Sink = buf.index;
+    strbuf_deinit(&buf);
+
+    rope_t rope;
+    count_init(&count);
+    rope_init_alloc(&rope, 0, &count.base);
+    start = bench_now();
+    for (size_t i = 0; i < (OUTPUT_SIZE / LINE_SIZE); i++)
+        rope_add_bytes(&rope, line, sizeof(line));
+    report("rope_add_bytes", bench_now() - start, &count);
+    start = bench_now();
+    if (rope_write(&rope, fd) < 0)
+        perror("rope_write");
+    printf("    %-48s %10.2f ms\n", "rope_write", (bench_now() - start) / 1e6);
+    Bench_Sink = rope_size(&rope);
+    rope_deinit(&rope);
+
+    close(fd);
+}
@@ -0,0 +1,52 @@
+#include "bench.h"
+#include <stdc.h>
+#include <slist.h>
+
+enum { MAX_DEPTH = 10000000, QUEUE_OPS = 1 << 22 };
+
+typedef struct {
+    slist_node_t link;
+    uint64_t work;
+} job_t;
+
+/* Hold the queue at depth jobs while cycling one job through it per op */
+static void bench_depth(job_t* jobs, size_t depth) {
+    char name[64];
+    uint64_t start;
+
+    /* slist_push_back walks the whole list, so run fewer ops as it grows */
+    size_t ops = ((size_t)1 << 26) / depth;
+    ops = (ops < 16 ? 16 : (ops > QUEUE_OPS ? QUEUE_OPS : ops));
+    slist_t list;
+    slist_init(&list);
+    for (size_t i = depth; i > 0; i--)
+        slist_push_front(&list, &(jobs[i - 1].link));
+    start = bench_now();
+    for (size_t i = 0; i < ops; i++)
+        slist_push_back(&list, slist_pop_front(&list));
+    snprintf(name, sizeof(name), "slist_t depth %zu", depth);
+    bench_report(name, ops, bench_now() - start);
+
+    squeue_t queue;
+    squeue_init(&queue);
+    for (size_t i = 0; i < depth; i++)
+        squeue_enqueue(&queue, &(jobs[i].link));
+    start = bench_now();
+    for (size_t i = 0; i < QUEUE_OPS; i++) {
+        slist_node_t* node = squeue_dequeue(&queue);
+        job_t* job = container_of(node, job_t, link);
+        job->work++;
+        squeue_enqueue(&queue, node);
+    }
+    snprintf(name, sizeof(name), "squeue_t depth %zu", depth);
+    bench_report(name, QUEUE_OPS, bench_now() - start);
+    Bench_Sink = squeue_size(&queue);
+}
+
+BENCH_SUITE(SList) {
+    job_t* jobs = (job_t*)ecalloc(MAX_DEPTH, sizeof(job_t));
+    printf("  dequeue + enqueue pairs\n");
+    for (size_t depth = 1000; depth <= MAX_DEPTH; depth *= 10)
+        bench_depth(jobs, depth);
+    free(jobs);
+}
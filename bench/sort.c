@@ -0,0 +1,83 @@
+#include "bench.h"
+#define SORT_PARALLEL
+#include <stdc.h>
+#include <sort.h>
+
+enum { NUM_ELEMS = 1 << 22, NUM_THREADS = 4 };
+
+#define LESS_NUM(a, b) ((a) < (b))
+
+SORT_DEFINE(u64sort, uint64_t, LESS_NUM)
+SORT_DEFINE(dblsort, double, LESS_NUM)
+
+static const char* Distributions[] = { "random", "sorted", "reversed", "many duplicates" };
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static int cmp_dbl(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static void fill(uint64_t* data, size_t count, int dist) {
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < count; i++) {
+        switch (dist) {
+            case 0:  data[i] = bench_rand(&seed);        break;
+            case 1:  data[i] = i;                        break;
+            case 2:  data[i] = count - i;                break;
+            default: data[i] = bench_rand(&seed) % 100u; break;
+        }
+    }
+}
+
+static void bench_u64(uint64_t* data) {
+    char name[128];
+    printf("  %d uint64_t keys\n", NUM_ELEMS);
+    for (int dist = 0; dist < 4; dist++) {
+        for (int method = 0; method < 4; method++) {
+            static const char* methods[] = { "qsort", "SORT_DEFINE introsort", "sort_radix_u64", "parallel merge" };
+            fill(data, NUM_ELEMS, dist);
+            uint64_t start = bench_now();
+            switch (method) {
+                case 0: qsort(data, NUM_ELEMS, sizeof(uint64_t), cmp_u64);    break;
+                case 1: u64sort_sort(data, NUM_ELEMS);                        break;
+                case 2: sort_radix_u64(data, NUM_ELEMS);                      break;
+                case 3: u64sort_sort_parallel(data, NUM_ELEMS, NUM_THREADS);  break;
+            }
+            uint64_t elapsed = bench_now() - start;
+            if (method == 3)
+                sprintf(name, "%-16s %s (%d threads)", Distributions[dist], methods[method], NUM_THREADS);
+            else
+                sprintf(name, "%-16s %s", Distributions[dist], methods[method]);
+            bench_report(name, NUM_ELEMS, elapsed);
+        }
+    }
+}
+
+static void bench_dbl(double* data) {
+    printf("  %d random doubles\n", NUM_ELEMS);
+    for (int method = 0; method < 3; method++) {
+        static const char* methods[] = { "qsort", "SORT_DEFINE introsort", "sort_radix_f64" };
+        uint64_t seed = 0x9E3779B97F4A7C15ull;
+        for (size_t i = 0; i < NUM_ELEMS; i++)
+            data[i] = ((double)(int64_t)bench_rand(&seed)) / 1e9;
+        uint64_t start = bench_now();
+        switch (method) {
+            case 0: qsort(data, NUM_ELEMS, sizeof(double), cmp_dbl); break;
+            case 1: dblsort_sort(data, NUM_ELEMS);                   break;
+            case 2: sort_radix_f64(data, NUM_ELEMS);                 break;
+        }
+        bench_report(methods[method], NUM_ELEMS, bench_now() - start);
+    }
+}
+
+BENCH_SUITE(Sort) {
+    void* data = malloc(NUM_ELEMS * sizeof(uint64_t));
+    bench_u64((uint64_t*)data);
+    bench_dbl((double*)data);
+    free(data);
+}
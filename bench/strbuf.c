@@ -0,0 +1,149 @@
+#include "bench.h"
+#include <stdc.h>
+#include <utf8.h>
+#include <strbuf.h>
+
+enum { NUM_TOKENS = 1 << 21 };
+
+/* The previous strbuf_add_char: calloc on the first char, realloc on every
+ * doubling and no inline storage */
+typedef struct {
+    size_t index;
+    size_t capacity;
+    char* string;
+} legacy_buf_t;
+
+static void legacy_add_char(legacy_buf_t* buf, char ch) {
+    if (buf->string == NULL) {
+        buf->capacity = 8u;
+        buf->string   = (char*)calloc(buf->capacity, 1u);
+    } else if (buf->index+1u >= buf->capacity) {
+        buf->capacity = buf->capacity << 1u;
+        buf->string   = (char*)realloc(buf->string, buf->capacity);
+    }
+    buf->string[buf->index++] = ch;
+    buf->string[buf->index]   = '\0';
+}
+
+static void legacy_add_string(legacy_buf_t* buf, const char* str) {
+    while (*str)
+        legacy_add_char(buf, *(str++));
+}
+
+static const char* Tokens[] = {
+    "x", "identifier", "0x7FFFFFFF", "return", "some_longer_identifier",
+    "(", "3.14159", "while", "a_rather_long_identifier_name_here", "+=",
+};
+
+/* Build each token a character at a time, as the lexer does, then drop it */
+static void bench_tokens(void) {
+    uintptr_t sink = 0;
+    uint64_t start;
+    printf("  %d lexer tokens built per char (mostly under %u bytes)\n", NUM_TOKENS, STRBUF_SMALL_SIZE);
+    start = bench_now();
+    for (size_t i = 0; i < NUM_TOKENS; i++) {
+        legacy_buf_t buf = { 0, 0, NULL };
+        for (const char* s = Tokens[i % nelem(Tokens)]; *s; s++)
+            legacy_add_char(&buf, *s);
+        sink += (uintptr_t)buf.string[0];
+        free(buf.string);
+    }
+    bench_report("legacy add_char", NUM_TOKENS, bench_now() - start);
+    start = bench_now();
+    for (size_t i = 0; i < NUM_TOKENS; i++) {
+        strbuf_t buf;
+        strbuf_reset(&buf);
+        for (const char* s = Tokens[i % nelem(Tokens)]; *s; s++)
+            strbuf_add_char(&buf, *s);
+        sink += (uintptr_t)strbuf_string(&buf)[0];
+        strbuf_deinit(&buf);
+    }
+    bench_report("strbuf_add_char (small buffer)", NUM_TOKENS, bench_now() - start);
+    Bench_Sink = sink;
+}
+
+/* Append whole strings into one large buffer */
+static void bench_append(void) {
+    uint64_t start;
+    size_t bytes = 0;
+    printf("  %d string appends into one buffer\n", NUM_TOKENS);
+    legacy_buf_t legacy = { 0, 0, NULL };
+    start = bench_now();
+    for (size_t i = 0; i < NUM_TOKENS; i++)
+        legacy_add_string(&legacy, Tokens[i % nelem(Tokens)]);
+    bench_report("legacy add_string", NUM_TOKENS, bench_now() - start);
+    bytes = legacy.index;
+    free(legacy.string);
+    strbuf_t buf;
+    strbuf_reset(&buf);
+    start = bench_now();
+    for (size_t i = 0; i < NUM_TOKENS; i++)
+        strbuf_add_string(&buf, (char*)Tokens[i % nelem(Tokens)]);
+    bench_report("strbuf_add_string", NUM_TOKENS, bench_now() - start);
+    strbuf_deinit(&buf);
+    strbuf_reset(&buf);
+    start = bench_now();
+    strbuf_reserve(&buf, bytes);
+    for (size_t i = 0; i < NUM_TOKENS; i++) {
+        const char* tok = Tokens[i % nelem(Tokens)];
+        strbuf_add_bytes(&buf, tok, strlen(tok));
+    }
+    bench_report("strbuf_reserve + strbuf_add_bytes", NUM_TOKENS, bench_now() - start);
+    Bench_Sink = buf.index;
+    strbuf_deinit(&buf);
+}
+
+/* Number formatting into one large CSV-like buffer */
+static void bench_format(void) {
+    char tmp[64];
+    uint64_t seed, start;
+    strbuf_t buf;
+    printf("  %d formatted appends\n", NUM_TOKENS);
+    for (int mode = 0; mode < 10; mode++) {
+        static const char* modes[] = {
+            "snprintf %llu + add_bytes", "strbuf_add_u64",
+            "snprintf %lld + add_bytes", "strbuf_add_i64",
+            "snprintf %.17g + add_bytes", "strbuf_add_double",
+            "smprintf + add_string + free", "strbuf_printf",
+            "snprintf %.17g + add_bytes (cents)", "strbuf_add_double (cents)",
+        };
+        seed = 0x9E3779B97F4A7C15ull;
+        strbuf_reset(&buf);
+        start = bench_now();
+        for (size_t i = 0; i < NUM_TOKENS; i++) {
+            uint64_t r = bench_rand(&seed);
+            /* Spread values across all digit counts */
+            uint64_t u = r >> (r & 63u);
+            int64_t  v = (int64_t)u * ((r & 64u) ? -1 : 1);
+            double   d = (double)(int64_t)r / (double)(1ull << (r & 31u));
+            double   c = (double)(r % 1000000u) / 100.0;
+            switch (mode) {
+                case 0: strbuf_add_bytes(&buf, tmp, (size_t)snprintf(tmp, sizeof(tmp), "%llu", (unsigned long long)u)); break;
+                case 1: strbuf_add_u64(&buf, u); break;
+                case 2: strbuf_add_bytes(&buf, tmp, (size_t)snprintf(tmp, sizeof(tmp), "%lld", (long long)v)); break;
+                case 3: strbuf_add_i64(&buf, v); break;
+                case 4: strbuf_add_bytes(&buf, tmp, (size_t)snprintf(tmp, sizeof(tmp), "%.17g", d)); break;
+                case 5: strbuf_add_double(&buf, d); break;
+                case 6: {
+                    char* str = smprintf("%llu,%s\n", (unsigned long long)u, "field");
+                    strbuf_add_string(&buf, str);
+                    free(str);
+                    break;
+                }
+                case 7: strbuf_printf(&buf, "%llu,%s\n", (unsigned long long)u, "field"); break;
+                case 8: strbuf_add_bytes(&buf, tmp, (size_t)snprintf(tmp, sizeof(tmp), "%.17g", c)); break;
+                case 9: strbuf_add_double(&buf, c); break;
+            }
+            strbuf_add_char(&buf, ',');
+        }
+        bench_report(modes[mode], NUM_TOKENS, bench_now() - start);
+        Bench_Sink = buf.index;
+        strbuf_deinit(&buf);
+    }
+}
+
+BENCH_SUITE(StrBuf) {
+    bench_tokens();
+    bench_append();
+    bench_format();
+}
@@ -0,0 +1,95 @@
+#include "bench.h"
+#include <stdc.h>
+#include <utf8.h>
+
+enum { INPUT_SIZE = 1 << 24 };
+
+/* Fill buf with text whose runes are drawn from the given ranges, with the
+ * percentage of each in weights */
+static size_t fill(char* buf, const Rune* lo, const Rune* hi, const uint* weights, size_t nranges) {
+    uint64_t seed = 0x2545F4914F6CDD1Dull;
+    size_t len = 0;
+    while (len + UTF_MAX < INPUT_SIZE) {
+        uint64_t r = bench_rand(&seed);
+        uint pick = (uint)(r % 100u);
+        size_t range = 0;
+        while ((range + 1) < nranges && pick >= weights[range])
+            pick -= weights[range++];
+        Rune rune = lo[range] + (Rune)((r >> 32) % (hi[range] - lo[range] + 1));
+        if (runevalid(rune))
+            len += utf8encode(buf + len, rune);
+    }
+    return len;
+}
+
+/* The byte at a time decoding these routines replace */
+static size_t decode_each(const char* buf, size_t len, Rune* out) {
+    size_t i = 0, count = 0;
+    while (i < len) {
+        Rune rune = 0;
+        size_t length = 0;
+        while (!utf8decode(&rune, &length, (i < len ? (uint8_t)buf[i++] : EOF)));
+        out[count++] = rune;
+    }
+    return count;
+}
+
+/* A literal U+FFFD also decodes as RUNE_ERR, so the whole input is walked
+ * rather than stopping at the first one */
+static bool validate_each(const char* buf, size_t len) {
+    size_t i = 0, errors = 0;
+    while (i < len) {
+        Rune rune = 0;
+        size_t length = 0;
+        while (!utf8decode(&rune, &length, (i < len ? (uint8_t)buf[i++] : EOF)));
+        errors += (rune == RUNE_ERR);
+    }
+    return (errors == 0);
+}
+
+static void run(const char* input, char* buf, size_t len, Rune* runes) {
+    char name[64];
+    uint64_t start;
+    uintptr_t sink = 0;
+
+    start = bench_now();
+    sink += validate_each(buf, len);
+    snprintf(name, sizeof(name), "%-8s validate, utf8decode per byte", input);
+    bench_report(name, len, bench_now() - start);
+
+    start = bench_now();
+    sink += utf8_validate(buf, len);
+    snprintf(name, sizeof(name), "%-8s utf8_validate", input);
+    bench_report(name, len, bench_now() - start);
+
+    start = bench_now();
+    sink += decode_each(buf, len, runes);
+    snprintf(name, sizeof(name), "%-8s decode, utf8decode per byte", input);
+    bench_report(name, len, bench_now() - start);
+
+    start = bench_now();
+    sink += utf8_decode_buf(buf, len, runes);
+    snprintf(name, sizeof(name), "%-8s utf8_decode_buf", input);
+    bench_report(name, len, bench_now() - start);
+    Bench_Sink = sink;
+}
+
+BENCH_SUITE(Utf8) {
+    static const Rune ascii_lo[] = { 0x20 },    ascii_hi[] = { 0x7E };
+    static const uint ascii_pct[] = { 100 };
+    static const Rune latin_lo[] = { 0x20, 0xA0 },  latin_hi[] = { 0x7E, 0x17F };
+    static const uint latin_pct[] = { 90, 10 };
+    static const Rune mixed_lo[] = { 0x20, 0x80, 0x800, 0x10000 }, mixed_hi[] = { 0x7E, 0x7FF, 0xFFFF, 0x10FFFF };
+    static const uint mixed_pct[] = { 50, 20, 20, 10 };
+    static const Rune cjk_lo[] = { 0x4E00 },    cjk_hi[] = { 0x9FFF };
+    static const uint cjk_pct[] = { 100 };
+    char* buf = (char*)emalloc(INPUT_SIZE);
+    Rune* runes = (Rune*)emalloc(INPUT_SIZE * sizeof(Rune));
+    printf("  %d byte inputs, ns and Mop/s per input byte\n", INPUT_SIZE);
+    run("ascii", buf, fill(buf, ascii_lo, ascii_hi, ascii_pct, 1), runes);
+    run("latin", buf, fill(buf, latin_lo, latin_hi, latin_pct, 2), runes);
+    run("mixed", buf, fill(buf, mixed_lo, mixed_hi, mixed_pct, 4), runes);
+    run("cjk", buf, fill(buf, cjk_lo, cjk_hi, cjk_pct, 1), runes);
+    free(runes);
+    free(buf);
+}
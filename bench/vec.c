@@ -0,0 +1,196 @@
+#include "bench.h"
+#include <stdc.h>
+#include <vec.h>
+
+enum { NUM_ELEMS = 1 << 22, NUM_SORT = 1 << 18, NUM_LARGE = 10000000, NUM_INSERTS = 100 };
+
+typedef struct {
+    uint64_t key;
+    uint64_t pad[7];
+} big_t;
+
+VEC_DEFINE(intvec, int)
+VEC_DEFINE(dblvec, double)
+VEC_DEFINE(bigvec, big_t)
+
+static int compare_int(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static int compare_dbl(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static int compare_big(const void* a, const void* b) {
+    uint64_t x = ((const big_t*)a)->key, y = ((const big_t*)b)->key;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static int make_int(uint64_t r) { return (int)(r >> 33); }
+static double make_dbl(uint64_t r) { return (double)(r >> 11) * 0x1.0p-53; }
+static big_t make_big(uint64_t r) { big_t b = { .key = r }; return b; }
+static uintptr_t sum_int(int v) { return (uintptr_t)v; }
+static uintptr_t sum_dbl(double v) { return (uintptr_t)(v * 1024.0); }
+static uintptr_t sum_big(big_t v) { return (uintptr_t)v.key; }
+
+/* Runs push_back, indexed reads and sort over both vec_t and the matching
+ * VEC_DEFINE vector for one element type */
+#define BENCH_VEC_TYPE(tvec, T, label, make, sum, cmp) \
+    static void bench_##tvec(void) { \
+        char name[128]; \
+        uint64_t seed, start; \
+        uintptr_t total; \
+        vec_t vec; \
+        tvec##_t typed; \
+        printf("  %s (%zu bytes)\n", label, sizeof(T)); \
+        /* push_back */ \
+        seed = 0x9E3779B97F4A7C15ull; \
+        vec_init(&vec, sizeof(T)); \
+        start = bench_now(); \
+        for (size_t i = 0; i < NUM_ELEMS; i++) { \
+            T v = make(bench_rand(&seed)); \
+            vec_push_back(&vec, &v); \
+        } \
+        sprintf(name, "vec_t push_back"); \
+        bench_report(name, NUM_ELEMS, bench_now() - start); \
+        seed = 0x9E3779B97F4A7C15ull; \
+        tvec##_init(&typed); \
+        start = bench_now(); \
+        for (size_t i = 0; i < NUM_ELEMS; i++) \
+            tvec##_push_back(&typed, make(bench_rand(&seed))); \
+        sprintf(name, "VEC_DEFINE push_back"); \
+        bench_report(name, NUM_ELEMS, bench_now() - start); \
+        /* at */ \
+        total = 0; \
+        start = bench_now(); \
+        for (size_t i = 0; i < NUM_ELEMS; i++) \
+            total += sum(*(T*)vec_at(&vec, i)); \
+        Bench_Sink = total; \
+        bench_report("vec_t at", NUM_ELEMS, bench_now() - start); \
+        total = 0; \
+        start = bench_now(); \
+        for (size_t i = 0; i < NUM_ELEMS; i++) \
+            total += sum(*tvec##_at(&typed, i)); \
+        Bench_Sink = total; \
+        bench_report("VEC_DEFINE at", NUM_ELEMS, bench_now() - start); \
+        /* sort */ \
+        T fill = make(0); \
+        vec_resize(&vec, NUM_SORT, &fill); \
+        tvec##_resize(&typed, NUM_SORT, fill); \
+        start = bench_now(); \
+        vec_sort(&vec, cmp); \
+        bench_report("vec_t sort", NUM_SORT, bench_now() - start); \
+        start = bench_now(); \
+        tvec##_sort(&typed, cmp); \
+        bench_report("VEC_DEFINE sort", NUM_SORT, bench_now() - start); \
+        free(vec.elem_buffer); \
+        tvec##_deinit(&typed); \
+    }
+
+BENCH_VEC_TYPE(intvec, int, "int", make_int, sum_int, compare_int)
+BENCH_VEC_TYPE(dblvec, double, "double", make_dbl, sum_dbl, compare_dbl)
+BENCH_VEC_TYPE(bigvec, big_t, "64-byte struct", make_big, sum_big, compare_big)
+
+/* The previous push_back, which called realloc on every push */
+static void legacy_push_back(vec_t* vec, void* data) {
+    vec_reserve(vec, vec_next_capacity(vec->elem_count + 2));
+    memcpy(&(vec->elem_buffer[vec->elem_count * vec->elem_size]), data, vec->elem_size);
+    vec->elem_count++;
+}
+
+static void bench_push(void) {
+    vec_t vec;
+    uint64_t start;
+    size_t reallocs, capacity;
+    printf("  push throughput, %d ints (growth %zu/%zu)\n", NUM_ELEMS, VEC_GROWTH_NUM, VEC_GROWTH_DEN);
+    for (int mode = 0; mode < 3; mode++) {
+        vec_init(&vec, sizeof(int));
+        reallocs = 0;
+        capacity = vec_capacity(&vec);
+        start = bench_now();
+        for (int i = 0; i < NUM_ELEMS; i++) {
+            if (mode == 0)
+                legacy_push_back(&vec, &i);
+            else if (mode == 1)
+                vec_push_back(&vec, &i);
+            else
+                *(int*)vec_emplace_back(&vec) = i;
+        }
+        uint64_t elapsed = bench_now() - start;
+        free(vec.elem_buffer);
+        /* Count capacity changes in a second, untimed pass */
+        vec_init(&vec, sizeof(int));
+        for (int i = 0; mode > 0 && i < NUM_ELEMS; i++) {
+            vec_push_back(&vec, &i);
+            reallocs += (vec_capacity(&vec) != capacity);
+            capacity = vec_capacity(&vec);
+        }
+        bench_report((mode == 0) ? "legacy push_back (realloc per push)" :
+                     (mode == 1) ? "vec_push_back" : "vec_emplace_back", NUM_ELEMS, elapsed);
+        if (mode == 0)
+            printf("      %d reallocs\n", NUM_ELEMS);
+        else
+            printf("      %zu reallocs\n", reallocs);
+        free(vec.elem_buffer);
+    }
+}
+
+static bool is_odd(void* elem, void* arg) {
+    (void)arg;
+    return (*(int*)elem & 1);
+}
+
+/* Mid-vector inserts on a 10M element vector, comparing the element by
+ * element shifting callers had to do before against vec_insert */
+static void bench_insert(void) {
+    vec_t vec;
+    int data[NUM_INSERTS];
+    uint64_t start;
+    printf("  mid-vector inserts into %d ints\n", NUM_LARGE);
+    vec_init(&vec, sizeof(int));
+    vec_reserve(&vec, NUM_LARGE + (4 * NUM_INSERTS));
+    for (int i = 0; i < NUM_LARGE; i++)
+        vec_append_range(&vec, &i, 1);
+    for (int i = 0; i < NUM_INSERTS; i++)
+        data[i] = -i;
+
+    start = bench_now();
+    for (int n = 0; n < 4; n++) {
+        size_t index = vec_size(&vec) / 2;
+        vec_push_back(&vec, &data[n]);
+        for (size_t i = vec_size(&vec) - 1; i > index; i--)
+            vec_set(&vec, i, vec_at(&vec, i - 1));
+        vec_set(&vec, index, &data[n]);
+    }
+    bench_report("shift with vec_set (per insert)", 4, bench_now() - start);
+
+    start = bench_now();
+    for (int n = 0; n < NUM_INSERTS; n++)
+        vec_insert(&vec, vec_size(&vec) / 2, 1, &data[n]);
+    bench_report("vec_insert (per insert)", NUM_INSERTS, bench_now() - start);
+
+    start = bench_now();
+    vec_insert_range(&vec, vec_size(&vec) / 2, data, NUM_INSERTS);
+    bench_report("vec_insert_range (per element)", NUM_INSERTS, bench_now() - start);
+
+    start = bench_now();
+    for (int n = 0; n < NUM_INSERTS; n++)
+        vec_erase(&vec, vec_size(&vec) / 2, vec_size(&vec) / 2);
+    bench_report("vec_erase (per erase)", NUM_INSERTS, bench_now() - start);
+
+    size_t count = vec_size(&vec);
+    start = bench_now();
+    vec_erase_if(&vec, is_odd, NULL);
+    bench_report("vec_erase_if odd (per element)", count, bench_now() - start);
+    free(vec.elem_buffer);
+}
+
+BENCH_SUITE(Vec) {
+    bench_intvec();
+    bench_dblvec();
+    bench_bigvec();
+    bench_push();
+    bench_insert();
+}
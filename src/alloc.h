@@ -0,0 +1,259 @@
+/**
+    Pluggable allocator interface with bump and size-class pool allocators.
+
+    Copyright 2017, Michael D. Lowis
+
+    Permission to use, copy, modify, and/or distribute this software
+    for any purpose with or without fee is hereby granted, provided
+    that the above copyright notice and this permission notice appear
+    in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+    WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+    AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+    DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA
+    OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+    TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+    PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Headers included before this one fall back to the C library on their own */
+#undef alloc_new
+#undef alloc_zero
+#undef alloc_resize
+#undef alloc_free
+
+/*
+    Containers that take an allocator_t call through it for every buffer they
+    own. A NULL allocator means plain malloc, realloc and free. Callers always
+    pass back the size of the block being resized or freed, so allocators do
+    not need to keep per-block headers.
+*/
+typedef struct allocator_t {
+    void* (*alloc)(struct allocator_t* a, size_t size);
+    void* (*realloc)(struct allocator_t* a, void* ptr, size_t oldsize, size_t newsize);
+    void (*free)(struct allocator_t* a, void* ptr, size_t size);
+} allocator_t;
+
+#ifndef ALLOC_ALIGN
+#define ALLOC_ALIGN (size_t)16
+#endif
+
+#define alloc_align_up(size, align) \
+    (((size) + ((align) - 1)) & ~((size_t)(align) - 1))
+
+static void* alloc_new(allocator_t* a, size_t size) {
+    return (a ? a->alloc(a, size) : malloc(size));
+}
+
+static void* alloc_zero(allocator_t* a, size_t size) {
+    if (a == NULL)
+        return calloc(1u, size);
+    void* ptr = a->alloc(a, size);
+    if (ptr != NULL)
+        memset(ptr, 0, size);
+    return ptr;
+}
+
+static void* alloc_resize(allocator_t* a, void* ptr, size_t oldsize, size_t newsize) {
+    return (a ? a->realloc(a, ptr, oldsize, newsize) : realloc(ptr, newsize));
+}
+
+static void alloc_free(allocator_t* a, void* ptr, size_t size) {
+    if (a)
+        a->free(a, ptr, size);
+    else
+        free(ptr);
+}
+
+/* Bump Allocator
+ *****************************************************************************
+ * Hands out memory from a caller supplied buffer by advancing an offset. Only
+ * the most recent allocation can be grown in place or given back; everything
+ * else is reclaimed at once by bump_reset. Allocations that do not fit return
+ * NULL.
+ */
+typedef struct {
+    allocator_t base;
+    uint8_t* buffer;
+    size_t size;
+    size_t used;
+    void* last;
+} bump_alloc_t;
+
+static void* bump_alloc(allocator_t* a, size_t size) {
+    bump_alloc_t* bump = (bump_alloc_t*)a;
+    size_t start = alloc_align_up(bump->used, ALLOC_ALIGN);
+    if ((start > bump->size) || (size > (bump->size - start)))
+        return NULL;
+    bump->used = start + size;
+    bump->last = &(bump->buffer[start]);
+    return bump->last;
+}
+
+static void* bump_realloc(allocator_t* a, void* ptr, size_t oldsize, size_t newsize) {
+    bump_alloc_t* bump = (bump_alloc_t*)a;
+    if (ptr == NULL)
+        return bump_alloc(a, newsize);
+    if ((ptr == bump->last) && (newsize <= (size_t)(&(bump->buffer[bump->size]) - (uint8_t*)ptr))) {
+        bump->used = (size_t)((uint8_t*)ptr - bump->buffer) + newsize;
+        return ptr;
+    }
+    if (newsize <= oldsize)
+        return ptr;
+    void* newptr = bump_alloc(a, newsize);
+    if (newptr != NULL)
+        memcpy(newptr, ptr, oldsize);
+    return newptr;
+}
+
+static void bump_free(allocator_t* a, void* ptr, size_t size) {
+    bump_alloc_t* bump = (bump_alloc_t*)a;
+    (void)size;
+    if ((ptr != NULL) && (ptr == bump->last)) {
+        bump->used = (size_t)((uint8_t*)ptr - bump->buffer);
+        bump->last = NULL;
+    }
+}
+
+static void bump_init(bump_alloc_t* bump, void* buffer, size_t size) {
+    bump->base.alloc   = bump_alloc;
+    bump->base.realloc = bump_realloc;
+    bump->base.free    = bump_free;
+    bump->buffer       = (uint8_t*)buffer;
+    bump->size         = size;
+    bump->used         = 0;
+    bump->last         = NULL;
+}
+
+static void bump_reset(bump_alloc_t* bump) {
+    bump->used = 0;
+    bump->last = NULL;
+}
+
+/* Size-Class Pool Allocator
+ *****************************************************************************
+ * Rounds requests up to a power of two between POOL_MIN_BLOCK and
+ * POOL_MAX_BLOCK and serves each class from its own free list, refilled a
+ * slab of POOL_SLAB_SIZE bytes at a time. Larger requests go straight to
+ * malloc. Freed blocks return to their class and slabs are only released by
+ * pool_deinit.
+ */
+#ifndef POOL_MIN_BLOCK
+#define POOL_MIN_BLOCK (size_t)16
+#endif
+
+#ifndef POOL_MAX_BLOCK
+#define POOL_MAX_BLOCK (size_t)4096
+#endif
+
+#ifndef POOL_SLAB_SIZE
+#define POOL_SLAB_SIZE (size_t)65536
+#endif
+
+#define POOL_NUM_CLASSES 16u
+
+typedef struct pool_block_t {
+    struct pool_block_t* next;
+} pool_block_t;
+
+typedef struct {
+    allocator_t base;
+    pool_block_t* free_lists[POOL_NUM_CLASSES];
+    pool_block_t* slabs;
+} pool_alloc_t;
+
+static unsigned int pool_class(size_t size) {
+    unsigned int cls = 0;
+    size_t block = POOL_MIN_BLOCK;
+    while (block < size) {
+        block <<= 1u;
+        cls++;
+    }
+    return cls;
+}
+
+static void* pool_alloc(allocator_t* a, size_t size) {
+    pool_alloc_t* pool = (pool_alloc_t*)a;
+    if (size > POOL_MAX_BLOCK)
+        return malloc(size);
+    unsigned int cls = pool_class(size);
+    if (pool->free_lists[cls] == NULL) {
+        /* Carve a fresh slab into blocks of this class. The first block of
+         * every slab links it into the list of slabs to release. */
+        size_t block = (POOL_MIN_BLOCK << cls);
+        uint8_t* slab = (uint8_t*)malloc(POOL_SLAB_SIZE);
+        if (slab == NULL)
+            return NULL;
+        ((pool_block_t*)slab)->next = pool->slabs;
+        pool->slabs = (pool_block_t*)slab;
+        for (size_t off = alloc_align_up(sizeof(pool_block_t), ALLOC_ALIGN); (off + block) <= POOL_SLAB_SIZE; off += block) {
+            pool_block_t* blk = (pool_block_t*)&(slab[off]);
+            blk->next = pool->free_lists[cls];
+            pool->free_lists[cls] = blk;
+        }
+    }
+    pool_block_t* blk = pool->free_lists[cls];
+    pool->free_lists[cls] = blk->next;
+    return blk;
+}
+
+static void pool_free(allocator_t* a, void* ptr, size_t size) {
+    pool_alloc_t* pool = (pool_alloc_t*)a;
+    if (ptr == NULL)
+        return;
+    if (size > POOL_MAX_BLOCK) {
+        free(ptr);
+    } else {
+        unsigned int cls = pool_class(size);
+        pool_block_t* blk = (pool_block_t*)ptr;
+        blk->next = pool->free_lists[cls];
+        pool->free_lists[cls] = blk;
+    }
+}
+
+static void* pool_realloc(allocator_t* a, void* ptr, size_t oldsize, size_t newsize) {
+    if (ptr == NULL)
+        return pool_alloc(a, newsize);
+    if ((oldsize > POOL_MAX_BLOCK) && (newsize > POOL_MAX_BLOCK))
+        return realloc(ptr, newsize);
+    if ((oldsize <= POOL_MAX_BLOCK) && (newsize <= POOL_MAX_BLOCK) && (pool_class(oldsize) == pool_class(newsize)))
+        return ptr;
+    void* newptr = pool_alloc(a, newsize);
+    if (newptr != NULL) {
+        memcpy(newptr, ptr, (oldsize < newsize ? oldsize : newsize));
+        pool_free(a, ptr, oldsize);
+    }
+    return newptr;
+}
+
+static void pool_init(pool_alloc_t* pool) {
+    pool->base.alloc   = pool_alloc;
+    pool->base.realloc = pool_realloc;
+    pool->base.free    = pool_free;
+    for (unsigned int i = 0; i < POOL_NUM_CLASSES; i++)
+        pool->free_lists[i] = NULL;
+    pool->slabs = NULL;
+}
+
+/* Release every slab. Blocks larger than POOL_MAX_BLOCK must already have
+ * been freed as they come from malloc directly. */
+static void pool_deinit(pool_alloc_t* pool) {
+    while (pool->slabs != NULL) {
+        pool_block_t* slab = pool->slabs;
+        pool->slabs = slab->next;
+        free(slab);
+    }
+    for (unsigned int i = 0; i < POOL_NUM_CLASSES; i++)
+        pool->free_lists[i] = NULL;
+}
+
+#endif /* ALLOC_H */
@@ -0,0 +1,288 @@
+/**
+    Chunked arena (region) allocator.
+
+    Copyright 2017, Michael D. Lowis
+
+    Permission to use, copy, modify, and/or distribute this software
+    for any purpose with or without fee is hereby granted, provided
+    that the above copyright notice and this permission notice appear
+    in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+    WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+    AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+    DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA
+    OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+    TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+    PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef ARENA_H
+#define ARENA_H
+
+/*
+    NOTE: This file depends on stdc.h, whose fatal() is called when a chunk
+    cannot be allocated, just like the e-alloc helpers there.
+
+    Allocations are bumped out of a list of chunks. Nothing is freed
+    individually: arena_reset releases everything at once and arena_release
+    rewinds to an earlier arena_mark, both in constant time. Chunks are kept
+    after a reset and reused by later allocations, so a long running loop that
+    resets once per iteration settles into making no heap calls at all.
+    Requests larger than the chunk size get a chunk of their own.
+*/
+
+#ifndef ARENA_CHUNK_SIZE
+#define ARENA_CHUNK_SIZE (size_t)65536
+#endif
+
+#ifndef ARENA_ALIGN
+#define ARENA_ALIGN (size_t)16
+#endif
+
+typedef struct arena_chunk_t {
+    struct arena_chunk_t* next;
+    size_t size;
+    size_t used;
+} arena_chunk_t;
+
+typedef struct {
+    arena_chunk_t* first;
+    arena_chunk_t* current;
+    size_t chunk_size;
+    size_t allocated;
+    size_t high_water;
+    void* last;
+} arena_t;
+
+typedef struct {
+    arena_chunk_t* chunk;
+    size_t used;
+    size_t allocated;
+} arena_mark_t;
+
+/* Chunk data starts after the header, rounded up to keep it aligned */
+#define ARENA_HEADER_SIZE \
+    ((sizeof(arena_chunk_t) + (ARENA_ALIGN - 1)) & ~(ARENA_ALIGN - 1))
+
+static uint8_t* arena_chunk_data(arena_chunk_t* chunk) {
+    return ((uint8_t*)chunk + ARENA_HEADER_SIZE);
+}
+
+static arena_chunk_t* arena_chunk_new(size_t size) {
+    arena_chunk_t* chunk = (arena_chunk_t*)emalloc(ARENA_HEADER_SIZE + size);
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+static void arena_init(arena_t* arena, size_t chunk_size) {
+    arena->chunk_size = (chunk_size ? chunk_size : ARENA_CHUNK_SIZE);
+    arena->first      = arena_chunk_new(arena->chunk_size);
+    arena->current    = arena->first;
+    arena->allocated  = 0;
+    arena->high_water = 0;
+    arena->last       = NULL;
+}
+
+static void arena_deinit(arena_t* arena) {
+    while (arena->first != NULL) {
+        arena_chunk_t* chunk = arena->first;
+        arena->first = chunk->next;
+        free(chunk);
+    }
+    arena->current = NULL;
+}
+
+/* Offset into chunk at which an allocation of size bytes aligned to align
+ * would start, or SIZE_MAX if it does not fit */
+static size_t arena_fit(arena_chunk_t* chunk, size_t size, size_t align) {
+    uintptr_t base  = (uintptr_t)arena_chunk_data(chunk);
+    uintptr_t start = (base + chunk->used + (align - 1)) & ~((uintptr_t)align - 1);
+    size_t offset   = (size_t)(start - base);
+    if ((offset > chunk->size) || (size > (chunk->size - offset)))
+        return SIZE_MAX;
+    return offset;
+}
+
+/* Allocate size bytes aligned to align, which must be a power of two */
+static void* arena_alloc_aligned(arena_t* arena, size_t size, size_t align) {
+    arena_chunk_t* chunk = arena->current;
+    size_t offset = arena_fit(chunk, size, align);
+    if (offset == SIZE_MAX) {
+        /* Move on to the next retained chunk or link in a new one after the
+         * current chunk, big enough for the request if need be */
+        arena_chunk_t* next = chunk->next;
+        if (next != NULL) {
+            next->used = 0;
+            offset = arena_fit(next, size, align);
+        }
+        if (offset == SIZE_MAX) {
+            size_t need = size + align;
+            next = arena_chunk_new(need > arena->chunk_size ? need : arena->chunk_size);
+            next->next  = chunk->next;
+            chunk->next = next;
+            offset = arena_fit(next, size, align);
+        }
+        arena->allocated += chunk->size - chunk->used;
+        arena->current = chunk = next;
+    }
+    arena->allocated += (offset - chunk->used) + size;
+    if (arena->allocated > arena->high_water)
+        arena->high_water = arena->allocated;
+    chunk->used = offset + size;
+    arena->last = arena_chunk_data(chunk) + offset;
+    return arena->last;
+}
+
+static void* arena_alloc(arena_t* arena, size_t size) {
+    return arena_alloc_aligned(arena, size, ARENA_ALIGN);
+}
+
+static void* arena_calloc(arena_t* arena, size_t num, size_t size) {
+    void* ptr = arena_alloc(arena, num * size);
+    memset(ptr, 0, num * size);
+    return ptr;
+}
+
+/* Resize a block from this arena. The most recent allocation is grown or
+ * shrunk in place when it fits; any other block is copied. */
+static void* arena_realloc(arena_t* arena, void* ptr, size_t oldsize, size_t newsize) {
+    if (ptr == NULL)
+        return arena_alloc(arena, newsize);
+    if (ptr == arena->last) {
+        arena_chunk_t* chunk = arena->current;
+        size_t offset = (size_t)((uint8_t*)ptr - arena_chunk_data(chunk));
+        if (newsize <= (chunk->size - offset)) {
+            arena->allocated = arena->allocated - (chunk->used - offset) + newsize;
+            if (arena->allocated > arena->high_water)
+                arena->high_water = arena->allocated;
+            chunk->used = offset + newsize;
+            return ptr;
+        }
+    } else if (newsize <= oldsize) {
+        return ptr;
+    }
+    void* newptr = arena_alloc(arena, newsize);
+    memcpy(newptr, ptr, (oldsize < newsize ? oldsize : newsize));
+    return newptr;
+}
+
+static arena_mark_t arena_mark(arena_t* arena) {
+    arena_mark_t mark = { arena->current, arena->current->used, arena->allocated };
+    return mark;
+}
+
+/* Free everything allocated since the mark was taken */
+static void arena_release(arena_t* arena, arena_mark_t mark) {
+    arena->current       = mark.chunk;
+    arena->current->used = mark.used;
+    arena->allocated     = mark.allocated;
+    arena->last          = NULL;
+}
+
+/* Free everything allocated from the arena, keeping its chunks for reuse */
+static void arena_reset(arena_t* arena) {
+    arena->current     = arena->first;
+    arena->first->used = 0;
+    arena->allocated   = 0;
+    arena->last        = NULL;
+}
+
+/* Bytes handed out since the last reset, including alignment padding */
+static size_t arena_allocated(arena_t* arena) {
+    return arena->allocated;
+}
+
+/* The most bytes that were ever allocated at once */
+static size_t arena_high_water(arena_t* arena) {
+    return arena->high_water;
+}
+
+/* Arena Backed Helpers
+ *****************************************************************************/
+/* Allocate a duplicate copy of the string in the arena */
+static char* arena_strdup(arena_t* arena, const char* s) {
+    size_t len = strlen(s) + 1;
+    return (char*)memcpy(arena_alloc_aligned(arena, len, 1), s, len);
+}
+
+static char* arena_vsmprintf(arena_t* arena, const char* fmt, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    int strsz = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+    char* str = (char*)arena_alloc_aligned(arena, (size_t)strsz + 1, 1);
+    vsnprintf(str, (size_t)strsz + 1, fmt, args);
+    return str;
+}
+
+/* Print to a string allocated in the arena */
+static char* arena_smprintf(arena_t* arena, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    char* str = arena_vsmprintf(arena, fmt, args);
+    va_end(args);
+    return str;
+}
+
+/* Read an entire line of data from the provided file into a string allocated
+ * in the arena. The string grows in place as nothing else is allocated while
+ * reading. Returns NULL once the file is at EOF. */
+static char* arena_freadline(arena_t* arena, FILE* input) {
+    size_t size  = 8;
+    size_t index = 0;
+    if (feof(input))
+        return NULL;
+    char* str = (char*)arena_alloc_aligned(arena, size, 1);
+    str[0] = '\0';
+    while (true) {
+        int ch = fgetc(input);
+        if (ch == EOF) break;
+        str[index++] = (char)ch;
+        str[index]   = '\0';
+        if (index+1 >= size) {
+            str  = (char*)arena_realloc(arena, str, size, size << 1);
+            size = size << 1;
+        }
+        if (ch == '\n') break;
+    }
+    return str;
+}
+
+/* Allocator Adapter
+ *****************************************************************************
+ * When alloc.h is included first, an arena can be handed to any container
+ * that takes an allocator_t. Frees only reclaim the most recent block.
+ */
+#ifdef ALLOC_H
+typedef struct {
+    allocator_t base;
+    arena_t* arena;
+} arena_allocator_t;
+
+static void* arena_allocator_alloc(allocator_t* a, size_t size) {
+    return arena_alloc(((arena_allocator_t*)a)->arena, size);
+}
+
+static void* arena_allocator_realloc(allocator_t* a, void* ptr, size_t oldsize, size_t newsize) {
+    return arena_realloc(((arena_allocator_t*)a)->arena, ptr, oldsize, newsize);
+}
+
+static void arena_allocator_free(allocator_t* a, void* ptr, size_t size) {
+    arena_t* arena = ((arena_allocator_t*)a)->arena;
+    if ((ptr != NULL) && (ptr == arena->last))
+        arena_realloc(arena, ptr, size, 0);
+}
+
+static allocator_t* arena_allocator(arena_allocator_t* adapter, arena_t* arena) {
+    adapter->base.alloc   = arena_allocator_alloc;
+    adapter->base.realloc = arena_allocator_realloc;
+    adapter->base.free    = arena_allocator_free;
+    adapter->arena        = arena;
+    return &(adapter->base);
+}
+#endif
+
+#endif /* ARENA_H */
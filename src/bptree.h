@@ -0,0 +1,512 @@
+/**
+    Cache-conscious in-memory B+tree.
+
+    Copyright 2017, Michael D. Lowis
+
+    Permission to use, copy, modify, and/or distribute this software
+    for any purpose with or without fee is hereby granted, provided
+    that the above copyright notice and this permission notice appear
+    in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+    WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+    AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+    DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA
+    OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+    TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+    PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef BPTREE_H
+#define BPTREE_H
+
+/*
+    NOTE: This file depends on stdc.h and arena.h.
+
+    A bptree_t maps keys to void* values. Every node holds up to
+    BPTREE_NODE_KEYS keys in one contiguous array at the start of the node,
+    and nodes are aligned to cache lines, so searching a node reads a couple
+    of adjacent lines instead of chasing a pointer per comparison as bstree_t
+    does. Values live only in the leaves, which are linked in key order for
+    range scans.
+
+    Trees set up with bptree_init order keys, which are pointers to caller
+    owned data, with a comparator and binary search each node. Trees set up
+    with bptree_init_int store int64_t keys inline and search each node with
+    SIMD compares when built with SSE4.2 or AVX2 enabled, or with a branchless
+    scan otherwise.
+
+    Nodes come from an arena owned by the tree and are only released by
+    bptree_deinit. Deletes remove the key from its leaf without merging
+    nodes, so a tree keeps its shape, and its memory, after keys are deleted.
+*/
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#ifndef BPTREE_NODE_KEYS
+#define BPTREE_NODE_KEYS 16u
+#endif
+
+#ifndef BPTREE_CACHE_LINE
+#define BPTREE_CACHE_LINE (size_t)64
+#endif
+
+/* Deep enough for any tree addressable with 64-bit sizes */
+#define BPTREE_MAX_DEPTH 64u
+
+typedef union {
+    int64_t i;
+    const void* p;
+} bptree_key_t;
+
+typedef int (*bptree_cmpfn_t)(const void* a, const void* b);
+
+typedef struct {
+    bptree_key_t keys[BPTREE_NODE_KEYS];
+    uint32_t count;
+    uint32_t leaf;
+} bptree_node_t;
+
+/* children[i] holds keys below keys[i] and at or above keys[i-1] */
+typedef struct {
+    bptree_node_t node;
+    bptree_node_t* children[BPTREE_NODE_KEYS + 1];
+} bptree_inner_t;
+
+typedef struct bptree_leaf_t {
+    bptree_node_t node;
+    void* values[BPTREE_NODE_KEYS];
+    struct bptree_leaf_t* next;
+} bptree_leaf_t;
+
+typedef struct {
+    bptree_node_t* root;
+    bptree_leaf_t* first;
+    bptree_cmpfn_t cmpfn;
+    size_t count;
+    arena_t arena;
+} bptree_t;
+
+typedef struct {
+    bptree_leaf_t* leaf;
+    size_t index;
+} bptree_iter_t;
+
+static void bptree_init(bptree_t* tree, bptree_cmpfn_t cmpfn) {
+    tree->root  = NULL;
+    tree->first = NULL;
+    tree->cmpfn = cmpfn;
+    tree->count = 0;
+    arena_init(&(tree->arena), 0);
+}
+
+static void bptree_init_int(bptree_t* tree) {
+    bptree_init(tree, NULL);
+}
+
+static void bptree_deinit(bptree_t* tree) {
+    arena_deinit(&(tree->arena));
+    tree->root  = NULL;
+    tree->first = NULL;
+    tree->count = 0;
+}
+
+static size_t bptree_size(bptree_t* tree) {
+    return tree->count;
+}
+
+static bool bptree_empty(bptree_t* tree) {
+    return (tree->count == 0);
+}
+
+/* Node Search
+ *****************************************************************************/
+#if defined(__AVX2__) || defined(__SSE4_2__)
+/* Keys are sorted, so each compare mask is a run of ones from the bottom and
+ * the scan can stop at the first mask that is not full */
+static const uint8_t BPTree_MaskCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+#endif
+
+/* Number of keys that are less than key, or not greater than key if upper */
+static size_t bptree_rank_int(const bptree_key_t* keys, size_t count, int64_t key, bool upper) {
+    size_t rank = 0, i = 0;
+#if defined(__AVX2__)
+    __m256i needle = _mm256_set1_epi64x(key);
+    for (; (i + 4) <= count; i += 4) {
+        __m256i vals = _mm256_loadu_si256((const __m256i*)&keys[i]);
+        __m256i gt   = (upper ? _mm256_cmpgt_epi64(vals, needle) : _mm256_cmpgt_epi64(needle, vals));
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(gt));
+        if (upper)
+            mask = ~mask & 0xF;
+        rank += BPTree_MaskCount[mask];
+        if (mask != 0xF)
+            return rank;
+    }
+#elif defined(__SSE4_2__)
+    __m128i needle = _mm_set1_epi64x(key);
+    for (; (i + 2) <= count; i += 2) {
+        __m128i vals = _mm_loadu_si128((const __m128i*)&keys[i]);
+        __m128i gt   = (upper ? _mm_cmpgt_epi64(vals, needle) : _mm_cmpgt_epi64(needle, vals));
+        int mask = _mm_movemask_pd(_mm_castsi128_pd(gt));
+        if (upper)
+            mask = ~mask & 0x3;
+        rank += BPTree_MaskCount[mask];
+        if (mask != 0x3)
+            return rank;
+    }
+#endif
+    if (upper) {
+        for (; i < count; i++)
+            rank += (keys[i].i <= key);
+    } else {
+        for (; i < count; i++)
+            rank += (keys[i].i < key);
+    }
+    return rank;
+}
+
+static size_t bptree_rank(bptree_t* tree, bptree_node_t* node, bptree_key_t key, bool upper) {
+    if (tree->cmpfn == NULL)
+        return bptree_rank_int(node->keys, node->count, key.i, upper);
+    size_t lo = 0, hi = node->count;
+    while (lo < hi) {
+        size_t mid = lo + ((hi - lo) / 2);
+        int cmp = tree->cmpfn(node->keys[mid].p, key.p);
+        if ((cmp < 0) || (upper && (cmp == 0)))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static bool bptree_equal(bptree_t* tree, bptree_key_t a, bptree_key_t b) {
+    return (tree->cmpfn ? (tree->cmpfn(a.p, b.p) == 0) : (a.i == b.i));
+}
+
+/* Descend to the leaf that would hold key */
+static bptree_leaf_t* bptree_find_leaf(bptree_t* tree, bptree_key_t key) {
+    bptree_node_t* node = tree->root;
+    while ((node != NULL) && !node->leaf)
+        node = ((bptree_inner_t*)node)->children[bptree_rank(tree, node, key, true)];
+    return (bptree_leaf_t*)node;
+}
+
+static void** bptree_lookup_key(bptree_t* tree, bptree_key_t key) {
+    bptree_leaf_t* leaf = bptree_find_leaf(tree, key);
+    if (leaf == NULL)
+        return NULL;
+    size_t index = bptree_rank(tree, &(leaf->node), key, false);
+    if ((index < leaf->node.count) && bptree_equal(tree, leaf->node.keys[index], key))
+        return &(leaf->values[index]);
+    return NULL;
+}
+
+/* Return a pointer to the value stored for key, or NULL if it is absent */
+static void** bptree_lookup(bptree_t* tree, const void* key) {
+    bptree_key_t k = { .p = key };
+    return bptree_lookup_key(tree, k);
+}
+
+static void** bptree_lookup_int(bptree_t* tree, int64_t key) {
+    bptree_key_t k = { .i = key };
+    return bptree_lookup_key(tree, k);
+}
+
+/* Insertion
+ *****************************************************************************/
+static bptree_leaf_t* bptree_new_leaf(bptree_t* tree) {
+    bptree_leaf_t* leaf = (bptree_leaf_t*)arena_alloc_aligned(&(tree->arena), sizeof(bptree_leaf_t), BPTREE_CACHE_LINE);
+    leaf->node.count = 0;
+    leaf->node.leaf  = true;
+    leaf->next       = NULL;
+    return leaf;
+}
+
+static bptree_inner_t* bptree_new_inner(bptree_t* tree) {
+    bptree_inner_t* inner = (bptree_inner_t*)arena_alloc_aligned(&(tree->arena), sizeof(bptree_inner_t), BPTREE_CACHE_LINE);
+    inner->node.count = 0;
+    inner->node.leaf  = false;
+    return inner;
+}
+
+/* Insert key and value at index in a leaf that has room */
+static void bptree_leaf_insert(bptree_leaf_t* leaf, size_t index, bptree_key_t key, void* value) {
+    size_t move = leaf->node.count - index;
+    memmove(&(leaf->node.keys[index + 1]), &(leaf->node.keys[index]), move * sizeof(bptree_key_t));
+    memmove(&(leaf->values[index + 1]), &(leaf->values[index]), move * sizeof(void*));
+    leaf->node.keys[index] = key;
+    leaf->values[index]    = value;
+    leaf->node.count++;
+}
+
+/* Insert key and the child to its right at index in an inner node that has
+ * room */
+static void bptree_inner_insert(bptree_inner_t* inner, size_t index, bptree_key_t key, bptree_node_t* child) {
+    size_t move = inner->node.count - index;
+    memmove(&(inner->node.keys[index + 1]), &(inner->node.keys[index]), move * sizeof(bptree_key_t));
+    memmove(&(inner->children[index + 2]), &(inner->children[index + 1]), move * sizeof(bptree_node_t*));
+    inner->node.keys[index]   = key;
+    inner->children[index + 1] = child;
+    inner->node.count++;
+}
+
+/* Move the upper half of a full leaf into a new leaf linked after it */
+static bptree_leaf_t* bptree_split_leaf(bptree_t* tree, bptree_leaf_t* leaf) {
+    bptree_leaf_t* right = bptree_new_leaf(tree);
+    size_t keep = BPTREE_NODE_KEYS / 2;
+    right->node.count = BPTREE_NODE_KEYS - keep;
+    memcpy(right->node.keys, &(leaf->node.keys[keep]), right->node.count * sizeof(bptree_key_t));
+    memcpy(right->values, &(leaf->values[keep]), right->node.count * sizeof(void*));
+    leaf->node.count = keep;
+    right->next = leaf->next;
+    leaf->next  = right;
+    return right;
+}
+
+/* Move the upper half of a full inner node into a new node, returning the
+ * middle key that separates them through sep */
+static bptree_inner_t* bptree_split_inner(bptree_t* tree, bptree_inner_t* inner, bptree_key_t* sep) {
+    bptree_inner_t* right = bptree_new_inner(tree);
+    size_t keep = BPTREE_NODE_KEYS / 2;
+    *sep = inner->node.keys[keep];
+    right->node.count = BPTREE_NODE_KEYS - keep - 1;
+    memcpy(right->node.keys, &(inner->node.keys[keep + 1]), right->node.count * sizeof(bptree_key_t));
+    memcpy(right->children, &(inner->children[keep + 1]), (right->node.count + 1) * sizeof(bptree_node_t*));
+    inner->node.count = keep;
+    return right;
+}
+
+static bool bptree_insert_key(bptree_t* tree, bptree_key_t key, void* value) {
+    bptree_inner_t* path[BPTREE_MAX_DEPTH];
+    size_t slots[BPTREE_MAX_DEPTH];
+    size_t depth = 0;
+    if (tree->root == NULL) {
+        tree->first = bptree_new_leaf(tree);
+        tree->root  = &(tree->first->node);
+    }
+    /* Walk down to the leaf, remembering the path taken */
+    bptree_node_t* node = tree->root;
+    while (!node->leaf) {
+        path[depth]  = (bptree_inner_t*)node;
+        slots[depth] = bptree_rank(tree, node, key, true);
+        node = path[depth]->children[slots[depth]];
+        depth++;
+    }
+    bptree_leaf_t* leaf = (bptree_leaf_t*)node;
+    size_t index = bptree_rank(tree, &(leaf->node), key, false);
+    if ((index < leaf->node.count) && bptree_equal(tree, leaf->node.keys[index], key)) {
+        leaf->values[index] = value;
+        return false;
+    }
+    tree->count++;
+    if (leaf->node.count < BPTREE_NODE_KEYS) {
+        bptree_leaf_insert(leaf, index, key, value);
+        return true;
+    }
+
+    /* Split the leaf and push the separator up until a node has room */
+    bptree_leaf_t* right = bptree_split_leaf(tree, leaf);
+    if (index <= leaf->node.count)
+        bptree_leaf_insert(leaf, index, key, value);
+    else
+        bptree_leaf_insert(right, index - leaf->node.count, key, value);
+    bptree_key_t sep = right->node.keys[0];
+    bptree_node_t* child = &(right->node);
+    while (depth > 0) {
+        depth--;
+        bptree_inner_t* parent = path[depth];
+        size_t slot = slots[depth];
+        if (parent->node.count < BPTREE_NODE_KEYS) {
+            bptree_inner_insert(parent, slot, sep, child);
+            return true;
+        }
+        bptree_key_t up;
+        bptree_inner_t* sibling = bptree_split_inner(tree, parent, &up);
+        if (slot <= parent->node.count)
+            bptree_inner_insert(parent, slot, sep, child);
+        else
+            bptree_inner_insert(sibling, slot - parent->node.count - 1, sep, child);
+        sep   = up;
+        child = &(sibling->node);
+    }
+
+    /* The root split, so grow the tree by a level */
+    bptree_inner_t* root = bptree_new_inner(tree);
+    root->node.count  = 1;
+    root->node.keys[0] = sep;
+    root->children[0] = tree->root;
+    root->children[1] = child;
+    tree->root = &(root->node);
+    return true;
+}
+
+/* Map key to value, replacing the value if key is already present. Returns
+ * true if the key was added. */
+static bool bptree_insert(bptree_t* tree, const void* key, void* value) {
+    bptree_key_t k = { .p = key };
+    return bptree_insert_key(tree, k, value);
+}
+
+static bool bptree_insert_int(bptree_t* tree, int64_t key, void* value) {
+    bptree_key_t k = { .i = key };
+    return bptree_insert_key(tree, k, value);
+}
+
+/* Deletion
+ *****************************************************************************/
+static bool bptree_delete_key(bptree_t* tree, bptree_key_t key) {
+    bptree_leaf_t* leaf = bptree_find_leaf(tree, key);
+    if (leaf == NULL)
+        return false;
+    size_t index = bptree_rank(tree, &(leaf->node), key, false);
+    if ((index >= leaf->node.count) || !bptree_equal(tree, leaf->node.keys[index], key))
+        return false;
+    size_t move = leaf->node.count - index - 1;
+    memmove(&(leaf->node.keys[index]), &(leaf->node.keys[index + 1]), move * sizeof(bptree_key_t));
+    memmove(&(leaf->values[index]), &(leaf->values[index + 1]), move * sizeof(void*));
+    leaf->node.count--;
+    tree->count--;
+    return true;
+}
+
+/* Remove key from its leaf. Returns false if it was not present. */
+static bool bptree_delete(bptree_t* tree, const void* key) {
+    bptree_key_t k = { .p = key };
+    return bptree_delete_key(tree, k);
+}
+
+static bool bptree_delete_int(bptree_t* tree, int64_t key) {
+    bptree_key_t k = { .i = key };
+    return bptree_delete_key(tree, k);
+}
+
+/* Bulk Loading
+ *****************************************************************************/
+/* Build the tree bottom up from count keys in ascending order with no
+ * duplicates. Nodes are filled completely, with the remainder spread over
+ * the first nodes of each level, so the tree is as shallow as possible.
+ * Values may be NULL to store NULL for every key. The tree must be empty. */
+static void bptree_bulk_load_keys(bptree_t* tree, const void* keys, void** values, size_t count) {
+    assert(tree->root == NULL);
+    if (count == 0)
+        return;
+    size_t nnodes = (count + BPTREE_NODE_KEYS - 1) / BPTREE_NODE_KEYS;
+    bptree_node_t** nodes = (bptree_node_t**)emalloc(nnodes * sizeof(bptree_node_t*));
+    bptree_key_t* mins    = (bptree_key_t*)emalloc(nnodes * sizeof(bptree_key_t));
+    bptree_leaf_t* prev   = NULL;
+    size_t next = 0;
+    for (size_t n = 0; n < nnodes; n++) {
+        bptree_leaf_t* leaf = bptree_new_leaf(tree);
+        size_t take = (count / nnodes) + (n < (count % nnodes));
+        for (size_t i = 0; i < take; i++, next++) {
+            if (tree->cmpfn == NULL)
+                leaf->node.keys[i].i = ((const int64_t*)keys)[next];
+            else
+                leaf->node.keys[i].p = ((const void* const*)keys)[next];
+            leaf->values[i] = (values ? values[next] : NULL);
+        }
+        leaf->node.count = take;
+        if (prev != NULL)
+            prev->next = leaf;
+        else
+            tree->first = leaf;
+        prev     = leaf;
+        nodes[n] = &(leaf->node);
+        mins[n]  = leaf->node.keys[0];
+    }
+
+    /* Group each level's nodes under parents until a single root is left */
+    while (nnodes > 1) {
+        size_t nparents = (nnodes + BPTREE_NODE_KEYS) / (BPTREE_NODE_KEYS + 1);
+        size_t child = 0;
+        for (size_t n = 0; n < nparents; n++) {
+            bptree_inner_t* inner = bptree_new_inner(tree);
+            size_t take = (nnodes / nparents) + (n < (nnodes % nparents));
+            bptree_key_t min = mins[child];
+            for (size_t i = 0; i < take; i++, child++) {
+                inner->children[i] = nodes[child];
+                if (i > 0)
+                    inner->node.keys[i - 1] = mins[child];
+            }
+            inner->node.count = take - 1;
+            nodes[n] = &(inner->node);
+            mins[n]  = min;
+        }
+        nnodes = nparents;
+    }
+    tree->root  = nodes[0];
+    tree->count = count;
+    free(mins);
+    free(nodes);
+}
+
+static void bptree_bulk_load(bptree_t* tree, const void** keys, void** values, size_t count) {
+    assert(tree->cmpfn != NULL);
+    bptree_bulk_load_keys(tree, keys, values, count);
+}
+
+static void bptree_bulk_load_int(bptree_t* tree, const int64_t* keys, void** values, size_t count) {
+    assert(tree->cmpfn == NULL);
+    bptree_bulk_load_keys(tree, keys, values, count);
+}
+
+/* Range Scans
+ *****************************************************************************/
+/* Move past the end of emptied leaves */
+static void bptree_iter_skip(bptree_iter_t* iter) {
+    while ((iter->leaf != NULL) && (iter->index >= iter->leaf->node.count)) {
+        iter->leaf  = iter->leaf->next;
+        iter->index = 0;
+    }
+}
+
+/* Position iter at the smallest key */
+static void bptree_begin(bptree_t* tree, bptree_iter_t* iter) {
+    iter->leaf  = tree->first;
+    iter->index = 0;
+    bptree_iter_skip(iter);
+}
+
+static void bptree_seek_key(bptree_t* tree, bptree_key_t key, bptree_iter_t* iter) {
+    iter->leaf  = bptree_find_leaf(tree, key);
+    iter->index = (iter->leaf ? bptree_rank(tree, &(iter->leaf->node), key, false) : 0);
+    bptree_iter_skip(iter);
+}
+
+/* Position iter at the smallest key not less than key */
+static void bptree_seek(bptree_t* tree, const void* key, bptree_iter_t* iter) {
+    bptree_key_t k = { .p = key };
+    bptree_seek_key(tree, k, iter);
+}
+
+static void bptree_seek_int(bptree_t* tree, int64_t key, bptree_iter_t* iter) {
+    bptree_key_t k = { .i = key };
+    bptree_seek_key(tree, k, iter);
+}
+
+static bool bptree_iter_valid(bptree_iter_t* iter) {
+    return (iter->leaf != NULL);
+}
+
+static void bptree_iter_next(bptree_iter_t* iter) {
+    iter->index++;
+    bptree_iter_skip(iter);
+}
+
+static const void* bptree_iter_key(bptree_iter_t* iter) {
+    return iter->leaf->node.keys[iter->index].p;
+}
+
+static int64_t bptree_iter_key_int(bptree_iter_t* iter) {
+    return iter->leaf->node.keys[iter->index].i;
+}
+
+static void* bptree_iter_value(bptree_iter_t* iter) {
+    return iter->leaf->values[iter->index];
+}
+
+#endif /* BPTREE_H */
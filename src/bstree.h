@@ -18,9 +18,25 @@
     PERFORMANCE OF THIS SOFTWARE.
 */
 
+/*
+    NOTE: Trees set up with bstree_init_balanced are kept balanced as red-black
+    trees, so lookups, inserts and deletes stay O(log n) even when keys arrive
+    in sorted order. Every node records its parent, with the node color packed
+    into the low bit of the parent pointer, which is free as nodes are always
+    at least pointer aligned.
+
+    Define BSTREE_SUBTREE_SIZES before including this file to also keep the
+    size of the subtree rooted at each node. That costs a word per node and a
+    walk up to the root on insert and delete, and provides bstree_rank and
+    bstree_select in O(log n) on balanced trees.
+*/
 typedef struct bstree_node_t {
     struct bstree_node_t* left;
     struct bstree_node_t* right;
+    uintptr_t parent_color;
+#ifdef BSTREE_SUBTREE_SIZES
+    size_t size;
+#endif
 } bstree_node_t;
 
 typedef int (*bstree_cmpfn_t)(bstree_node_t* a, bstree_node_t* b);
@@ -29,55 +45,382 @@ typedef struct {
     bstree_node_t* root;
     bstree_cmpfn_t cmpfn;
     bool allow_dups;
+    bool balanced;
+    size_t count;
 } bstree_t;
 
+enum {
+    BSTREE_RED   = 0,
+    BSTREE_BLACK = 1,
+};
+
 static void bstree_init(bstree_t* tree, bstree_cmpfn_t cmpfn, bool allow_dups) {
     tree->root = NULL;
     tree->cmpfn = cmpfn;
     tree->allow_dups = allow_dups;
+    tree->balanced = false;
+    tree->count = 0;
+}
+
+static void bstree_init_balanced(bstree_t* tree, bstree_cmpfn_t cmpfn, bool allow_dups) {
+    bstree_init(tree, cmpfn, allow_dups);
+    tree->balanced = true;
 }
 
 static bool bstree_empty(bstree_t* tree) {
     return (tree->root == NULL);
 }
 
-static size_t subtree_size(bstree_node_t* node) {
-    if (node == NULL)
-        return 0;
-    else
-        return (1 + subtree_size(node->left) + subtree_size(node->right));
+static size_t bstree_size(bstree_t* tree) {
+    return tree->count;
 }
 
-static size_t bstree_size(bstree_t* tree) {
-    return subtree_size(tree->root);
+static bstree_node_t* bstree_parent(bstree_node_t* node) {
+    return (bstree_node_t*)(node->parent_color & ~(uintptr_t)1);
+}
+
+static int bstree_color(bstree_node_t* node) {
+    return (int)(node->parent_color & 1u);
+}
+
+/* Missing children count as black leaves */
+static bool bstree_is_red(bstree_node_t* node) {
+    return ((node != NULL) && (bstree_color(node) == BSTREE_RED));
+}
+
+static void bstree_set_parent(bstree_node_t* node, bstree_node_t* parent) {
+    node->parent_color = (uintptr_t)parent | (node->parent_color & 1u);
+}
+
+static void bstree_set_color(bstree_node_t* node, int color) {
+    node->parent_color = (node->parent_color & ~(uintptr_t)1) | (uintptr_t)color;
+}
+
+#ifdef BSTREE_SUBTREE_SIZES
+static size_t bstree_subtree_size(bstree_node_t* node) {
+    return (node ? node->size : 0);
+}
+
+/* Recompute the size of node from its children */
+static void bstree_update_size(bstree_node_t* node) {
+    node->size = 1 + bstree_subtree_size(node->left) + bstree_subtree_size(node->right);
+}
+
+/* Add delta to the size of node and every one of its ancestors */
+static void bstree_adjust_sizes(bstree_node_t* node, size_t delta) {
+    for (; node != NULL; node = bstree_parent(node))
+        node->size += delta;
 }
+#endif
 
-static bstree_node_t** find_node(bstree_cmpfn_t cmpfn, bstree_node_t** root, bstree_node_t* node, bool allow_dups) {
+static bstree_node_t** find_node(bstree_cmpfn_t cmpfn, bstree_node_t** root, bstree_node_t* node, bool allow_dups, bstree_node_t** parent) {
     bstree_node_t** curr = root;
+    bstree_node_t* prev = NULL;
     while(*curr != NULL) {
         int cmp = cmpfn(node, *curr);
+        if (cmp == 0 && !allow_dups)
+            break;
+        prev = *curr;
         if (cmp < 0)
             curr = &((*curr)->left);
-        else if (cmp > 0)
-            curr = &((*curr)->right);
-        else if (allow_dups)
-            curr = &((*curr)->right);
         else
-            break;
+            curr = &((*curr)->right);
     }
+    if (parent != NULL)
+        *parent = prev;
     return curr;
 }
 
+/* Point whichever link held old_child, or the root, at new_child */
+static void bstree_replace_child(bstree_t* tree, bstree_node_t* parent, bstree_node_t* old_child, bstree_node_t* new_child) {
+    if (parent == NULL)
+        tree->root = new_child;
+    else if (parent->left == old_child)
+        parent->left = new_child;
+    else
+        parent->right = new_child;
+}
+
+static void bstree_rotate_left(bstree_t* tree, bstree_node_t* node) {
+    bstree_node_t* pivot = node->right;
+    node->right = pivot->left;
+    if (pivot->left != NULL)
+        bstree_set_parent(pivot->left, node);
+    bstree_replace_child(tree, bstree_parent(node), node, pivot);
+    bstree_set_parent(pivot, bstree_parent(node));
+    pivot->left = node;
+    bstree_set_parent(node, pivot);
+#ifdef BSTREE_SUBTREE_SIZES
+    pivot->size = node->size;
+    bstree_update_size(node);
+#endif
+}
+
+static void bstree_rotate_right(bstree_t* tree, bstree_node_t* node) {
+    bstree_node_t* pivot = node->left;
+    node->left = pivot->right;
+    if (pivot->right != NULL)
+        bstree_set_parent(pivot->right, node);
+    bstree_replace_child(tree, bstree_parent(node), node, pivot);
+    bstree_set_parent(pivot, bstree_parent(node));
+    pivot->right = node;
+    bstree_set_parent(node, pivot);
+#ifdef BSTREE_SUBTREE_SIZES
+    pivot->size = node->size;
+    bstree_update_size(node);
+#endif
+}
+
+/* Restore the red-black properties after linking in a red node */
+static void bstree_insert_fixup(bstree_t* tree, bstree_node_t* node) {
+    bstree_node_t* parent;
+    while ((parent = bstree_parent(node)) != NULL && bstree_is_red(parent)) {
+        /* A red parent is never the root, so the grandparent exists */
+        bstree_node_t* gparent = bstree_parent(parent);
+        if (parent == gparent->left) {
+            bstree_node_t* uncle = gparent->right;
+            if (bstree_is_red(uncle)) {
+                bstree_set_color(parent, BSTREE_BLACK);
+                bstree_set_color(uncle, BSTREE_BLACK);
+                bstree_set_color(gparent, BSTREE_RED);
+                node = gparent;
+                continue;
+            }
+            if (node == parent->right) {
+                bstree_rotate_left(tree, parent);
+                node   = parent;
+                parent = bstree_parent(node);
+            }
+            bstree_set_color(parent, BSTREE_BLACK);
+            bstree_set_color(gparent, BSTREE_RED);
+            bstree_rotate_right(tree, gparent);
+        } else {
+            bstree_node_t* uncle = gparent->left;
+            if (bstree_is_red(uncle)) {
+                bstree_set_color(parent, BSTREE_BLACK);
+                bstree_set_color(uncle, BSTREE_BLACK);
+                bstree_set_color(gparent, BSTREE_RED);
+                node = gparent;
+                continue;
+            }
+            if (node == parent->left) {
+                bstree_rotate_right(tree, parent);
+                node   = parent;
+                parent = bstree_parent(node);
+            }
+            bstree_set_color(parent, BSTREE_BLACK);
+            bstree_set_color(gparent, BSTREE_RED);
+            bstree_rotate_left(tree, gparent);
+        }
+    }
+    bstree_set_color(tree->root, BSTREE_BLACK);
+}
+
 static void bstree_insert(bstree_t* tree, bstree_node_t* node) {
-    bstree_node_t** curr = find_node(tree->cmpfn, &(tree->root), node, tree->allow_dups);
+    bstree_node_t* parent;
+    bstree_node_t** curr = find_node(tree->cmpfn, &(tree->root), node, tree->allow_dups, &parent);
     if (*curr == NULL) {
         *curr = node;
         node->left = NULL;
         node->right = NULL;
+        node->parent_color = (uintptr_t)parent | BSTREE_RED;
+        tree->count++;
+#ifdef BSTREE_SUBTREE_SIZES
+        node->size = 1;
+        bstree_adjust_sizes(parent, 1);
+#endif
+        if (tree->balanced)
+            bstree_insert_fixup(tree, node);
     }
 }
 
 static bstree_node_t* bstree_lookup(bstree_t* tree, bstree_node_t* node) {
-    bstree_node_t** curr = find_node(tree->cmpfn, &(tree->root), node, false);
+    bstree_node_t** curr = find_node(tree->cmpfn, &(tree->root), node, false, NULL);
     return *curr;
 }
+
+/* Restore the red-black properties after a black node was removed from above
+ * node, which may be NULL, leaving its side one black node short */
+static void bstree_delete_fixup(bstree_t* tree, bstree_node_t* node, bstree_node_t* parent) {
+    while ((node != tree->root) && !bstree_is_red(node)) {
+        if (node == parent->left) {
+            bstree_node_t* sibling = parent->right;
+            if (bstree_is_red(sibling)) {
+                bstree_set_color(sibling, BSTREE_BLACK);
+                bstree_set_color(parent, BSTREE_RED);
+                bstree_rotate_left(tree, parent);
+                sibling = parent->right;
+            }
+            if (!bstree_is_red(sibling->left) && !bstree_is_red(sibling->right)) {
+                bstree_set_color(sibling, BSTREE_RED);
+                node   = parent;
+                parent = bstree_parent(node);
+                continue;
+            }
+            if (!bstree_is_red(sibling->right)) {
+                bstree_set_color(sibling->left, BSTREE_BLACK);
+                bstree_set_color(sibling, BSTREE_RED);
+                bstree_rotate_right(tree, sibling);
+                sibling = parent->right;
+            }
+            bstree_set_color(sibling, bstree_color(parent));
+            bstree_set_color(parent, BSTREE_BLACK);
+            bstree_set_color(sibling->right, BSTREE_BLACK);
+            bstree_rotate_left(tree, parent);
+        } else {
+            bstree_node_t* sibling = parent->left;
+            if (bstree_is_red(sibling)) {
+                bstree_set_color(sibling, BSTREE_BLACK);
+                bstree_set_color(parent, BSTREE_RED);
+                bstree_rotate_right(tree, parent);
+                sibling = parent->left;
+            }
+            if (!bstree_is_red(sibling->left) && !bstree_is_red(sibling->right)) {
+                bstree_set_color(sibling, BSTREE_RED);
+                node   = parent;
+                parent = bstree_parent(node);
+                continue;
+            }
+            if (!bstree_is_red(sibling->left)) {
+                bstree_set_color(sibling->right, BSTREE_BLACK);
+                bstree_set_color(sibling, BSTREE_RED);
+                bstree_rotate_left(tree, sibling);
+                sibling = parent->left;
+            }
+            bstree_set_color(sibling, bstree_color(parent));
+            bstree_set_color(parent, BSTREE_BLACK);
+            bstree_set_color(sibling->left, BSTREE_BLACK);
+            bstree_rotate_right(tree, parent);
+        }
+        node = tree->root;
+    }
+    if (node != NULL)
+        bstree_set_color(node, BSTREE_BLACK);
+}
+
+/* Unlink node, which must be in the tree. A node with two children is
+ * replaced by its in-order successor, which also takes over its color. */
+static void bstree_delete(bstree_t* tree, bstree_node_t* node) {
+    bstree_node_t* child;
+    bstree_node_t* parent;
+    int color;
+    if ((node->left == NULL) || (node->right == NULL)) {
+        child  = (node->left ? node->left : node->right);
+        parent = bstree_parent(node);
+        color  = bstree_color(node);
+        bstree_replace_child(tree, parent, node, child);
+        if (child != NULL)
+            bstree_set_parent(child, parent);
+    } else {
+        bstree_node_t* succ = node->right;
+        while (succ->left != NULL)
+            succ = succ->left;
+        child  = succ->right;
+        parent = bstree_parent(succ);
+        color  = bstree_color(succ);
+        if (parent == node) {
+            parent = succ;
+        } else {
+            parent->left = child;
+            if (child != NULL)
+                bstree_set_parent(child, parent);
+            succ->right = node->right;
+            bstree_set_parent(node->right, succ);
+        }
+        succ->left = node->left;
+        bstree_set_parent(node->left, succ);
+        bstree_replace_child(tree, bstree_parent(node), node, succ);
+        succ->parent_color = node->parent_color;
+#ifdef BSTREE_SUBTREE_SIZES
+        succ->size = node->size;
+#endif
+    }
+    tree->count--;
+#ifdef BSTREE_SUBTREE_SIZES
+    bstree_adjust_sizes(parent, (size_t)-1);
+#endif
+    if (tree->balanced && (color == BSTREE_BLACK))
+        bstree_delete_fixup(tree, child, parent);
+}
+
+/* In-order Traversal
+ *****************************************************************************/
+static bstree_node_t* bstree_first(bstree_t* tree) {
+    bstree_node_t* node = tree->root;
+    while (node && node->left != NULL)
+        node = node->left;
+    return node;
+}
+
+static bstree_node_t* bstree_last(bstree_t* tree) {
+    bstree_node_t* node = tree->root;
+    while (node && node->right != NULL)
+        node = node->right;
+    return node;
+}
+
+static bstree_node_t* bstree_next(bstree_node_t* node) {
+    if (node->right != NULL) {
+        node = node->right;
+        while (node->left != NULL)
+            node = node->left;
+        return node;
+    }
+    bstree_node_t* parent = bstree_parent(node);
+    while ((parent != NULL) && (node == parent->right)) {
+        node   = parent;
+        parent = bstree_parent(node);
+    }
+    return parent;
+}
+
+static bstree_node_t* bstree_prev(bstree_node_t* node) {
+    if (node->left != NULL) {
+        node = node->left;
+        while (node->right != NULL)
+            node = node->right;
+        return node;
+    }
+    bstree_node_t* parent = bstree_parent(node);
+    while ((parent != NULL) && (node == parent->left)) {
+        node   = parent;
+        parent = bstree_parent(node);
+    }
+    return parent;
+}
+
+#define bstree_foreach(elem, tree) \
+    for(bstree_node_t* elem = bstree_first(tree); elem != NULL; elem = bstree_next(elem))
+
+/* Order Statistics
+ *****************************************************************************/
+#ifdef BSTREE_SUBTREE_SIZES
+/* Number of nodes that come before node in order */
+static size_t bstree_rank(bstree_node_t* node) {
+    size_t rank = bstree_subtree_size(node->left);
+    for (bstree_node_t* parent = bstree_parent(node); parent != NULL; parent = bstree_parent(node)) {
+        if (node == parent->right)
+            rank += bstree_subtree_size(parent->left) + 1;
+        node = parent;
+    }
+    return rank;
+}
+
+/* The node with the given zero-based rank, or NULL if there are not that
+ * many nodes */
+static bstree_node_t* bstree_select(bstree_t* tree, size_t rank) {
+    bstree_node_t* node = tree->root;
+    while (node != NULL) {
+        size_t left = bstree_subtree_size(node->left);
+        if (rank < left) {
+            node = node->left;
+        } else if (rank > left) {
+            rank -= left + 1;
+            node = node->right;
+        } else {
+            break;
+        }
+    }
+    return node;
+}
+#endif
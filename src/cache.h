@@ -0,0 +1,342 @@
+/**
+    Intrusive bounded cache with LRU, CLOCK and S3-FIFO eviction.
+
+    Copyright 2017, Michael D. Lowis
+
+    Permission to use, copy, modify, and/or distribute this software
+    for any purpose with or without fee is hereby granted, provided
+    that the above copyright notice and this permission notice appear
+    in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+    WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+    AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+    DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA
+    OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+    TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+    PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef CACHE_H
+#define CACHE_H
+
+/*
+    NOTE: This file depends on stdc.h, hash.h and list.h.
+
+    A cache_entry_t is embedded in the caller's own struct, the same way a
+    hash_entry_t is. It holds the entry's hash chain link, its place in the
+    eviction queue and the number of bytes it is charged against the cache's
+    budget. The hash and compare functions given to cache_init see the
+    hash_entry_t inside the cache_entry_t, so they get back to the caller's
+    struct with container_of(entry, my_t, cache.hash).
+
+    Lookups, inserts and evictions are all O(1) (amortized for CLOCK and
+    S3-FIFO, which may pass over an entry a few times before evicting it).
+    Whenever the cache lets go of an entry, whether it was evicted, replaced
+    by a cache_put of the same key, removed by cache_del or dropped by
+    cache_deinit, the entry is handed to the evict callback, which may free
+    it.
+
+    Policies:
+    - CACHE_LRU moves an entry to the back of its queue on every hit and
+      evicts from the front.
+    - CACHE_CLOCK only sets a reference bit on a hit, so hits do not write to
+      the queue. Eviction gives referenced entries a second pass.
+    - CACHE_S3FIFO (Yang et al., SOSP '23) admits new entries into a small
+      FIFO holding about a tenth of the budget. Entries hit while there are
+      promoted to the main FIFO and the rest are evicted, so a scan of keys
+      used only once passes through the small queue without pushing out the
+      working set. The hashes of recently evicted small queue entries are
+      remembered in a ghost queue, and a key that comes back while still in
+      it goes straight into the main queue.
+*/
+
+/* Eviction policies accepted by cache_init */
+enum {
+    CACHE_LRU,
+    CACHE_CLOCK,
+    CACHE_S3FIFO,
+};
+
+/* S3-FIFO small queue share of the budget in percent */
+#ifndef CACHE_SMALL_PCT
+#define CACHE_SMALL_PCT 10u
+#endif
+
+/* Hits counted per entry by CLOCK and S3-FIFO */
+#ifndef CACHE_MAX_FREQ
+#define CACHE_MAX_FREQ 3u
+#endif
+
+typedef struct cache_entry_t {
+    hash_entry_t hash;
+    list_node_t link;
+    size_t bytes;
+    unsigned char freq;
+    unsigned char queue;
+} cache_entry_t;
+
+typedef void (*cache_evictfn_t)(cache_entry_t* entry, void* arg);
+
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+} cache_stats_t;
+
+/* Ring of the hashes of entries evicted from the small queue, with a count
+ * per hash bucket for membership tests. Distinct keys whose hashes share a
+ * bucket look the same, which only costs an early promotion. */
+typedef struct {
+    unsigned int* ring;
+    unsigned int* counts;
+    size_t capacity;
+    size_t first;
+    size_t size;
+} cache_ghost_t;
+
+typedef struct {
+    int policy;
+    hash_t table;
+    /* LRU and CLOCK use only the first queue. S3-FIFO keeps its small queue
+     * in the first and its main queue in the second. */
+    list_t queues[2];
+    size_t used[2];
+    size_t budget;
+    size_t small_budget;
+    cache_ghost_t ghost;
+    cache_evictfn_t evictfn;
+    void* arg;
+    cache_stats_t stats;
+} cache_t;
+
+enum { CACHE_SMALL = 0, CACHE_MAIN = 1 };
+
+static cache_entry_t* cache_entry_of(list_node_t* node) {
+    return container_of(node, cache_entry_t, link);
+}
+
+/* The cache hands entries back through evictfn, so the table never frees */
+static void cache_nodel(hash_entry_t* entry) {
+    (void)entry;
+}
+
+/* Ghost Queue
+ *****************************************************************************/
+static void cache_ghost_grow(cache_ghost_t* ghost) {
+    size_t capacity = (ghost->capacity ? 2 * ghost->capacity : 64u);
+    unsigned int* ring = (unsigned int*)emalloc(capacity * sizeof(unsigned int));
+    for (size_t i = 0; i < ghost->size; i++)
+        ring[i] = ghost->ring[(ghost->first + i) & (ghost->capacity - 1)];
+    free(ghost->ring);
+    free(ghost->counts);
+    ghost->ring     = ring;
+    ghost->counts   = (unsigned int*)ecalloc(2 * capacity, sizeof(unsigned int));
+    ghost->capacity = capacity;
+    ghost->first    = 0;
+    for (size_t i = 0; i < ghost->size; i++)
+        ghost->counts[ring[i] & (2 * capacity - 1)]++;
+}
+
+static bool cache_ghost_has(cache_ghost_t* ghost, unsigned int hash) {
+    return (ghost->size > 0) && (ghost->counts[hash & (2 * ghost->capacity - 1)] > 0);
+}
+
+static void cache_ghost_pop(cache_ghost_t* ghost) {
+    unsigned int hash = ghost->ring[ghost->first];
+    ghost->counts[hash & (2 * ghost->capacity - 1)]--;
+    ghost->first = (ghost->first + 1) & (ghost->capacity - 1);
+    ghost->size--;
+}
+
+/* The ghost remembers about as many keys as the main queue holds */
+static void cache_ghost_push(cache_ghost_t* ghost, unsigned int hash, size_t limit) {
+    if (limit == 0)
+        limit = 1;
+    while (ghost->size >= limit)
+        cache_ghost_pop(ghost);
+    if (ghost->size == ghost->capacity)
+        cache_ghost_grow(ghost);
+    ghost->ring[(ghost->first + ghost->size) & (ghost->capacity - 1)] = hash;
+    ghost->counts[hash & (2 * ghost->capacity - 1)]++;
+    ghost->size++;
+}
+
+/* Cache
+ *****************************************************************************/
+/* budget is the total number of bytes the cached entries may be charged */
+static void cache_init(cache_t* cache, int policy, size_t budget, hash_hashfn_t hashfn, hash_cmpfn_t cmpfn, cache_evictfn_t evictfn, void* arg) {
+    cache->policy         = policy;
+    cache->budget         = budget;
+    cache->small_budget   = ((budget / 100u) * CACHE_SMALL_PCT) + (((budget % 100u) * CACHE_SMALL_PCT) / 100u);
+    if (cache->small_budget == 0)
+        cache->small_budget = 1;
+    cache->evictfn        = evictfn;
+    cache->arg            = arg;
+    cache->used[0]        = 0;
+    cache->used[1]        = 0;
+    cache->ghost.ring     = NULL;
+    cache->ghost.counts   = NULL;
+    cache->ghost.capacity = 0;
+    cache->ghost.first    = 0;
+    cache->ghost.size     = 0;
+    memset(&(cache->stats), 0, sizeof(cache_stats_t));
+    list_init(&(cache->queues[0]));
+    list_init(&(cache->queues[1]));
+    hash_init(&(cache->table), hashfn, cmpfn, cache_nodel);
+}
+
+static size_t cache_size(cache_t* cache) {
+    return hash_size(&(cache->table));
+}
+
+/* Bytes currently charged against the budget */
+static size_t cache_used(cache_t* cache) {
+    return cache->used[0] + cache->used[1];
+}
+
+/* Unlink entry from the table and its queue without calling evictfn */
+static void cache_unlink(cache_t* cache, cache_entry_t* entry) {
+    hash_del(&(cache->table), &(entry->hash));
+    list_remove(&(cache->queues[entry->queue]), &(entry->link));
+    cache->used[entry->queue] -= entry->bytes;
+}
+
+static void cache_enqueue(cache_t* cache, cache_entry_t* entry, unsigned char queue) {
+    entry->queue = queue;
+    list_push_back(&(cache->queues[queue]), &(entry->link));
+    cache->used[queue] += entry->bytes;
+}
+
+static void cache_evict(cache_t* cache, cache_entry_t* entry) {
+    cache_unlink(cache, entry);
+    cache->stats.evictions++;
+    if (cache->evictfn != NULL)
+        cache->evictfn(entry, cache->arg);
+}
+
+/* Evict one entry, or possibly just promote one in S3-FIFO's case, picking
+ * from the front of the queues */
+static void cache_evict_step(cache_t* cache) {
+    if (cache->policy == CACHE_LRU) {
+        cache_evict(cache, cache_entry_of(list_front(&(cache->queues[0]))));
+    } else if (cache->policy == CACHE_CLOCK) {
+        cache_entry_t* entry = cache_entry_of(list_front(&(cache->queues[0])));
+        if (entry->freq > 0) {
+            entry->freq = 0;
+            list_move_back(&(cache->queues[0]), &(entry->link));
+        } else {
+            cache_evict(cache, entry);
+        }
+    } else if ((cache->used[CACHE_SMALL] >= cache->small_budget) || list_empty(&(cache->queues[CACHE_MAIN]))) {
+        cache_entry_t* entry = cache_entry_of(list_front(&(cache->queues[CACHE_SMALL])));
+        if (entry->freq > 0) {
+            list_remove(&(cache->queues[CACHE_SMALL]), &(entry->link));
+            cache->used[CACHE_SMALL] -= entry->bytes;
+            entry->freq = 0;
+            cache_enqueue(cache, entry, CACHE_MAIN);
+        } else {
+            cache_ghost_push(&(cache->ghost), entry->hash.hash, list_size(&(cache->queues[CACHE_MAIN])));
+            cache_evict(cache, entry);
+        }
+    } else {
+        cache_entry_t* entry = cache_entry_of(list_front(&(cache->queues[CACHE_MAIN])));
+        if (entry->freq > 0) {
+            entry->freq--;
+            list_move_back(&(cache->queues[CACHE_MAIN]), &(entry->link));
+        } else {
+            cache_evict(cache, entry);
+        }
+    }
+}
+
+/* Look up the entry matching key, counting a hit or a miss. Returns NULL on
+ * a miss. */
+static cache_entry_t* cache_get(cache_t* cache, cache_entry_t* key) {
+    hash_entry_t* found = hash_get(&(cache->table), &(key->hash));
+    if (found == NULL) {
+        cache->stats.misses++;
+        return NULL;
+    }
+    cache->stats.hits++;
+    cache_entry_t* entry = container_of(found, cache_entry_t, hash);
+    if (cache->policy == CACHE_LRU)
+        list_move_back(&(cache->queues[0]), &(entry->link));
+    else if (entry->freq < CACHE_MAX_FREQ)
+        entry->freq++;
+    return entry;
+}
+
+/* Look up the entry matching key without counting or touching it */
+static cache_entry_t* cache_peek(cache_t* cache, cache_entry_t* key) {
+    hash_entry_t* found = hash_get(&(cache->table), &(key->hash));
+    return (found != NULL ? container_of(found, cache_entry_t, hash) : NULL);
+}
+
+/* Insert entry charged at bytes, evicting others until it fits. An entry
+ * with the same key is replaced and handed to evictfn. An entry larger than
+ * the whole budget is not cached: it goes straight to evictfn and false is
+ * returned. */
+static bool cache_put(cache_t* cache, cache_entry_t* entry, size_t bytes) {
+    cache_entry_t* old = cache_peek(cache, entry);
+    if (old != NULL) {
+        cache_unlink(cache, old);
+        if (cache->evictfn != NULL)
+            cache->evictfn(old, cache->arg);
+    }
+    entry->bytes = bytes;
+    entry->freq  = 0;
+    if (bytes > cache->budget) {
+        if (cache->evictfn != NULL)
+            cache->evictfn(entry, cache->arg);
+        return false;
+    }
+    while ((cache_used(cache) + bytes) > cache->budget)
+        cache_evict_step(cache);
+    unsigned char queue = 0;
+    if (cache->policy == CACHE_S3FIFO) {
+        unsigned int hash = cache->table.hashfn(&(entry->hash));
+        queue = (cache_ghost_has(&(cache->ghost), hash) ? CACHE_MAIN : CACHE_SMALL);
+    }
+    hash_set_unique(&(cache->table), &(entry->hash));
+    cache_enqueue(cache, entry, queue);
+    return true;
+}
+
+/* Remove the entry matching key and hand it to evictfn */
+static bool cache_del(cache_t* cache, cache_entry_t* key) {
+    cache_entry_t* entry = cache_peek(cache, key);
+    if (entry == NULL)
+        return false;
+    cache_unlink(cache, entry);
+    if (cache->evictfn != NULL)
+        cache->evictfn(entry, cache->arg);
+    return true;
+}
+
+/* Hand every entry to evictfn and empty the cache. Counters are kept. */
+static void cache_clr(cache_t* cache) {
+    for (int i = 0; i < 2; i++) {
+        while (!list_empty(&(cache->queues[i]))) {
+            cache_entry_t* entry = cache_entry_of(list_front(&(cache->queues[i])));
+            cache_unlink(cache, entry);
+            if (cache->evictfn != NULL)
+                cache->evictfn(entry, cache->arg);
+        }
+    }
+    while (cache->ghost.size > 0)
+        cache_ghost_pop(&(cache->ghost));
+}
+
+static void cache_deinit(cache_t* cache) {
+    cache_clr(cache);
+    hash_deinit(&(cache->table));
+    free(cache->ghost.ring);
+    free(cache->ghost.counts);
+}
+
+static cache_stats_t cache_stats(cache_t* cache) {
+    return cache->stats;
+}
+
+#endif /* CACHE_H */
@@ -0,0 +1,377 @@
+/*
+    Concurrent hash table built from independently locked shards with
+    lock-free reads.
+
+    Copyright 2017, Michael D. Lowis
+
+    Permission to use, copy, modify, and/or distribute this software
+    for any purpose with or without fee is hereby granted, provided
+    that the above copyright notice and this permission notice appear
+    in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+    WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+    AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+    DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA
+    OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+    TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+    PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+    NOTE: This file depends on stdc.h and hash.h, on C11 atomics (which
+    compilers in C99 mode accept as an extension) and on POSIX reader/writer
+    locks. Define _POSIX_C_SOURCE to 200112L or later before including any
+    system headers and link with -lpthread.
+
+    The key space is split across a power-of-two number of shards using the
+    top bits of the finalized hash, so the bucket index inside each shard
+    (taken from the low bits) stays independent of the shard choice. Each
+    shard is a chained table guarded by its own reader/writer lock and padded
+    out to a cache line boundary so that neighbouring locks do not false
+    share. Writers of different shards never contend.
+
+    chash_visit read locks the shard and runs its callback on the entry
+    while the lock is held. There is no locked lookup that returns the entry,
+    since a concurrent delete could release it as soon as the lock is
+    dropped. chash_find takes no lock at all: it must run between
+    chash_read_enter and chash_read_exit, and the entry it returns stays
+    valid until chash_read_exit even if another thread deletes or replaces
+    it. Writers publish entries with release stores and never unlink the
+    next pointer of a removed entry, so a reader walking a chain always
+    reaches its end. Removed entries and old bucket arrays are handed to the
+    delete function only once every reader that could still see them has
+    left its read section (epoch based reclamation). Each thread that calls
+    chash_find needs its own chash_reader_t from chash_reader;
+    there are at most CHASH_MAX_READERS of these and they are never reused.
+
+    Growing a shard relinks its entries, which can make a concurrent lock-free
+    lookup miss a key that is present. The shard's sequence count is odd
+    while it grows, so a lookup that misses re-checks it and retries under
+    the read lock if the shard grew underneath it.
+
+    An entry passed to chash_set must not already be in the table, since its
+    hash and next pointer are rewritten while readers may be walking it.
+*/
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifndef CHASH_CACHE_LINE
+#define CHASH_CACHE_LINE 64u
+#endif
+
+#ifndef CHASH_DEFAULT_SHARDS
+#define CHASH_DEFAULT_SHARDS 64u
+#endif
+
+#ifndef CHASH_MAX_READERS
+#define CHASH_MAX_READERS 256u
+#endif
+
+/* Removals a shard collects before it looks for ones it can release */
+#ifndef CHASH_RECLAIM_BATCH
+#define CHASH_RECLAIM_BATCH 64u
+#endif
+
+typedef void (*chash_visitfn_t)(hash_entry_t* entry, void* arg);
+
+typedef struct {
+    size_t mask;
+    _Atomic(hash_entry_t*) buckets[];
+} chash_table_t;
+
+/* An entry or bucket array waiting for the readers of its epoch to leave */
+typedef struct {
+    void* ptr;
+    uint64_t epoch;
+    bool is_table;
+} chash_retired_t;
+
+typedef struct {
+    pthread_rwlock_t lock;
+    _Atomic(chash_table_t*) table;
+    atomic_uint seq;
+    size_t size;
+    chash_retired_t* retired;
+    size_t nretired;
+    size_t maxretired;
+} chash_shard_state_t;
+
+typedef struct {
+    chash_shard_state_t s;
+    char pad[CHASH_CACHE_LINE - (sizeof(chash_shard_state_t) % CHASH_CACHE_LINE)];
+} chash_shard_t;
+
+/* The epoch a thread entered its read section in, or 0 outside one */
+typedef struct {
+    _Atomic(uint64_t) epoch;
+    char pad[CHASH_CACHE_LINE - sizeof(_Atomic(uint64_t))];
+} chash_reader_t;
+
+typedef struct {
+    size_t nshards;
+    unsigned int shard_bits;
+    chash_shard_t* shards;
+    hash_hashfn_t hashfn;
+    hash_cmpfn_t cmpfn;
+    hash_freefn_t delfn;
+    _Atomic(uint64_t) epoch;
+    atomic_size_t nreaders;
+    chash_reader_t* readers;
+} chash_t;
+
+static void* chash_aligned_alloc(size_t size) {
+    void* ptr = NULL;
+    if (0 != posix_memalign(&ptr, CHASH_CACHE_LINE, size))
+        ptr = NULL;
+    assert(ptr != NULL);
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+static chash_table_t* chash_table_new(size_t nbuckets) {
+    chash_table_t* table = (chash_table_t*)ecalloc(1, sizeof(chash_table_t) + (nbuckets * sizeof(_Atomic(hash_entry_t*))));
+    table->mask = nbuckets - 1;
+    return table;
+}
+
+static inline hash_entry_t* chash_next(hash_entry_t* entry, memory_order order) {
+    return atomic_load_explicit((_Atomic(hash_entry_t*)*)&(entry->next), order);
+}
+
+static inline void chash_set_next(hash_entry_t* entry, hash_entry_t* next, memory_order order) {
+    atomic_store_explicit((_Atomic(hash_entry_t*)*)&(entry->next), next, order);
+}
+
+static chash_shard_state_t* chash_shard(chash_t* chash, unsigned int hash) {
+    if (chash->shard_bits == 0)
+        return &(chash->shards[0].s);
+    return &(chash->shards[hash_fmix(hash) >> (32u - chash->shard_bits)].s);
+}
+
+/* Find the link that points at the entry matching key, or at the NULL that
+ * ends its chain. Only writers use this, so the chain cannot change under
+ * it. */
+static _Atomic(hash_entry_t*)* chash_link(chash_t* chash, chash_shard_state_t* shard, hash_entry_t* key, unsigned int hash) {
+    chash_table_t* table = atomic_load_explicit(&(shard->table), memory_order_relaxed);
+    _Atomic(hash_entry_t*)* link = &(table->buckets[hash_fmix(hash) & table->mask]);
+    for (hash_entry_t* curr; (curr = atomic_load_explicit(link, memory_order_relaxed)) != NULL;) {
+        if (curr->hash == hash && chash->cmpfn(curr, key) == 0)
+            break;
+        link = (_Atomic(hash_entry_t*)*)&(curr->next);
+    }
+    return link;
+}
+
+static hash_entry_t* chash_lookup(chash_t* chash, chash_shard_state_t* shard, hash_entry_t* key, unsigned int hash) {
+    chash_table_t* table = atomic_load_explicit(&(shard->table), memory_order_acquire);
+    hash_entry_t* curr = atomic_load_explicit(&(table->buckets[hash_fmix(hash) & table->mask]), memory_order_acquire);
+    for (; curr != NULL; curr = chash_next(curr, memory_order_acquire))
+        if (curr->hash == hash && chash->cmpfn(curr, key) == 0)
+            break;
+    return curr;
+}
+
+/* Release everything retired before the oldest epoch a reader is still in.
+ * The fence pairs with the one in chash_read_enter: either this scan sees
+ * the reader's epoch or the reader sees the entry already unlinked. */
+static void chash_reclaim(chash_t* chash, chash_shard_state_t* shard, bool all) {
+    uint64_t oldest = UINT64_MAX;
+    atomic_thread_fence(memory_order_seq_cst);
+    size_t nreaders = atomic_load(&(chash->nreaders));
+    for (size_t i = 0; !all && i < nreaders; i++) {
+        uint64_t epoch = atomic_load_explicit(&(chash->readers[i].epoch), memory_order_acquire);
+        if (epoch != 0 && epoch < oldest)
+            oldest = epoch;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < shard->nretired; i++) {
+        chash_retired_t* retired = &(shard->retired[i]);
+        if (retired->epoch >= oldest)
+            shard->retired[kept++] = *retired;
+        else if (retired->is_table)
+            free(retired->ptr);
+        else if (chash->delfn)
+            chash->delfn((hash_entry_t*)retired->ptr);
+    }
+    shard->nretired = kept;
+}
+
+/* Readers that entered at or before the epoch returned by the increment may
+ * still hold ptr. Later readers start in a newer epoch and cannot reach it. */
+static void chash_retire(chash_t* chash, chash_shard_state_t* shard, void* ptr, bool is_table) {
+    if (shard->nretired == shard->maxretired) {
+        shard->maxretired = (shard->maxretired ? shard->maxretired * 2 : CHASH_RECLAIM_BATCH);
+        shard->retired = (chash_retired_t*)erealloc(shard->retired, shard->maxretired * sizeof(chash_retired_t));
+    }
+    chash_retired_t* retired = &(shard->retired[shard->nretired++]);
+    retired->ptr      = ptr;
+    retired->epoch    = atomic_fetch_add(&(chash->epoch), 1);
+    retired->is_table = is_table;
+    if (shard->nretired >= CHASH_RECLAIM_BATCH && (shard->nretired % CHASH_RECLAIM_BATCH) == 0)
+        chash_reclaim(chash, shard, false);
+}
+
+/* Double the bucket count, moving each entry to the head of its new chain.
+ * Every entry points either at one moved before it or at the rest of its old
+ * chain, so a lock-free reader caught part way through still terminates. */
+static void chash_grow(chash_t* chash, chash_shard_state_t* shard) {
+    chash_table_t* old = atomic_load_explicit(&(shard->table), memory_order_relaxed);
+    chash_table_t* table = chash_table_new((old->mask + 1) * 2);
+    atomic_fetch_add_explicit(&(shard->seq), 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (size_t i = 0; i <= old->mask; i++) {
+        hash_entry_t* curr = atomic_load_explicit(&(old->buckets[i]), memory_order_relaxed);
+        while (curr != NULL) {
+            hash_entry_t* next = chash_next(curr, memory_order_relaxed);
+            _Atomic(hash_entry_t*)* bucket = &(table->buckets[hash_fmix(curr->hash) & table->mask]);
+            chash_set_next(curr, atomic_load_explicit(bucket, memory_order_relaxed), memory_order_release);
+            atomic_store_explicit(bucket, curr, memory_order_relaxed);
+            curr = next;
+        }
+    }
+    atomic_store_explicit(&(shard->table), table, memory_order_release);
+    atomic_fetch_add_explicit(&(shard->seq), 1, memory_order_release);
+    chash_retire(chash, shard, old, true);
+}
+
+static void chash_init(chash_t* chash, size_t nshards, hash_hashfn_t hashfn, hash_cmpfn_t cmpfn, hash_freefn_t delfn) {
+    if (nshards == 0)
+        nshards = CHASH_DEFAULT_SHARDS;
+    chash->shard_bits = 0;
+    while (((size_t)1 << chash->shard_bits) < nshards)
+        chash->shard_bits++;
+    chash->nshards = ((size_t)1 << chash->shard_bits);
+    chash->hashfn  = hashfn;
+    chash->cmpfn   = cmpfn;
+    chash->delfn   = delfn;
+    atomic_init(&(chash->epoch), 1);
+    atomic_init(&(chash->nreaders), 0);
+    chash->readers = (chash_reader_t*)chash_aligned_alloc(CHASH_MAX_READERS * sizeof(chash_reader_t));
+    chash->shards  = (chash_shard_t*)chash_aligned_alloc(chash->nshards * sizeof(chash_shard_t));
+    for (size_t i = 0; i < chash->nshards; i++) {
+        chash_shard_state_t* shard = &(chash->shards[i].s);
+        pthread_rwlock_init(&(shard->lock), NULL);
+        atomic_init(&(shard->table), chash_table_new(8));
+        atomic_init(&(shard->seq), 0);
+    }
+}
+
+/* No thread may be using the table, so everything is released at once */
+static void chash_deinit(chash_t* chash) {
+    for (size_t i = 0; i < chash->nshards; i++) {
+        chash_shard_state_t* shard = &(chash->shards[i].s);
+        chash_table_t* table = atomic_load(&(shard->table));
+        chash_reclaim(chash, shard, true);
+        for (size_t b = 0; b <= table->mask; b++) {
+            hash_entry_t* curr = atomic_load_explicit(&(table->buckets[b]), memory_order_relaxed);
+            while (curr != NULL) {
+                hash_entry_t* next = curr->next;
+                if (chash->delfn)
+                    chash->delfn(curr);
+                curr = next;
+            }
+        }
+        free(table);
+        free(shard->retired);
+        pthread_rwlock_destroy(&(shard->lock));
+    }
+    free(chash->shards);
+    free(chash->readers);
+}
+
+/* Claim a reader slot for the calling thread. Slots are never returned. */
+static chash_reader_t* chash_reader(chash_t* chash) {
+    size_t slot = atomic_fetch_add(&(chash->nreaders), 1);
+    assert(slot < CHASH_MAX_READERS);
+    return &(chash->readers[slot]);
+}
+
+static void chash_read_enter(chash_t* chash, chash_reader_t* reader) {
+    atomic_store(&(reader->epoch), atomic_load(&(chash->epoch)));
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+static void chash_read_exit(chash_reader_t* reader) {
+    atomic_store_explicit(&(reader->epoch), 0, memory_order_release);
+}
+
+/* The result is exact only while no other thread is modifying the table */
+static size_t chash_size(chash_t* chash) {
+    size_t size = 0;
+    for (size_t i = 0; i < chash->nshards; i++) {
+        chash_shard_state_t* shard = &(chash->shards[i].s);
+        pthread_rwlock_rdlock(&(shard->lock));
+        size += shard->size;
+        pthread_rwlock_unlock(&(shard->lock));
+    }
+    return size;
+}
+
+/* The hash is computed before taking the lock so the user's hash function
+ * runs outside it, but only stored into the entry once the lock is held. */
+static void chash_set(chash_t* chash, hash_entry_t* entry) {
+    unsigned int hash = chash->hashfn(entry);
+    chash_shard_state_t* shard = chash_shard(chash, hash);
+    pthread_rwlock_wrlock(&(shard->lock));
+    entry->hash = hash;
+    _Atomic(hash_entry_t*)* link = chash_link(chash, shard, entry, hash);
+    hash_entry_t* old = atomic_load_explicit(link, memory_order_relaxed);
+    chash_set_next(entry, (old ? chash_next(old, memory_order_relaxed) : NULL), memory_order_relaxed);
+    atomic_store_explicit(link, entry, memory_order_release);
+    if (old != NULL) {
+        chash_retire(chash, shard, old, false);
+    } else {
+        chash_table_t* table = atomic_load_explicit(&(shard->table), memory_order_relaxed);
+        if (++shard->size > table->mask + 1)
+            chash_grow(chash, shard);
+    }
+    pthread_rwlock_unlock(&(shard->lock));
+}
+
+/* Must be called inside a read section. A hit is always genuine; a miss is
+ * only trusted if the shard did not grow during the walk. */
+static hash_entry_t* chash_find(chash_t* chash, hash_entry_t* entry) {
+    unsigned int hash = chash->hashfn(entry);
+    chash_shard_state_t* shard = chash_shard(chash, hash);
+    unsigned int seq = atomic_load_explicit(&(shard->seq), memory_order_acquire);
+    hash_entry_t* found = chash_lookup(chash, shard, entry, hash);
+    if (found == NULL) {
+        atomic_thread_fence(memory_order_acquire);
+        if ((seq & 1u) || seq != atomic_load_explicit(&(shard->seq), memory_order_relaxed)) {
+            pthread_rwlock_rdlock(&(shard->lock));
+            found = chash_lookup(chash, shard, entry, hash);
+            pthread_rwlock_unlock(&(shard->lock));
+        }
+    }
+    return found;
+}
+
+static bool chash_visit(chash_t* chash, hash_entry_t* entry, chash_visitfn_t fn, void* arg) {
+    unsigned int hash = chash->hashfn(entry);
+    chash_shard_state_t* shard = chash_shard(chash, hash);
+    pthread_rwlock_rdlock(&(shard->lock));
+    hash_entry_t* found = chash_lookup(chash, shard, entry, hash);
+    if (found != NULL)
+        fn(found, arg);
+    pthread_rwlock_unlock(&(shard->lock));
+    return (found != NULL);
+}
+
+/* The removed entry keeps its next pointer so readers standing on it can
+ * carry on down the chain */
+static bool chash_del(chash_t* chash, hash_entry_t* entry) {
+    unsigned int hash = chash->hashfn(entry);
+    chash_shard_state_t* shard = chash_shard(chash, hash);
+    pthread_rwlock_wrlock(&(shard->lock));
+    _Atomic(hash_entry_t*)* link = chash_link(chash, shard, entry, hash);
+    hash_entry_t* old = atomic_load_explicit(link, memory_order_relaxed);
+    if (old != NULL) {
+        atomic_store_explicit(link, chash_next(old, memory_order_relaxed), memory_order_release);
+        shard->size--;
+        chash_retire(chash, shard, old, false);
+    }
+    pthread_rwlock_unlock(&(shard->lock));
+    return (old != NULL);
+}
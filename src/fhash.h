@@ -0,0 +1,423 @@
+/*
+    Frozen, memory mappable hash table images built from a hash_t.
+
+    Copyright 2017, Michael D. Lowis
+
+    Permission to use, copy, modify, and/or distribute this software
+    for any purpose with or without fee is hereby granted, provided
+    that the above copyright notice and this permission notice appear
+    in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+    WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+    AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+    DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA
+    OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+    TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+    PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+    NOTE: This file depends on hash.h and on POSIX mmap. Define
+    _POSIX_C_SOURCE to 200112L or later before including any system headers.
+
+    fhash_write serializes the keys and values of a hash_t into a single
+    read-only image laid out as:
+
+        header | slots[nslots] | displacements[nbuckets] | key/value blob
+
+    Every offset in the image is relative to its start, so the image can be
+    mapped at any address and queried in place by fhash_get without parsing
+    or allocating anything. Keys are hashed with hash_bytes64 and each slot
+    caches that hash next to the offset and lengths of its key and value,
+    which are stored back to back in the blob in slot order. Integers are
+    stored in native byte order, so images are not portable between
+    machines of different endianness.
+
+    By default the slots form a linear probing table at most FHASH_MAX_LOAD
+    percent full. With FHASH_PERFECT the image instead holds a minimal
+    perfect hash built by hash-and-displace: keys are grouped into buckets of
+    about FHASH_BUCKET_SIZE, and each bucket stores the displacement that
+    sends all of its keys to distinct slots. There are then exactly as many
+    slots as keys and every lookup touches a single slot.
+
+    fhash_write builds the image in path.tmp and renames it over path, so
+    processes that have the old image mapped keep reading it undisturbed.
+    fhash_map checks every offset in an image before accepting it, so a
+    corrupt image is rejected rather than read out of bounds.
+*/
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef FHASH_MAX_LOAD
+#define FHASH_MAX_LOAD 70u
+#endif
+
+#ifndef FHASH_BUCKET_SIZE
+#define FHASH_BUCKET_SIZE 4u
+#endif
+
+/* Give up on a bucket after this many displacements, failing the build */
+#ifndef FHASH_MAX_DISPLACE
+#define FHASH_MAX_DISPLACE (1u << 24)
+#endif
+
+#define FHASH_MAGIC   "ALIBFHSH"
+#define FHASH_VERSION 1u
+
+/* Flags accepted by fhash_write */
+enum {
+    /* Build a minimal perfect hash instead of a linear probing table */
+    FHASH_PERFECT = (1 << 0),
+};
+
+/* Displacements with the top bit set hold a slot index for a bucket with a
+ * single key rather than a displacement */
+#define FHASH_DIRECT 0x80000000u
+
+/* Retrieve the key or value bytes of an entry being frozen */
+typedef void (*fhash_datafn_t)(const hash_entry_t* entry, const void** data, size_t* len);
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t seed;
+    uint64_t nkeys;
+    uint64_t nslots;
+    uint64_t nbuckets;
+    uint64_t slots_off;
+    uint64_t disp_off;
+    uint64_t blob_off;
+    uint64_t size;
+} fhash_header_t;
+
+typedef struct {
+    uint64_t hash; /* 0 marks an empty slot */
+    uint64_t offset;
+    uint32_t keylen;
+    uint32_t vallen;
+} fhash_slot_t;
+
+typedef struct {
+    const uint8_t* base;
+    size_t size;
+    bool mapped;
+    const fhash_header_t* header;
+    const fhash_slot_t* slots;
+    const uint32_t* disp;
+} fhash_t;
+
+/* Hashes are stored with the low bit set so that zero can mark empty slots */
+static inline uint64_t fhash_hash(const void* key, size_t len, uint64_t seed) {
+    return (hash_bytes64(key, len, seed) | 1u);
+}
+
+static inline uint64_t fhash_bucket(uint64_t hash, uint64_t nbuckets) {
+    return ((hash >> 32) % nbuckets);
+}
+
+static inline uint64_t fhash_displace(uint64_t hash, uint32_t disp, uint64_t nslots) {
+    return (hash_mum(hash ^ Hash_Secret[2], disp ^ Hash_Secret[3]) % nslots);
+}
+
+/* Build Time
+ *****************************************************************************/
+typedef struct {
+    uint64_t hash;
+    hash_entry_t* entry;
+} fhash_item_t;
+
+static bool fhash_place_probing(fhash_item_t* items, size_t nkeys, fhash_item_t* slots, size_t nslots) {
+    for (size_t i = 0; i < nkeys; i++) {
+        size_t index = (size_t)(items[i].hash & (nslots - 1));
+        while (slots[index].entry != NULL)
+            index = (index + 1) & (nslots - 1);
+        slots[index] = items[i];
+    }
+    return true;
+}
+
+static bool fhash_place_perfect(fhash_item_t* items, size_t nkeys, fhash_item_t* slots, size_t nslots, uint32_t* disp, size_t nbuckets) {
+    bool ok = true;
+    size_t* start = (size_t*)ecalloc(nbuckets + 1, sizeof(size_t));
+    size_t* order = (size_t*)ecalloc(nbuckets, sizeof(size_t));
+    size_t* bysize = (size_t*)ecalloc(nkeys + 1, sizeof(size_t));
+    fhash_item_t* sorted = (fhash_item_t*)ecalloc(nkeys, sizeof(fhash_item_t));
+    size_t* tried = (size_t*)ecalloc(nkeys + 1, sizeof(size_t));
+    /* Group the keys by bucket with a counting sort */
+    for (size_t i = 0; i < nkeys; i++)
+        start[fhash_bucket(items[i].hash, nbuckets) + 1]++;
+    for (size_t b = 0; b < nbuckets; b++)
+        start[b + 1] += start[b];
+    for (size_t i = 0; i < nkeys; i++) {
+        uint64_t b = fhash_bucket(items[i].hash, nbuckets);
+        sorted[start[b] + tried[b]++] = items[i];
+    }
+    /* Order the buckets from largest to smallest, again by counting */
+    for (size_t b = 0; b < nbuckets; b++)
+        bysize[start[b + 1] - start[b]]++;
+    for (size_t sz = nkeys + 1, total = 0; sz > 0; sz--) {
+        size_t count = bysize[sz - 1];
+        bysize[sz - 1] = total;
+        total += count;
+    }
+    for (size_t b = 0; b < nbuckets; b++)
+        order[bysize[start[b + 1] - start[b]]++] = b;
+    /* Larger buckets search for a displacement that fits all of their keys */
+    size_t freeslot = 0;
+    for (size_t i = 0; ok && i < nbuckets; i++) {
+        size_t b = order[i], count = start[b + 1] - start[b];
+        fhash_item_t* keys = &(sorted[start[b]]);
+        if (count == 0) {
+            disp[b] = 0;
+        } else if (count == 1) {
+            /* Singletons simply take the next free slot */
+            while (slots[freeslot].entry != NULL)
+                freeslot++;
+            slots[freeslot] = keys[0];
+            disp[b] = FHASH_DIRECT | (uint32_t)freeslot;
+        } else {
+            uint32_t d = 0;
+            for (; d < FHASH_MAX_DISPLACE; d++) {
+                size_t k = 0;
+                for (; k < count; k++) {
+                    tried[k] = (size_t)fhash_displace(keys[k].hash, d, nslots);
+                    if (slots[tried[k]].entry != NULL)
+                        break;
+                    slots[tried[k]].entry = keys[k].entry;
+                }
+                if (k == count)
+                    break;
+                /* Release the slots claimed by this attempt */
+                while (k > 0)
+                    slots[tried[--k]].entry = NULL;
+            }
+            ok = (d < FHASH_MAX_DISPLACE);
+            for (size_t k = 0; ok && k < count; k++)
+                slots[tried[k]] = keys[k];
+            disp[b] = d;
+        }
+    }
+    free(tried);
+    free(sorted);
+    free(bysize);
+    free(order);
+    free(start);
+    return ok;
+}
+
+static bool fhash_write(hash_t* hash, const char* path, fhash_datafn_t keyfn, fhash_datafn_t valfn, unsigned int flags) {
+    fhash_header_t header;
+    size_t nkeys = hash_size(hash), nslots, nbuckets = 0;
+    memset(&header, 0, sizeof(header));
+    if (flags & FHASH_PERFECT) {
+        nslots   = (nkeys ? nkeys : 1);
+        nbuckets = (nkeys / FHASH_BUCKET_SIZE) + 1;
+    } else {
+        nslots = 8;
+        while ((nslots * FHASH_MAX_LOAD) < (nkeys * 100u))
+            nslots <<= 1;
+    }
+    /* Hash every key once up front */
+    fhash_item_t* items = (fhash_item_t*)ecalloc(nkeys + 1, sizeof(fhash_item_t));
+    fhash_item_t* slots = (fhash_item_t*)ecalloc(nslots, sizeof(fhash_item_t));
+    uint32_t* disp = (uint32_t*)ecalloc(nbuckets + 1, sizeof(uint32_t));
+    hash_iter_t iter;
+    size_t n = 0;
+    hash_foreach(elem, iter, hash) {
+        const void* key;
+        size_t keylen;
+        keyfn(elem, &key, &keylen);
+        items[n].hash  = fhash_hash(key, keylen, header.seed);
+        items[n].entry = elem;
+        n++;
+    }
+    bool ok = (flags & FHASH_PERFECT)
+        ? fhash_place_perfect(items, nkeys, slots, nslots, disp, nbuckets)
+        : fhash_place_probing(items, nkeys, slots, nslots);
+    /* Lay out the image and write it all in slot order. The image goes to a
+     * temporary file that is renamed over path once it is complete, so that
+     * processes with the old image mapped keep a valid mapping and a failed
+     * write never leaves a partial image behind. */
+    char* tmppath = (char*)emalloc(strlen(path) + sizeof(".tmp"));
+    strcpy(tmppath, path);
+    strcat(tmppath, ".tmp");
+    FILE* file = (ok ? fopen(tmppath, "wb") : NULL);
+    if (file != NULL) {
+        memcpy(header.magic, FHASH_MAGIC, sizeof(header.magic));
+        header.version   = FHASH_VERSION;
+        header.flags     = flags;
+        header.nkeys     = nkeys;
+        header.nslots    = nslots;
+        header.nbuckets  = nbuckets;
+        header.slots_off = sizeof(fhash_header_t);
+        header.disp_off  = header.slots_off + (nslots * sizeof(fhash_slot_t));
+        header.blob_off  = header.disp_off + (((nbuckets * sizeof(uint32_t)) + 7u) & ~(uint64_t)7u);
+        uint64_t offset  = header.blob_off;
+        fhash_slot_t* out = (fhash_slot_t*)ecalloc(nslots, sizeof(fhash_slot_t));
+        for (size_t i = 0; i < nslots; i++) {
+            const void *key, *val;
+            size_t keylen, vallen;
+            if (slots[i].entry == NULL)
+                continue;
+            keyfn(slots[i].entry, &key, &keylen);
+            valfn(slots[i].entry, &val, &vallen);
+            /* Slots record 32-bit lengths, so longer data cannot be laid out */
+            if ((keylen > UINT32_MAX) || (vallen > UINT32_MAX))
+                ok = false;
+            out[i].hash   = slots[i].hash;
+            out[i].offset = offset;
+            out[i].keylen = (uint32_t)keylen;
+            out[i].vallen = (uint32_t)vallen;
+            offset += keylen + vallen;
+        }
+        header.size = offset;
+        static const uint8_t zeros[8] = {0};
+        size_t pad = (size_t)(header.blob_off - header.disp_off) - (nbuckets * sizeof(uint32_t));
+        ok = ok && (1 == fwrite(&header, sizeof(header), 1, file))
+          && (nslots == fwrite(out, sizeof(fhash_slot_t), nslots, file))
+          && (nbuckets == fwrite(disp, sizeof(uint32_t), nbuckets, file))
+          && (pad == fwrite(zeros, 1, pad, file));
+        for (size_t i = 0; ok && i < nslots; i++) {
+            const void *key, *val;
+            size_t keylen, vallen;
+            if (slots[i].entry == NULL)
+                continue;
+            keyfn(slots[i].entry, &key, &keylen);
+            valfn(slots[i].entry, &val, &vallen);
+            ok = (keylen == fwrite(key, 1, keylen, file)) && (vallen == fwrite(val, 1, vallen, file));
+        }
+        free(out);
+        ok = ok && (0 == fflush(file)) && (0 == fsync(fileno(file)));
+        ok = (0 == fclose(file)) && ok;
+        ok = ok && (0 == rename(tmppath, path));
+        if (!ok)
+            unlink(tmppath);
+    } else {
+        ok = false;
+    }
+    free(tmppath);
+    free(disp);
+    free(slots);
+    free(items);
+    return ok;
+}
+
+/* Query Time
+ *****************************************************************************/
+/* True if count items of width bytes starting at off end at or before end.
+ * The values come from the image, so this is written to avoid overflow. */
+static inline bool fhash_fits(uint64_t off, uint64_t count, uint64_t width, uint64_t end) {
+    return (off <= end) && (count <= ((end - off) / width));
+}
+
+/* Attach to an image that is already in memory, validating its layout. Every
+ * slot and displacement is checked once here so that fhash_get can never
+ * read outside the image, however it was corrupted. */
+static bool fhash_map(fhash_t* fhash, const void* base, size_t size) {
+    const fhash_header_t* header = (const fhash_header_t*)base;
+    fhash->base   = (const uint8_t*)base;
+    fhash->size   = size;
+    fhash->mapped = false;
+    fhash->header = header;
+    if ((size < sizeof(fhash_header_t)) ||
+        (0 != memcmp(header->magic, FHASH_MAGIC, sizeof(header->magic))) ||
+        (header->version != FHASH_VERSION) ||
+        (header->size > size) ||
+        (header->nslots == 0) ||
+        (header->nkeys > header->nslots) ||
+        (!(header->flags & FHASH_PERFECT) && (header->nslots & (header->nslots - 1))) ||
+        ((header->flags & FHASH_PERFECT) && (header->nbuckets == 0)) ||
+        (header->slots_off < sizeof(fhash_header_t)) ||
+        (header->slots_off % sizeof(uint64_t)) ||
+        (header->disp_off % sizeof(uint32_t)) ||
+        !fhash_fits(header->slots_off, header->nslots, sizeof(fhash_slot_t), header->disp_off) ||
+        !fhash_fits(header->disp_off, header->nbuckets, sizeof(uint32_t), header->blob_off) ||
+        (header->blob_off > header->size))
+        return false;
+    fhash->slots = (const fhash_slot_t*)(fhash->base + header->slots_off);
+    fhash->disp  = (const uint32_t*)(fhash->base + header->disp_off);
+    /* Keys and values must lie in the blob, and a probing table needs an
+     * empty slot to end each lookup */
+    uint64_t empty = 0;
+    for (uint64_t i = 0; i < header->nslots; i++) {
+        const fhash_slot_t* slot = &(fhash->slots[i]);
+        if (slot->hash == 0)
+            empty++;
+        else if ((slot->offset < header->blob_off) ||
+                 !fhash_fits(slot->offset, (uint64_t)slot->keylen + slot->vallen, 1, header->size))
+            return false;
+    }
+    if (!(header->flags & FHASH_PERFECT) && (empty == 0))
+        return false;
+    for (uint64_t b = 0; (header->flags & FHASH_PERFECT) && b < header->nbuckets; b++) {
+        uint32_t d = fhash->disp[b];
+        if ((d & FHASH_DIRECT) && ((d & ~FHASH_DIRECT) >= header->nslots))
+            return false;
+    }
+    return true;
+}
+
+static bool fhash_open(fhash_t* fhash, const char* path) {
+    struct stat st;
+    void* base = MAP_FAILED;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    if ((0 == fstat(fd, &st)) && (st.st_size > 0))
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return false;
+    if (!fhash_map(fhash, base, (size_t)st.st_size)) {
+        munmap(base, (size_t)st.st_size);
+        return false;
+    }
+    fhash->mapped = true;
+    return true;
+}
+
+static void fhash_close(fhash_t* fhash) {
+    if (fhash->mapped)
+        munmap((void*)fhash->base, fhash->size);
+    fhash->base = NULL;
+    fhash->size = 0;
+}
+
+static size_t fhash_size(fhash_t* fhash) {
+    return (size_t)fhash->header->nkeys;
+}
+
+static inline bool fhash_match(fhash_t* fhash, const fhash_slot_t* slot, uint64_t hash, const void* key, size_t len) {
+    return (slot->hash == hash) && (slot->keylen == len) &&
+           (0 == memcmp(fhash->base + slot->offset, key, len));
+}
+
+static bool fhash_get(fhash_t* fhash, const void* key, size_t len, const void** val, size_t* vallen) {
+    const fhash_header_t* header = fhash->header;
+    uint64_t hash = fhash_hash(key, len, header->seed);
+    const fhash_slot_t* slot = NULL;
+    if (header->flags & FHASH_PERFECT) {
+        uint32_t d = fhash->disp[fhash_bucket(hash, header->nbuckets)];
+        size_t index = (d & FHASH_DIRECT) ? (d & ~FHASH_DIRECT) : (size_t)fhash_displace(hash, d, header->nslots);
+        if (fhash_match(fhash, &(fhash->slots[index]), hash, key, len))
+            slot = &(fhash->slots[index]);
+    } else {
+        size_t mask = (size_t)header->nslots - 1;
+        for (size_t index = (size_t)(hash & mask); fhash->slots[index].hash != 0; index = (index + 1) & mask) {
+            if (fhash_match(fhash, &(fhash->slots[index]), hash, key, len)) {
+                slot = &(fhash->slots[index]);
+                break;
+            }
+        }
+    }
+    if (slot != NULL) {
+        if (val)    *val    = fhash->base + slot->offset + slot->keylen;
+        if (vallen) *vallen = slot->vallen;
+    }
+    return (slot != NULL);
+}
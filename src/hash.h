@@ -18,6 +18,20 @@
     PERFORMANCE OF THIS SOFTWARE.
 */
 
+/*
+    NOTE: This file depends on stdc.h, and on alloc.h when the tables should
+    allocate their buckets through an allocator_t. Include alloc.h first in
+    that case.
+*/
+/* The allocator passed to hash_init_alloc or rhash_init_alloc must be NULL
+ * without alloc.h */
+#if !defined(ALLOC_H) && !defined(alloc_new)
+#define alloc_new(a, size)                     (assert((a) == NULL), malloc(size))
+#define alloc_zero(a, size)                    (assert((a) == NULL), calloc(1u, (size)))
+#define alloc_resize(a, ptr, oldsize, newsize) (assert((a) == NULL), realloc((ptr), (newsize)))
+#define alloc_free(a, ptr, size)               (assert((a) == NULL), free(ptr))
+#endif
+
 typedef struct hash_entry_t {
     unsigned int hash;
     struct hash_entry_t* next;
@@ -29,6 +43,18 @@ typedef int (*hash_cmpfn_t)(const hash_entry_t* entry1, const hash_entry_t* entr
 
 typedef void (*hash_freefn_t)(hash_entry_t* key);
 
+/* Flags accepted by hash_init_flags and hash_init_alloc */
+enum {
+    /* Spread rehashing across subsequent operations instead of stalling */
+    HASH_INCREMENTAL = (1 << 0),
+    /* Use power-of-two bucket counts indexed by masking a finalized hash */
+    HASH_POW2 = (1 << 1),
+};
+
+#ifndef HASH_REHASH_STEP
+#define HASH_REHASH_STEP 8u
+#endif
+
 typedef struct {
     size_t size;
     size_t bkt_count;
@@ -36,6 +62,12 @@ typedef struct {
     hash_hashfn_t hashfn;
     hash_cmpfn_t cmpfn;
     hash_freefn_t delfn;
+    unsigned int flags;
+    /* Bucket table being migrated by an in-progress rehash */
+    size_t old_count;
+    size_t migrated;
+    hash_entry_t** oldbuckets;
+    struct allocator_t* alloc;
 } hash_t;
 
 #define NUM_PRIMES (sizeof(Primes)/sizeof(unsigned int))
@@ -47,13 +79,6 @@ static unsigned int Primes[] = {
     805306457, 1610612741
 };
 
-static inline unsigned int num_buckets(unsigned int idx) {
-    return Primes[idx];
-}
-
-static void rehash(hash_t* hash);
-static void hash_set(hash_t* hash, hash_entry_t* entry);
-
 static uint64_t hash64(uint64_t key) {
     key = (~key) + (key << 21); // key = (key << 21) - key - 1;
     key = key ^ (key >> 24);
@@ -75,13 +100,128 @@ static uint32_t hash32(uint32_t key) {
    return key;
 }
 
-static uint32_t hash_bytes(uint8_t* key, size_t len) {
-    uint32_t a=31415u, b=27183u, hash;
-    for (hash=0; len > 0; key++, len--, a*=b)
-        hash = (a * hash) + *key;
-    return hash32(hash);
+/* Finalize a hash value so that its low bits can be used directly as an index
+ * into a power-of-two sized table without clustering. This takes the upper
+ * half of a Fibonacci multiply, which folds every input bit into the result
+ * for the cost of a single multiplication. The hash64/hash32 mixers work here
+ * too but cost more than the division they are meant to replace. */
+static inline uint32_t hash_fmix(uint32_t key) {
+    return (uint32_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 32);
+}
+
+/* Byte String Hashing
+ ******************************************************************************
+ * hash_bytes64 is a word-at-a-time hash derived from wyhash by Wang Yi
+ * (released into the public domain). Keys are consumed 16 or 48 bytes per
+ * iteration and each step is a single 64x64->128 bit multiply folded back to
+ * 64 bits, so throughput is limited by the multiplier rather than by a chain
+ * of per-byte operations. Words are read in native byte order.
+ */
+static const uint64_t Hash_Secret[4] = {
+    UINT64_C(0x2d358dccaa6c78a5), UINT64_C(0x8bb84b93962eacc9),
+    UINT64_C(0x4b33a62ed433d4a3), UINT64_C(0x4d5a2da51de1aa47)
+};
+
+/* Full 64x64->128 bit multiply, leaving the low half in a and high half in b */
+static inline void hash_mul128(uint64_t* a, uint64_t* b) {
+#ifdef __SIZEOF_INT128__
+    __extension__ unsigned __int128 r = (unsigned __int128)(*a) * (*b);
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = (t < rl);
+    uint64_t lo = t + (rm1 << 32);
+    c += (lo < t);
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t hash_mum(uint64_t a, uint64_t b) {
+    hash_mul128(&a, &b);
+    return (a ^ b);
+}
+
+static inline uint64_t hash_read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
 }
 
+static inline uint64_t hash_read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t hash_bytes64(const void* key, size_t len, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)key;
+    uint64_t a, b;
+    seed ^= hash_mum(seed ^ Hash_Secret[0], Hash_Secret[1]);
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t off = ((len >> 3) << 2);
+            a = (hash_read32(p) << 32) | hash_read32(p + off);
+            b = (hash_read32(p + len - 4) << 32) | hash_read32(p + len - 4 - off);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = hash_mum(hash_read64(p)      ^ Hash_Secret[1], hash_read64(p + 8)  ^ seed);
+                see1 = hash_mum(hash_read64(p + 16) ^ Hash_Secret[2], hash_read64(p + 24) ^ see1);
+                see2 = hash_mum(hash_read64(p + 32) ^ Hash_Secret[3], hash_read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = hash_mum(hash_read64(p) ^ Hash_Secret[1], hash_read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = hash_read64(p + i - 16);
+        b = hash_read64(p + i - 8);
+    }
+    a ^= Hash_Secret[1];
+    b ^= seed;
+    hash_mul128(&a, &b);
+    return hash_mum(a ^ Hash_Secret[0] ^ len, b ^ Hash_Secret[1]);
+}
+
+static uint32_t hash_bytes(const void* key, size_t len) {
+    uint64_t hash = hash_bytes64(key, len, 0);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/* Power-of-two tables start at 8 buckets and step through as many sizes as
+ * there are primes so both modes share the same growth limit. */
+static inline unsigned int num_buckets(hash_t* hash, unsigned int idx) {
+    return (hash->flags & HASH_POW2) ? (8u << idx) : Primes[idx];
+}
+
+static inline unsigned int bucket_index(hash_t* hash, unsigned int idx, unsigned int hashval) {
+    if (hash->flags & HASH_POW2)
+        return (hash_fmix(hashval) & ((8u << idx) - 1u));
+    else
+        return (hashval % Primes[idx]);
+}
+
+#ifdef __GNUC__
+#define hash_prefetch(addr) __builtin_prefetch(addr)
+#else
+#define hash_prefetch(addr) ((void)(addr))
+#endif
+
 static void find_entry(hash_t* hash, hash_entry_t** parent, hash_entry_t** current, hash_entry_t* entry) {
     while(*current != NULL) {
         if (((*current)->hash == entry->hash) &&
@@ -92,39 +232,97 @@ static void find_entry(hash_t* hash, hash_entry_t** parent, hash_entry_t** curre
     }
 }
 
+/* Move entries out of the old bucket table, at most nbuckets at a time. The
+ * keys are known to be unique so entries are pushed onto the front of their
+ * new chains without any comparisons. */
+static void hash_migrate(hash_t* hash, size_t nbuckets) {
+    size_t oldsize = num_buckets(hash, hash->old_count);
+    for (; (nbuckets > 0) && (hash->migrated < oldsize); nbuckets--, hash->migrated++) {
+        hash_entry_t* node = hash->oldbuckets[hash->migrated];
+        while (node != NULL) {
+            hash_entry_t* entry = node;
+            node = entry->next;
+            unsigned int index = bucket_index(hash, hash->bkt_count, entry->hash);
+            entry->next = hash->buckets[index];
+            hash->buckets[index] = entry;
+        }
+    }
+    if (hash->migrated >= oldsize) {
+        alloc_free(hash->alloc, hash->oldbuckets, oldsize * sizeof(hash_entry_t*));
+        hash->oldbuckets = NULL;
+    }
+}
+
+/* Switch to the bucket table at the given index in the size ladder. Entries
+ * are moved over right away unless incremental is set, in which case they are
+ * left for subsequent operations to migrate. */
+static void hash_resize(hash_t* hash, size_t idx, bool incremental) {
+    /* Only one migration may be in flight at a time */
+    if (hash->oldbuckets != NULL)
+        hash_migrate(hash, SIZE_MAX);
+    hash->old_count  = hash->bkt_count;
+    hash->bkt_count  = idx;
+    hash->migrated   = 0;
+    hash->oldbuckets = hash->buckets;
+    hash->buckets    = (hash_entry_t**)alloc_zero(hash->alloc, num_buckets(hash, hash->bkt_count) * sizeof(hash_entry_t*));
+    if (!incremental)
+        hash_migrate(hash, SIZE_MAX);
+}
+
 static void rehash(hash_t* hash) {
-    if ((hash->bkt_count+1) < NUM_PRIMES) {
-        unsigned int oldcount = hash->bkt_count++;
-        hash_entry_t** oldbuckets = hash->buckets;
-        hash->buckets = (hash_entry_t**)calloc(sizeof(hash_entry_t*), num_buckets(hash->bkt_count));
-        hash->size = 0;
-        /* Iterate over all of the old buckets */
-        for (unsigned int i = 0; i < num_buckets(oldcount); i++) {
-            hash_entry_t* node = oldbuckets[i];
-            /* re-insert all entries in the bucket into the new bucket table */
-            while (node != NULL) {
-                hash_entry_t* entry = node;
-                node = entry->next;
-                hash_set(hash, entry);
+    if ((hash->bkt_count+1) < NUM_PRIMES)
+        hash_resize(hash, hash->bkt_count+1, (hash->flags & HASH_INCREMENTAL));
+}
+
+/* Find the entry matching the given one in either bucket table. On return
+ * bucket and parent describe where the match is linked or, if there is no
+ * match, where a new entry should be linked. */
+static hash_entry_t* hash_locate(hash_t* hash, hash_entry_t* entry, hash_entry_t*** bucket, hash_entry_t** parent) {
+    *bucket = &(hash->buckets[bucket_index(hash, hash->bkt_count, entry->hash)]);
+    *parent = NULL;
+    hash_entry_t* node = **bucket;
+    find_entry(hash, parent, &node, entry);
+    if ((node == NULL) && (hash->oldbuckets != NULL)) {
+        size_t index = bucket_index(hash, hash->old_count, entry->hash);
+        if (index >= hash->migrated) {
+            hash_entry_t* oldparent = NULL;
+            hash_entry_t* oldnode   = hash->oldbuckets[index];
+            find_entry(hash, &oldparent, &oldnode, entry);
+            if (oldnode != NULL) {
+                *bucket = &(hash->oldbuckets[index]);
+                *parent = oldparent;
+                node    = oldnode;
             }
         }
-        /* Free the old bucket table */
-        free(oldbuckets);
     }
+    return node;
+}
+
+static void hash_init_alloc(hash_t* hash, hash_hashfn_t hashfn, hash_cmpfn_t cmpfn, hash_freefn_t delfn, unsigned int flags, struct allocator_t* alloc) {
+    hash->size       = 0;
+    hash->bkt_count  = 0;
+    hash->hashfn     = hashfn;
+    hash->cmpfn      = cmpfn;
+    hash->delfn      = delfn;
+    hash->flags      = flags;
+    hash->old_count  = 0;
+    hash->migrated   = 0;
+    hash->oldbuckets = NULL;
+    hash->alloc      = alloc;
+    hash->buckets    = (hash_entry_t**)alloc_zero(alloc, num_buckets(hash, hash->bkt_count) * sizeof(hash_entry_t*));
+}
+
+static void hash_init_flags(hash_t* hash, hash_hashfn_t hashfn, hash_cmpfn_t cmpfn, hash_freefn_t delfn, unsigned int flags) {
+    hash_init_alloc(hash, hashfn, cmpfn, delfn, flags, NULL);
 }
 
 static void hash_init(hash_t* hash, hash_hashfn_t hashfn, hash_cmpfn_t cmpfn, hash_freefn_t delfn) {
-    hash->size      = 0;
-    hash->bkt_count = 0;
-    hash->hashfn    = hashfn;
-    hash->cmpfn     = cmpfn;
-    hash->delfn     = delfn;
-    hash->buckets   = (hash_entry_t**)calloc(sizeof(hash_entry_t*), num_buckets(hash->bkt_count));
+    hash_init_flags(hash, hashfn, cmpfn, delfn, 0);
 }
 
 static void hash_clr(hash_t* hash) {
     /* Delete all the entries in the hash */
-    for (unsigned int i = 0; i < num_buckets(hash->bkt_count); i++) {
+    for (unsigned int i = 0; i < num_buckets(hash, hash->bkt_count); i++) {
         hash_entry_t* node = hash->buckets[i];
         hash->buckets[i] = NULL;
         while (node != NULL) {
@@ -133,11 +331,25 @@ static void hash_clr(hash_t* hash) {
             hash->delfn(deadite);
         }
     }
+    /* Along with any that have not been migrated yet */
+    if (hash->oldbuckets != NULL) {
+        for (size_t i = hash->migrated; i < num_buckets(hash, hash->old_count); i++) {
+            hash_entry_t* node = hash->oldbuckets[i];
+            while (node != NULL) {
+                hash_entry_t* deadite = node;
+                node = node->next;
+                hash->delfn(deadite);
+            }
+        }
+        alloc_free(hash->alloc, hash->oldbuckets, num_buckets(hash, hash->old_count) * sizeof(hash_entry_t*));
+        hash->oldbuckets = NULL;
+    }
+    hash->size = 0;
 }
 
 static void hash_deinit(hash_t* hash) {
     hash_clr(hash);
-    free(hash->buckets);
+    alloc_free(hash->alloc, hash->buckets, num_buckets(hash, hash->bkt_count) * sizeof(hash_entry_t*));
 }
 
 static size_t hash_size(hash_t* hash) {
@@ -145,62 +357,359 @@ static size_t hash_size(hash_t* hash) {
 }
 
 static void hash_set(hash_t* hash, hash_entry_t* entry) {
-    if (hash->size >= num_buckets(hash->bkt_count))
+    if (hash->oldbuckets != NULL)
+        hash_migrate(hash, HASH_REHASH_STEP);
+    if (hash->size >= num_buckets(hash, hash->bkt_count))
         rehash(hash);
     entry->hash = hash->hashfn(entry);
-    unsigned int index    = (entry->hash % num_buckets(hash->bkt_count));
-    hash_entry_t* parent  = NULL;
-    hash_entry_t* node    = hash->buckets[index];
-    hash_entry_t* deadite = NULL;
-    find_entry(hash, &parent, &node, entry);
-    if ((parent == NULL) && (node == NULL)) {
-        hash->buckets[index] = entry;
-        entry->next = NULL;
-        hash->size++;
-    } else if (node == NULL) {
-        parent->next = entry;
+    hash_entry_t** bucket;
+    hash_entry_t*  parent;
+    hash_entry_t*  node    = hash_locate(hash, entry, &bucket, &parent);
+    hash_entry_t*  deadite = NULL;
+    if (node == NULL) {
         entry->next = NULL;
         hash->size++;
-    } else if (parent == NULL) {
-        deadite = node;
-        entry->next = deadite->next;
-        hash->buckets[index] = entry;
     } else {
         deadite = node;
         entry->next = deadite->next;
-        parent->next = entry;
     }
+    if (parent == NULL)
+        *bucket = entry;
+    else
+        parent->next = entry;
     if (deadite != NULL)
         hash->delfn(deadite);
 }
 
 static hash_entry_t* hash_get(hash_t* hash, hash_entry_t* entry) {
+    if (hash->oldbuckets != NULL)
+        hash_migrate(hash, HASH_REHASH_STEP);
     entry->hash = hash->hashfn(entry);
-    unsigned int index   = (entry->hash % num_buckets(hash->bkt_count));
-    hash_entry_t* parent = NULL;
-    hash_entry_t* node   = hash->buckets[index];
-    find_entry(hash, &parent, &node, entry);
-    (void)parent;
-    return node;
+    hash_entry_t** bucket;
+    hash_entry_t*  parent;
+    return hash_locate(hash, entry, &bucket, &parent);
 }
 
 static bool hash_del(hash_t* hash, hash_entry_t* entry) {
-    bool ret = false;
+    if (hash->oldbuckets != NULL)
+        hash_migrate(hash, HASH_REHASH_STEP);
+    entry->hash = hash->hashfn(entry);
+    hash_entry_t** bucket;
+    hash_entry_t*  parent;
+    hash_entry_t*  node = hash_locate(hash, entry, &bucket, &parent);
+    if (node == NULL)
+        return false;
+    if (parent != NULL)
+        parent->next = node->next;
+    else
+        *bucket = node->next;
+    hash->delfn(node);
+    hash->size--;
+    return true;
+}
+
+/* Grow the table so that it can hold at least count entries without any
+ * further rehashing. Any migration in flight is completed as well. */
+static void hash_reserve(hash_t* hash, size_t count) {
+    size_t idx = hash->bkt_count;
+    while (((idx+1) < NUM_PRIMES) && (num_buckets(hash, idx) < count))
+        idx++;
+    if (idx != hash->bkt_count)
+        hash_resize(hash, idx, false);
+    else if (hash->oldbuckets != NULL)
+        hash_migrate(hash, SIZE_MAX);
+}
+
+/* Insert an entry whose key the caller guarantees is not already in the
+ * table. The entry is pushed onto the front of its chain with no comparisons.
+ * Inserting a duplicate this way leaves both entries in the table. */
+static void hash_set_unique(hash_t* hash, hash_entry_t* entry) {
+    if (hash->oldbuckets != NULL)
+        hash_migrate(hash, HASH_REHASH_STEP);
+    if (hash->size >= num_buckets(hash, hash->bkt_count))
+        rehash(hash);
+    entry->hash = hash->hashfn(entry);
+    hash_entry_t** bucket = &(hash->buckets[bucket_index(hash, hash->bkt_count, entry->hash)]);
+    entry->next = *bucket;
+    *bucket = entry;
+    hash->size++;
+}
+
+/* Bulk load an array of entries with unique keys, sizing the table once up
+ * front rather than climbing the size ladder one rehash at a time. */
+static void hash_load(hash_t* hash, hash_entry_t** entries, size_t count) {
+    hash_reserve(hash, hash->size + count);
+    for (size_t i = 0; i < count; i++)
+        hash_set_unique(hash, entries[i]);
+}
+
+/* Iteration
+ ******************************************************************************
+ * Walks the bucket array in order, followed by any buckets of an in-progress
+ * migration that have not been moved yet. The next entry is read before the
+ * current one is handed out, so the current entry may be removed with
+ * hash_del as long as the table is not HASH_INCREMENTAL (whose operations can
+ * migrate buckets out from under the iterator). Any other modification
+ * invalidates the iterator.
+ */
+#ifndef HASH_ITER_PREFETCH
+#define HASH_ITER_PREFETCH 8u
+#endif
+
+typedef struct {
+    hash_t* hash;
+    hash_entry_t** buckets;
+    size_t index;
+    size_t count;
+    hash_entry_t* next;
+} hash_iter_t;
+
+static hash_entry_t* hash_iter_next(hash_iter_t* iter) {
+    hash_t* hash = iter->hash;
+    while (iter->next == NULL) {
+        if (iter->index >= iter->count) {
+            /* Move on to the unmigrated part of the old table, if any */
+            if ((hash->oldbuckets == NULL) || (iter->buckets == hash->oldbuckets))
+                return NULL;
+            iter->buckets = hash->oldbuckets;
+            iter->index   = hash->migrated;
+            iter->count   = num_buckets(hash, hash->old_count);
+            continue;
+        }
+        /* Pull in the chain a few buckets ahead while this one is consumed */
+        if ((iter->index + HASH_ITER_PREFETCH) < iter->count)
+            hash_prefetch(iter->buckets[iter->index + HASH_ITER_PREFETCH]);
+        iter->next = iter->buckets[iter->index++];
+    }
+    hash_entry_t* entry = iter->next;
+    iter->next = entry->next;
+    return entry;
+}
+
+static hash_entry_t* hash_iter_first(hash_iter_t* iter, hash_t* hash) {
+    iter->hash    = hash;
+    iter->buckets = hash->buckets;
+    iter->index   = 0;
+    iter->count   = num_buckets(hash, hash->bkt_count);
+    iter->next    = NULL;
+    return hash_iter_next(iter);
+}
+
+#define hash_foreach(elem, iter, hash) \
+    for(hash_entry_t* elem = hash_iter_first(&(iter), (hash)); elem != NULL; elem = hash_iter_next(&(iter)))
+
+/* Look up a batch of entries at once, storing each match (or NULL) in the
+ * corresponding slot of results. Entries are processed HASH_BATCH_WIDTH at a
+ * time: every hash is computed and its bucket prefetched before any chain is
+ * walked, and the chains are then walked a step at a time in round-robin
+ * order so that the cache misses of the whole group overlap. */
+#ifndef HASH_BATCH_WIDTH
+#define HASH_BATCH_WIDTH 16u
+#endif
+
+static void hash_get_batch(hash_t* hash, hash_entry_t** entries, size_t n, hash_entry_t** results) {
+    hash_entry_t** heads[HASH_BATCH_WIDTH];
+    hash_entry_t* nodes[HASH_BATCH_WIDTH];
+    /* Lookups must probe both tables while a migration is in flight */
+    if (hash->oldbuckets != NULL) {
+        for (size_t i = 0; i < n; i++)
+            results[i] = hash_get(hash, entries[i]);
+        return;
+    }
+    for (size_t base = 0; base < n; base += HASH_BATCH_WIDTH) {
+        size_t count = ((n - base) < HASH_BATCH_WIDTH ? (n - base) : HASH_BATCH_WIDTH);
+        hash_entry_t** batch = &(entries[base]);
+        for (size_t i = 0; i < count; i++) {
+            batch[i]->hash = hash->hashfn(batch[i]);
+            heads[i] = &(hash->buckets[bucket_index(hash, hash->bkt_count, batch[i]->hash)]);
+            hash_prefetch(heads[i]);
+        }
+        for (size_t i = 0; i < count; i++) {
+            nodes[i] = *heads[i];
+            results[base + i] = NULL;
+            if (nodes[i] != NULL)
+                hash_prefetch(nodes[i]);
+        }
+        for (size_t active = count; active > 0;) {
+            active = 0;
+            for (size_t i = 0; i < count; i++) {
+                hash_entry_t* node = nodes[i];
+                if (node == NULL)
+                    continue;
+                if ((node->hash == batch[i]->hash) && (0 == hash->cmpfn(node, batch[i]))) {
+                    results[base + i] = node;
+                    nodes[i] = NULL;
+                } else if (NULL != (nodes[i] = node->next)) {
+                    hash_prefetch(nodes[i]);
+                    active++;
+                }
+            }
+        }
+    }
+}
+
+/* Open Addressing Table
+ ******************************************************************************
+ * The rhash_t type is a drop-in alternative to hash_t that uses the same
+ * hashfn/cmpfn/delfn callbacks but stores entries in a flat array of slots
+ * rather than chaining them through hash_entry_t::next. Collisions are
+ * resolved with Robin Hood linear probing and each slot caches the mixed hash
+ * of its entry so that most mismatches are rejected without touching the
+ * entry itself. The capacity is always a power of two.
+ */
+#ifndef RHASH_MAX_LOAD
+#define RHASH_MAX_LOAD 90u
+#endif
+
+#ifndef RHASH_MIN_CAPACITY
+#define RHASH_MIN_CAPACITY 8u
+#endif
+
+typedef struct {
+    unsigned int hash;
+    hash_entry_t* entry;
+} rhash_slot_t;
+
+typedef struct {
+    size_t size;
+    size_t capacity;
+    unsigned int max_load; /* percentage of capacity, must be less than 100 */
+    rhash_slot_t* slots;
+    hash_hashfn_t hashfn;
+    hash_cmpfn_t cmpfn;
+    hash_freefn_t delfn;
+    struct allocator_t* alloc;
+} rhash_t;
+
+static inline size_t rhash_dist(rhash_t* hash, size_t index, unsigned int mixed) {
+    return ((index - mixed) & (hash->capacity - 1));
+}
+
+/* Place an entry known not to be in the table starting at the given probe
+ * position, displacing any entry that sits closer to its home slot. */
+static void rhash_place(rhash_t* hash, size_t index, size_t dist, unsigned int mixed, hash_entry_t* entry) {
+    size_t mask = hash->capacity - 1;
+    while (hash->slots[index].entry != NULL) {
+        rhash_slot_t* slot = &(hash->slots[index]);
+        size_t sdist = rhash_dist(hash, index, slot->hash);
+        if (sdist < dist) {
+            rhash_slot_t tmp = *slot;
+            slot->hash  = mixed;
+            slot->entry = entry;
+            mixed = tmp.hash;
+            entry = tmp.entry;
+            dist  = sdist;
+        }
+        index = (index + 1) & mask;
+        dist++;
+    }
+    hash->slots[index].hash  = mixed;
+    hash->slots[index].entry = entry;
+}
+
+static void rhash_grow(rhash_t* hash) {
+    size_t oldcap = hash->capacity;
+    rhash_slot_t* oldslots = hash->slots;
+    hash->capacity = oldcap << 1;
+    hash->slots = (rhash_slot_t*)alloc_zero(hash->alloc, hash->capacity * sizeof(rhash_slot_t));
+    for (size_t i = 0; i < oldcap; i++) {
+        if (oldslots[i].entry != NULL) {
+            unsigned int mixed = oldslots[i].hash;
+            rhash_place(hash, mixed & (hash->capacity - 1), 0, mixed, oldslots[i].entry);
+        }
+    }
+    alloc_free(hash->alloc, oldslots, oldcap * sizeof(rhash_slot_t));
+}
+
+/* Returns the index of the slot holding a matching entry, or the capacity of
+ * the table if there is none. */
+static size_t rhash_find(rhash_t* hash, unsigned int mixed, hash_entry_t* entry) {
+    size_t mask  = hash->capacity - 1;
+    size_t index = mixed & mask;
+    for (size_t dist = 0;; dist++, index = (index + 1) & mask) {
+        rhash_slot_t* slot = &(hash->slots[index]);
+        if ((slot->entry == NULL) || (rhash_dist(hash, index, slot->hash) < dist))
+            return hash->capacity;
+        if ((slot->hash == mixed) && (0 == hash->cmpfn(slot->entry, entry)))
+            return index;
+    }
+}
+
+static void rhash_init_alloc(rhash_t* hash, hash_hashfn_t hashfn, hash_cmpfn_t cmpfn, hash_freefn_t delfn, struct allocator_t* alloc) {
+    hash->size     = 0;
+    hash->capacity = RHASH_MIN_CAPACITY;
+    hash->max_load = RHASH_MAX_LOAD;
+    hash->hashfn   = hashfn;
+    hash->cmpfn    = cmpfn;
+    hash->delfn    = delfn;
+    hash->alloc    = alloc;
+    hash->slots    = (rhash_slot_t*)alloc_zero(alloc, hash->capacity * sizeof(rhash_slot_t));
+}
+
+static void rhash_init(rhash_t* hash, hash_hashfn_t hashfn, hash_cmpfn_t cmpfn, hash_freefn_t delfn) {
+    rhash_init_alloc(hash, hashfn, cmpfn, delfn, NULL);
+}
+
+static void rhash_clr(rhash_t* hash) {
+    for (size_t i = 0; i < hash->capacity; i++) {
+        hash_entry_t* deadite = hash->slots[i].entry;
+        hash->slots[i].entry = NULL;
+        if (deadite != NULL)
+            hash->delfn(deadite);
+    }
+    hash->size = 0;
+}
+
+static void rhash_deinit(rhash_t* hash) {
+    rhash_clr(hash);
+    alloc_free(hash->alloc, hash->slots, hash->capacity * sizeof(rhash_slot_t));
+}
+
+static size_t rhash_size(rhash_t* hash) {
+    return hash->size;
+}
+
+/* Look the key up before checking the load, so that replacing an entry in
+ * a table at its load limit never grows it */
+static void rhash_set(rhash_t* hash, hash_entry_t* entry) {
     entry->hash = hash->hashfn(entry);
-    unsigned int index = (entry->hash % num_buckets(hash->bkt_count));
-    hash_entry_t* parent = NULL;
-    hash_entry_t* node = hash->buckets[index];
-    find_entry(hash, &parent, &node, entry);
-    if (node != NULL) {
-        hash_entry_t* deadite = node;
-        node = node->next;
-        if (parent != NULL)
-            parent->next = node;
-        else
-            hash->buckets[index] = node;
+    unsigned int mixed = hash_fmix(entry->hash);
+    size_t index = rhash_find(hash, mixed, entry);
+    if (index < hash->capacity) {
+        hash_entry_t* deadite = hash->slots[index].entry;
+        hash->slots[index].entry = entry;
         hash->delfn(deadite);
-        ret = true;
-        hash->size--;
+        return;
+    }
+    if ((hash->size + 1) * 100u > hash->capacity * hash->max_load)
+        rhash_grow(hash);
+    rhash_place(hash, mixed & (hash->capacity - 1), 0, mixed, entry);
+    hash->size++;
+}
+
+static hash_entry_t* rhash_get(rhash_t* hash, hash_entry_t* entry) {
+    entry->hash = hash->hashfn(entry);
+    size_t index = rhash_find(hash, hash_fmix(entry->hash), entry);
+    return (index < hash->capacity ? hash->slots[index].entry : NULL);
+}
+
+static bool rhash_del(rhash_t* hash, hash_entry_t* entry) {
+    entry->hash = hash->hashfn(entry);
+    size_t index = rhash_find(hash, hash_fmix(entry->hash), entry);
+    if (index >= hash->capacity)
+        return false;
+    hash_entry_t* deadite = hash->slots[index].entry;
+    /* Shift the following run of displaced entries back one slot */
+    size_t mask = hash->capacity - 1;
+    size_t next = (index + 1) & mask;
+    while ((hash->slots[next].entry != NULL) &&
+           (rhash_dist(hash, next, hash->slots[next].hash) > 0)) {
+        hash->slots[index] = hash->slots[next];
+        index = next;
+        next  = (next + 1) & mask;
     }
-    return ret;
+    hash->slots[index].entry = NULL;
+    hash->size--;
+    hash->delfn(deadite);
+    return true;
 }
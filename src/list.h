@@ -18,6 +18,13 @@
     PERFORMANCE OF THIS SOFTWARE.
 */
 
+/*
+    NOTE: The list is NULL terminated at both ends and caches its node count, so
+    every operation here other than the foreach walks is O(1). A node may be
+    in only one list at a time, and functions that take a node already in the
+    list (list_remove, list_insert_before, ...) trust that it really is in
+    that list.
+*/
 typedef struct list_node_t {
     struct list_node_t* next;
     struct list_node_t* prev;
@@ -26,11 +33,13 @@ typedef struct list_node_t {
 typedef struct {
     list_node_t* head;
     list_node_t* tail;
+    size_t count;
 } list_t;
 
 static void list_init(list_t* list) {
-    list->head = NULL;
-    list->tail = NULL;
+    list->head  = NULL;
+    list->tail  = NULL;
+    list->count = 0;
 }
 
 static bool list_empty(list_t* list) {
@@ -38,57 +47,119 @@ static bool list_empty(list_t* list) {
 }
 
 static size_t list_size(list_t* list) {
-    size_t sz = 0;
-    list_node_t* node = list->head;
-    while (node != NULL) {
-        sz++;
-        node = node->next;
-    }
-    return sz;
+    return list->count;
 }
 
 static list_node_t* list_front(list_t* list) {
     return list->head;
 }
 
-static void list_push_front(list_t* list, list_node_t* node) {
-    node->prev = NULL;
-    node->next = list->head;
-    list->head = node;
-    if (list->tail == NULL)
-        list->tail = node;
+static list_node_t* list_back(list_t* list) {
+    return list->tail;
 }
 
-static list_node_t* list_pop_front(list_t* list) {
-    list_node_t* node = list->head;
-    list->head = node->next;
-    if (list->head == NULL)
-        list->tail = NULL;
-    node->next = NULL;
-    return node;
+/* Link node into the list between prev and next, either of which may be NULL
+ * at the ends */
+static void list_link(list_t* list, list_node_t* prev, list_node_t* node, list_node_t* next) {
+    node->prev = prev;
+    node->next = next;
+    if (prev != NULL)
+        prev->next = node;
+    else
+        list->head = node;
+    if (next != NULL)
+        next->prev = node;
+    else
+        list->tail = node;
+    list->count++;
 }
 
-static list_node_t* list_back(list_t* list) {
-    return list->tail;
+static void list_push_front(list_t* list, list_node_t* node) {
+    list_link(list, NULL, node, list->head);
 }
 
 static void list_push_back(list_t* list, list_node_t* node) {
+    list_link(list, list->tail, node, NULL);
+}
+
+static void list_insert_before(list_t* list, list_node_t* pos, list_node_t* node) {
+    list_link(list, pos->prev, node, pos);
+}
+
+static void list_insert_after(list_t* list, list_node_t* pos, list_node_t* node) {
+    list_link(list, pos, node, pos->next);
+}
+
+/* Unlink node from wherever it sits in the list */
+static void list_remove(list_t* list, list_node_t* node) {
+    if (node->prev != NULL)
+        node->prev->next = node->next;
+    else
+        list->head = node->next;
+    if (node->next != NULL)
+        node->next->prev = node->prev;
+    else
+        list->tail = node->prev;
     node->next = NULL;
-    node->prev = list->tail;
-    list->tail = node;
-    if (list->head == NULL)
-        list->head = node;
+    node->prev = NULL;
+    list->count--;
 }
 
+/* Returns NULL if the list is empty */
+static list_node_t* list_pop_front(list_t* list) {
+    list_node_t* node = list->head;
+    if (node != NULL)
+        list_remove(list, node);
+    return node;
+}
+
+/* Returns NULL if the list is empty */
 static list_node_t* list_pop_back(list_t* list) {
     list_node_t* node = list->tail;
-    list->tail = node->prev;
-    if (list->tail == NULL)
-        list->head = NULL;
-    node->prev = NULL;
+    if (node != NULL)
+        list_remove(list, node);
     return node;
 }
 
+/* Move a node already in the list to the front, e.g. on an LRU cache hit */
+static void list_move_front(list_t* list, list_node_t* node) {
+    if (list->head != node) {
+        list_remove(list, node);
+        list_push_front(list, node);
+    }
+}
+
+static void list_move_back(list_t* list, list_node_t* node) {
+    if (list->tail != node) {
+        list_remove(list, node);
+        list_push_back(list, node);
+    }
+}
+
+/* Move every node of src into dest just before pos, or onto the end of dest
+ * if pos is NULL, leaving src empty */
+static void list_splice(list_t* dest, list_node_t* pos, list_t* src) {
+    if (src->head == NULL)
+        return;
+    list_node_t* prev = (pos != NULL ? pos->prev : dest->tail);
+    src->head->prev = prev;
+    if (prev != NULL)
+        prev->next = src->head;
+    else
+        dest->head = src->head;
+    src->tail->next = pos;
+    if (pos != NULL)
+        pos->prev = src->tail;
+    else
+        dest->tail = src->tail;
+    dest->count += src->count;
+    list_init(src);
+}
+
+static void list_append(list_t* dest, list_t* src) {
+    list_splice(dest, NULL, src);
+}
+
 static bool list_node_has_next(list_node_t* node) {
     return (node->next != NULL);
 }
@@ -104,3 +175,15 @@ static bool list_node_has_prev(list_node_t* node) {
 static list_node_t* list_node_prev(list_node_t* node) {
     return node->prev;
 }
+
+#define list_foreach(elem, list) \
+    for(list_node_t* elem = list_front(list); elem != NULL; elem = elem->next)
+
+#define list_foreach_reverse(elem, list) \
+    for(list_node_t* elem = list_back(list); elem != NULL; elem = elem->prev)
+
+/* Like list_foreach but elem may be removed or moved inside the loop body, as
+ * its successor is read before the body runs */
+#define list_foreach_safe(elem, next, list) \
+    for(list_node_t *elem = list_front(list), *next = (elem ? elem->next : NULL); \
+        elem != NULL; elem = next, next = (elem ? elem->next : NULL))
@@ -0,0 +1,287 @@
+/**
+    Lock-free intrusive stack and queues built on slist_node_t.
+
+    Copyright 2017, Michael D. Lowis
+
+    Permission to use, copy, modify, and/or distribute this software
+    for any purpose with or without fee is hereby granted, provided
+    that the above copyright notice and this permission notice appear
+    in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+    WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+    AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+    DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA
+    OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+    TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+    PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef LOCKFREE_H
+#define LOCKFREE_H
+
+/*
+    NOTE: This file depends on stdc.h and slist.h and on C11 atomics, which
+    compilers in C99 mode accept as an extension. Every atomic is a single
+    word (or a 64-bit word on 32-bit targets), so they are all lock-free and
+    inlined without -mcx16 or -latomic.
+
+    lfstack_t is a Treiber stack. Its top pairs the head pointer with a tag
+    that changes on every update, so a pop that read a node which was popped
+    and pushed back in the meantime fails its swap instead of corrupting the
+    list (the ABA problem). On 64-bit targets the tag is 16 bits, so this
+    only fails if the top changes 65536 times between a pop's load and its
+    swap. A popping thread may still read the next link of a node that
+    another thread has just popped, so nodes must stay mapped while any
+    thread may be popping; reusing them is fine.
+
+    mpscq_t is Dmitry Vyukov's intrusive multi-producer single-consumer
+    queue. Producers never wait on each other or on the consumer: a push is
+    one atomic exchange and one store. Only one thread may pop at a time. A
+    pop can come back empty while a producer is half way through a push,
+    even though the queue holds other nodes; it finds them on a later call.
+
+    mpmcq_t is Vyukov's bounded multi-producer multi-consumer ring of node
+    pointers. Each cell carries a sequence number saying whether it is ready
+    to be written or read for the current lap, so producers and consumers
+    only contend on their own position counters.
+
+    The stack and the MPSC queue link nodes through slist_node_t.next, which
+    is accessed through an atomic pointer of the same size and alignment.
+    While a node is in one of them it must not be in any other list.
+*/
+#include <stdatomic.h>
+
+#ifndef LOCKFREE_CACHE_LINE
+#define LOCKFREE_CACHE_LINE 64u
+#endif
+
+static slist_node_t* lockfree_next(slist_node_t* node, memory_order order) {
+    return atomic_load_explicit((_Atomic(slist_node_t*)*)&(node->next), order);
+}
+
+static void lockfree_set_next(slist_node_t* node, slist_node_t* next, memory_order order) {
+    atomic_store_explicit((_Atomic(slist_node_t*)*)&(node->next), next, order);
+}
+
+/* Treiber Stack
+ *****************************************************************************/
+/* The top packs the head pointer and the tag into one word so that it can be
+ * swapped with an ordinary compare-and-swap. User space addresses on 64-bit
+ * targets fit in the low 48 bits, leaving the top 16 for the tag. 32-bit
+ * targets pair the pointer with a 32-bit tag in a 64-bit word. */
+#if UINTPTR_MAX > 0xFFFFFFFFu
+typedef uintptr_t lfstack_word_t;
+#define LFSTACK_PTR_BITS 48u
+#else
+typedef uint64_t lfstack_word_t;
+#define LFSTACK_PTR_BITS 32u
+#endif
+
+#define LFSTACK_PTR_MASK ((((lfstack_word_t)1) << LFSTACK_PTR_BITS) - 1u)
+#define LFSTACK_TAG_ONE  (((lfstack_word_t)1) << LFSTACK_PTR_BITS)
+
+typedef struct {
+    _Atomic(lfstack_word_t) top;
+} lfstack_t;
+
+static inline slist_node_t* lfstack_head(lfstack_word_t top) {
+    return (slist_node_t*)(uintptr_t)(top & LFSTACK_PTR_MASK);
+}
+
+/* The tag lives in the bits above the pointer, so bumping it lets any carry
+ * out of the word fall away */
+static inline lfstack_word_t lfstack_top(lfstack_word_t old, slist_node_t* head) {
+    assert((((lfstack_word_t)(uintptr_t)head) & ~LFSTACK_PTR_MASK) == 0);
+    return ((old & ~LFSTACK_PTR_MASK) + LFSTACK_TAG_ONE) | (lfstack_word_t)(uintptr_t)head;
+}
+
+static void lfstack_init(lfstack_t* stack) {
+    atomic_init(&(stack->top), 0);
+}
+
+static bool lfstack_empty(lfstack_t* stack) {
+    return (lfstack_head(atomic_load_explicit(&(stack->top), memory_order_relaxed)) == NULL);
+}
+
+/* Push the chain of nodes from first through last, already linked through
+ * their next pointers, in one swap */
+static void lfstack_push_chain(lfstack_t* stack, slist_node_t* first, slist_node_t* last) {
+    lfstack_word_t top = atomic_load_explicit(&(stack->top), memory_order_relaxed);
+    do {
+        lockfree_set_next(last, lfstack_head(top), memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&(stack->top), &top, lfstack_top(top, first), memory_order_release, memory_order_relaxed));
+}
+
+static void lfstack_push(lfstack_t* stack, slist_node_t* node) {
+    lfstack_push_chain(stack, node, node);
+}
+
+/* Returns NULL if the stack is empty */
+static slist_node_t* lfstack_pop(lfstack_t* stack) {
+    lfstack_word_t top = atomic_load_explicit(&(stack->top), memory_order_acquire);
+    slist_node_t* head;
+    do {
+        if ((head = lfstack_head(top)) == NULL)
+            return NULL;
+    } while (!atomic_compare_exchange_weak_explicit(&(stack->top), &top, lfstack_top(top, lockfree_next(head, memory_order_relaxed)), memory_order_acquire, memory_order_acquire));
+    lockfree_set_next(head, NULL, memory_order_relaxed);
+    return head;
+}
+
+/* Take every node at once, returned as a chain in pop order */
+static slist_node_t* lfstack_pop_all(lfstack_t* stack) {
+    lfstack_word_t top = atomic_load_explicit(&(stack->top), memory_order_relaxed);
+    do {
+        if (lfstack_head(top) == NULL)
+            return NULL;
+    } while (!atomic_compare_exchange_weak_explicit(&(stack->top), &top, lfstack_top(top, NULL), memory_order_acquire, memory_order_relaxed));
+    return lfstack_head(top);
+}
+
+/* Multi-Producer Single-Consumer Queue
+ *****************************************************************************/
+/* Producers swap nodes into head; the consumer pops from tail. The stub node
+ * keeps the list from ever becoming empty. The queue must not be moved once
+ * initialized, as the list may point at its stub. */
+typedef struct {
+    _Atomic(slist_node_t*) head;
+    char pad[LOCKFREE_CACHE_LINE - sizeof(_Atomic(slist_node_t*))];
+    slist_node_t* tail;
+    slist_node_t stub;
+} mpscq_t;
+
+static void mpscq_init(mpscq_t* queue) {
+    queue->stub.next = NULL;
+    queue->tail      = &(queue->stub);
+    atomic_init(&(queue->head), &(queue->stub));
+}
+
+/* Safe to call from any number of threads at once */
+static void mpscq_push(mpscq_t* queue, slist_node_t* node) {
+    lockfree_set_next(node, NULL, memory_order_relaxed);
+    slist_node_t* prev = atomic_exchange_explicit(&(queue->head), node, memory_order_acq_rel);
+    lockfree_set_next(prev, node, memory_order_release);
+}
+
+/* Consumer only. Returns NULL if the queue is empty or the next node's
+ * producer has not yet finished linking it in. */
+static slist_node_t* mpscq_pop(mpscq_t* queue) {
+    slist_node_t* tail = queue->tail;
+    slist_node_t* next = lockfree_next(tail, memory_order_acquire);
+    if (tail == &(queue->stub)) {
+        if (next == NULL)
+            return NULL;
+        queue->tail = next;
+        tail = next;
+        next = lockfree_next(next, memory_order_acquire);
+    }
+    if (next != NULL) {
+        queue->tail = next;
+        tail->next  = NULL;
+        return tail;
+    }
+    /* tail is the last linked node. Unless a push is in progress, put the
+     * stub back behind it so tail can be handed out. */
+    if (tail != atomic_load_explicit(&(queue->head), memory_order_acquire))
+        return NULL;
+    mpscq_push(queue, &(queue->stub));
+    next = lockfree_next(tail, memory_order_acquire);
+    if (next != NULL) {
+        queue->tail = next;
+        tail->next  = NULL;
+        return tail;
+    }
+    return NULL;
+}
+
+/* Consumer only */
+static bool mpscq_empty(mpscq_t* queue) {
+    slist_node_t* tail = queue->tail;
+    return ((tail == &(queue->stub)) && (lockfree_next(tail, memory_order_acquire) == NULL));
+}
+
+/* Bounded Multi-Producer Multi-Consumer Ring
+ *****************************************************************************/
+typedef struct {
+    atomic_size_t seq;
+    slist_node_t* node;
+} mpmcq_cell_t;
+
+typedef struct {
+    mpmcq_cell_t* cells;
+    size_t mask;
+    char pad0[LOCKFREE_CACHE_LINE - sizeof(mpmcq_cell_t*) - sizeof(size_t)];
+    atomic_size_t enqueue_pos;
+    char pad1[LOCKFREE_CACHE_LINE - sizeof(atomic_size_t)];
+    atomic_size_t dequeue_pos;
+    char pad2[LOCKFREE_CACHE_LINE - sizeof(atomic_size_t)];
+} mpmcq_t;
+
+/* capacity must be a power of two of at least 2 */
+static void mpmcq_init(mpmcq_t* queue, size_t capacity) {
+    assert((capacity >= 2) && ((capacity & (capacity - 1)) == 0));
+    queue->cells = (mpmcq_cell_t*)emalloc(capacity * sizeof(mpmcq_cell_t));
+    queue->mask  = capacity - 1;
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&(queue->cells[i].seq), i);
+        queue->cells[i].node = NULL;
+    }
+    atomic_init(&(queue->enqueue_pos), 0);
+    atomic_init(&(queue->dequeue_pos), 0);
+}
+
+static void mpmcq_deinit(mpmcq_t* queue) {
+    free(queue->cells);
+    queue->cells = NULL;
+}
+
+static size_t mpmcq_capacity(mpmcq_t* queue) {
+    return queue->mask + 1;
+}
+
+/* Returns false if the ring is full */
+static bool mpmcq_push(mpmcq_t* queue, slist_node_t* node) {
+    mpmcq_cell_t* cell;
+    size_t pos = atomic_load_explicit(&(queue->enqueue_pos), memory_order_relaxed);
+    while (true) {
+        cell = &(queue->cells[pos & queue->mask]);
+        size_t seq = atomic_load_explicit(&(cell->seq), memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&(queue->enqueue_pos), &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = atomic_load_explicit(&(queue->enqueue_pos), memory_order_relaxed);
+        }
+    }
+    cell->node = node;
+    atomic_store_explicit(&(cell->seq), pos + 1, memory_order_release);
+    return true;
+}
+
+/* Returns NULL if the ring is empty */
+static slist_node_t* mpmcq_pop(mpmcq_t* queue) {
+    mpmcq_cell_t* cell;
+    size_t pos = atomic_load_explicit(&(queue->dequeue_pos), memory_order_relaxed);
+    while (true) {
+        cell = &(queue->cells[pos & queue->mask]);
+        size_t seq = atomic_load_explicit(&(cell->seq), memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&(queue->dequeue_pos), &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&(queue->dequeue_pos), memory_order_relaxed);
+        }
+    }
+    slist_node_t* node = cell->node;
+    atomic_store_explicit(&(cell->seq), pos + queue->mask + 1, memory_order_release);
+    return node;
+}
+
+#endif /* LOCKFREE_H */
@@ -23,7 +23,17 @@
     that that type be defined by users of this file prior to including it. In
     this way, the user can define it in whatever way makes sense for their
     parser.
+
+    NOTE: This file depends on stdc.h, and on alloc.h when the token and
+    marker buffers should be allocated through an allocator_t. Include
+    alloc.h first in that case.
 */
+#if !defined(ALLOC_H) && !defined(alloc_new)
+#define alloc_new(a, size)                     (assert((a) == NULL), malloc(size))
+#define alloc_zero(a, size)                    (assert((a) == NULL), calloc(1u, (size)))
+#define alloc_resize(a, ptr, oldsize, newsize) (assert((a) == NULL), realloc((ptr), (newsize)))
+#define alloc_free(a, ptr, size)               (assert((a) == NULL), free(ptr))
+#endif
 
 typedef struct {
     int type;
@@ -48,6 +58,8 @@ typedef struct {
     size_t* markers;
     size_t markcount;
     size_t markcap;
+    /* Allocator for the token and marker buffers */
+    struct allocator_t* alloc;
 } parser_t;
 
 static void parse_error(parser_t* ctx, const char* msgfmt, ...) {
@@ -60,19 +72,31 @@ static void parse_error(parser_t* ctx, const char* msgfmt, ...) {
     exit(EXIT_FAILURE);
 }
 
-static void parse_init(parser_t* ctx, lexfn_t lexfunc, void* lexdata) {
+static void parse_init_alloc(parser_t* ctx, lexfn_t lexfunc, void* lexdata, struct allocator_t* alloc) {
     /* Lexer data */
     ctx->lexfunc = lexfunc;
     ctx->lexdata = lexdata;
+    ctx->alloc   = alloc;
     /* Token buffer data */
     ctx->current  = 0;
     ctx->tokcount = 0;
     ctx->tokcap   = 8;
-    ctx->tokens   = calloc(ctx->tokcap, sizeof(token_t));
+    ctx->tokens   = alloc_zero(alloc, ctx->tokcap * sizeof(token_t));
     /* Backtracking data */
     ctx->markcount = 0;
     ctx->markcap   = 8;
-    ctx->markers   = calloc(ctx->markcap, sizeof(size_t));
+    ctx->markers   = alloc_zero(alloc, ctx->markcap * sizeof(size_t));
+}
+
+static void parse_init(parser_t* ctx, lexfn_t lexfunc, void* lexdata) {
+    parse_init_alloc(ctx, lexfunc, lexdata, NULL);
+}
+
+static void parse_deinit(parser_t* ctx) {
+    alloc_free(ctx->alloc, ctx->tokens, ctx->tokcap * sizeof(token_t));
+    alloc_free(ctx->alloc, ctx->markers, ctx->markcap * sizeof(size_t));
+    ctx->tokens  = NULL;
+    ctx->markers = NULL;
 }
 
 static void seek(parser_t* ctx, size_t idx) {
@@ -86,8 +110,8 @@ static bool speculating(parser_t* ctx) {
 static void fill(parser_t* ctx, size_t num) {
     for (size_t i = 0; i < num; i++) {
         if ((ctx->tokcount+1) >= ctx->tokcap) {
+            ctx->tokens  = (token_t*)alloc_resize(ctx->alloc, ctx->tokens, ctx->tokcap * sizeof(token_t), ctx->tokcap * 2 * sizeof(token_t));
             ctx->tokcap *= 2;
-            ctx->tokens  = (token_t*)realloc(ctx->tokens, ctx->tokcap * sizeof(token_t));
         }
         ctx->lexfunc(ctx->lexdata, &(ctx->tokens[ctx->tokcount]));
         ctx->tokcount++;
@@ -138,8 +162,8 @@ static void expect(parser_t* ctx, int toktype) {
 
 static size_t mark(parser_t* ctx) {
     if ((ctx->markcount+1) >= ctx->markcap) {
+        ctx->markers = (size_t*)alloc_resize(ctx->alloc, ctx->markers, ctx->markcap * sizeof(size_t), ctx->markcap * 2 * sizeof(size_t));
         ctx->markcap *= 2;
-        ctx->markers = (size_t*)realloc(ctx->markers, ctx->markcap * sizeof(size_t));
     }
     ctx->markers[ctx->markcount++] = ctx->current;
     return ctx->current;
@@ -0,0 +1,335 @@
+/**
+    Chunked string builder (rope) for very large outputs.
+
+    Copyright 2017, Michael D. Lowis
+
+    Permission to use, copy, modify, and/or distribute this software
+    for any purpose with or without fee is hereby granted, provided
+    that the above copyright notice and this permission notice appear
+    in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+    WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+    AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+    DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA
+    OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+    TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+    PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef ROPE_H
+#define ROPE_H
+
+/*
+    NOTE: This file depends on stdc.h, utf8.h, slist.h and strbuf.h, and on
+    POSIX writev. Define _POSIX_C_SOURCE to 200112L or later before including
+    any system headers. As with strbuf.h, include alloc.h first to allocate
+    chunks through an allocator_t.
+
+    A rope_t offers the strbuf_t append functions but stores its contents in
+    a chain of fixed size chunks instead of one contiguous string. Appending
+    never moves data that was already written, so building a very large
+    output costs one copy of each byte and at most one partly filled chunk
+    of slack, where a strbuf_t copies everything on each doubling and briefly
+    holds both the old and new strings. The chunks can be written out with
+    writev or handed to the caller as iovecs without flattening them first.
+    Rope contents are not NUL terminated.
+*/
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifndef ROPE_CHUNK_SIZE
+#define ROPE_CHUNK_SIZE (size_t)65536
+#endif
+
+/* Number of iovecs passed to each writev call */
+#ifndef ROPE_IOV_MAX
+#define ROPE_IOV_MAX 64u
+#endif
+
+/* Chunk data follows the header */
+typedef struct {
+    slist_node_t link;
+    size_t size;
+    size_t used;
+} rope_chunk_t;
+
+typedef struct {
+    slist_t chunks;
+    rope_chunk_t* tail;
+    size_t length;
+    size_t nchunks;
+    size_t chunk_size;
+    struct allocator_t* alloc;
+} rope_t;
+
+static char* rope_chunk_data(rope_chunk_t* chunk) {
+    return (char*)(chunk + 1);
+}
+
+static rope_chunk_t* rope_chunk_next(rope_chunk_t* chunk) {
+    slist_node_t* next = slist_node_next(&(chunk->link));
+    return (next ? container_of(next, rope_chunk_t, link) : NULL);
+}
+
+#define rope_foreach(chunk, rope) \
+    for (rope_chunk_t* chunk = rope_front(rope); chunk != NULL; chunk = rope_chunk_next(chunk))
+
+static void rope_init_alloc(rope_t* rope, size_t chunk_size, struct allocator_t* alloc) {
+    slist_init(&(rope->chunks));
+    rope->tail       = NULL;
+    rope->length     = 0;
+    rope->nchunks    = 0;
+    rope->chunk_size = (chunk_size ? chunk_size : ROPE_CHUNK_SIZE);
+    rope->alloc      = alloc;
+}
+
+static void rope_init(rope_t* rope, size_t chunk_size) {
+    rope_init_alloc(rope, chunk_size, NULL);
+}
+
+/* Release every chunk, leaving an empty rope that can be appended to again */
+static void rope_clear(rope_t* rope) {
+    while (!slist_empty(&(rope->chunks))) {
+        rope_chunk_t* chunk = container_of(slist_pop_front(&(rope->chunks)), rope_chunk_t, link);
+        alloc_free(rope->alloc, chunk, sizeof(rope_chunk_t) + chunk->size);
+    }
+    rope->tail    = NULL;
+    rope->length  = 0;
+    rope->nchunks = 0;
+}
+
+static void rope_deinit(rope_t* rope) {
+    rope_clear(rope);
+}
+
+static size_t rope_size(rope_t* rope) {
+    return rope->length;
+}
+
+static bool rope_empty(rope_t* rope) {
+    return (rope->length == 0);
+}
+
+static rope_chunk_t* rope_front(rope_t* rope) {
+    slist_node_t* head = slist_front(&(rope->chunks));
+    return (head ? container_of(head, rope_chunk_t, link) : NULL);
+}
+
+/* Link a new chunk holding at least size bytes onto the end of the chain.
+ * The tail is appended to directly as slist_push_back walks the list. */
+static rope_chunk_t* rope_add_chunk(rope_t* rope, size_t size) {
+    if (size < rope->chunk_size)
+        size = rope->chunk_size;
+    rope_chunk_t* chunk = (rope_chunk_t*)alloc_new(rope->alloc, sizeof(rope_chunk_t) + size);
+    if (chunk == NULL)
+        fatal("rope_add_chunk failed:");
+    chunk->link.next = NULL;
+    chunk->size      = size;
+    chunk->used      = 0;
+    if (rope->tail != NULL)
+        rope->tail->link.next = &(chunk->link);
+    else
+        slist_push_front(&(rope->chunks), &(chunk->link));
+    rope->tail = chunk;
+    rope->nchunks++;
+    return chunk;
+}
+
+/* Return a pointer to len contiguous bytes of free space at the end of the
+ * rope. Nothing is appended until rope_commit is called. */
+static char* rope_reserve(rope_t* rope, size_t len) {
+    rope_chunk_t* chunk = rope->tail;
+    if ((chunk == NULL) || (len > (chunk->size - chunk->used)))
+        chunk = rope_add_chunk(rope, len);
+    return &(rope_chunk_data(chunk)[chunk->used]);
+}
+
+/* Append len bytes previously written into space from rope_reserve */
+static void rope_commit(rope_t* rope, size_t len) {
+    rope->tail->used += len;
+    rope->length     += len;
+}
+
+static void rope_add_char(rope_t* rope, char ch) {
+    *rope_reserve(rope, 1u) = ch;
+    rope_commit(rope, 1u);
+}
+
+/* Fill the tail chunk and spill whatever is left into one new chunk */
+static void rope_add_bytes(rope_t* rope, const char* bytes, size_t len) {
+    rope_chunk_t* chunk = rope->tail;
+    if (chunk != NULL) {
+        size_t spare = chunk->size - chunk->used;
+        size_t count = (len < spare ? len : spare);
+        memcpy(&(rope_chunk_data(chunk)[chunk->used]), bytes, count);
+        rope_commit(rope, count);
+        bytes += count;
+        len   -= count;
+    }
+    if (len > 0) {
+        chunk = rope_add_chunk(rope, len);
+        memcpy(rope_chunk_data(chunk), bytes, len);
+        rope_commit(rope, len);
+    }
+}
+
+static void rope_add_string(rope_t* rope, char* str) {
+    rope_add_bytes(rope, str, strlen(str));
+}
+
+static void rope_add_rune(rope_t* rope, Rune rune) {
+    char utf[UTF_MAX] = {0};
+    rope_add_bytes(rope, utf, utf8encode(utf, rune));
+}
+
+static void rope_add_strbuf(rope_t* rope, strbuf_t* buf) {
+    if (buf->string != NULL)
+        rope_add_bytes(rope, buf->string, buf->index);
+}
+
+/* Move every chunk of src onto the end of dest without copying, leaving src
+ * empty. Both ropes must use the same allocator. */
+static void rope_splice(rope_t* dest, rope_t* src) {
+    rope_chunk_t* front = rope_front(src);
+    if (front == NULL)
+        return;
+    if (dest->tail != NULL)
+        dest->tail->link.next = &(front->link);
+    else
+        dest->chunks.head = &(front->link);
+    dest->tail     = src->tail;
+    dest->length  += src->length;
+    dest->nchunks += src->nchunks;
+    slist_init(&(src->chunks));
+    src->tail    = NULL;
+    src->length  = 0;
+    src->nchunks = 0;
+}
+
+/* Formatted Appends
+ *****************************************************************************/
+/* Format into the tail chunk when it has room, otherwise into space reserved
+ * for the exact length. vsnprintf needs room for a terminator that is not
+ * committed. */
+static void rope_vprintf(rope_t* rope, const char* fmt, va_list args) {
+    va_list copy;
+    rope_chunk_t* chunk = rope->tail;
+    size_t spare = (chunk ? chunk->size - chunk->used : 0);
+    va_copy(copy, args);
+    int len = vsnprintf((spare ? &(rope_chunk_data(chunk)[chunk->used]) : NULL), spare, fmt, copy);
+    va_end(copy);
+    if (len < 0)
+        return;
+    if ((size_t)len >= spare)
+        vsnprintf(rope_reserve(rope, (size_t)len + 1u), (size_t)len + 1u, fmt, args);
+    rope_commit(rope, (size_t)len);
+}
+
+static void rope_printf(rope_t* rope, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    rope_vprintf(rope, fmt, args);
+    va_end(args);
+}
+
+/* Numbers are formatted by the strbuf_t routines into its inline buffer,
+ * which every number fits in, so no allocation takes place */
+static void rope_add_u64(rope_t* rope, uint64_t val) {
+    strbuf_t digits;
+    strbuf_reset(&digits);
+    strbuf_add_u64(&digits, val);
+    rope_add_strbuf(rope, &digits);
+    strbuf_deinit(&digits);
+}
+
+static void rope_add_i64(rope_t* rope, int64_t val) {
+    strbuf_t digits;
+    strbuf_reset(&digits);
+    strbuf_add_i64(&digits, val);
+    rope_add_strbuf(rope, &digits);
+    strbuf_deinit(&digits);
+}
+
+static void rope_add_double(rope_t* rope, double val) {
+    strbuf_t digits;
+    strbuf_reset(&digits);
+    strbuf_add_double(&digits, val);
+    rope_add_strbuf(rope, &digits);
+    strbuf_deinit(&digits);
+}
+
+/* Output
+ *****************************************************************************/
+/* Describe up to max chunks starting at *cursor with iovecs pointing into
+ * the rope, skipping empty ones, and advance *cursor past them. Start with
+ * *cursor set to rope_front(rope). Returns the number of iovecs filled, 0
+ * once every chunk has been described. The iovecs are valid until the rope
+ * is next modified. */
+static size_t rope_iovecs(rope_chunk_t** cursor, struct iovec* iov, size_t max) {
+    size_t count = 0;
+    rope_chunk_t* chunk = *cursor;
+    for (; (chunk != NULL) && (count < max); chunk = rope_chunk_next(chunk)) {
+        if (chunk->used == 0)
+            continue;
+        iov[count].iov_base = rope_chunk_data(chunk);
+        iov[count].iov_len  = chunk->used;
+        count++;
+    }
+    *cursor = chunk;
+    return count;
+}
+
+/* Write the whole rope to fd with writev, resuming after short writes and
+ * interrupted calls. Returns 0 on success or -1 with errno set, in which
+ * case some prefix of the rope may already have been written. */
+static int rope_write(rope_t* rope, int fd) {
+    struct iovec iov[ROPE_IOV_MAX];
+    rope_chunk_t* cursor = rope_front(rope);
+    size_t count;
+    while ((count = rope_iovecs(&cursor, iov, ROPE_IOV_MAX)) > 0) {
+        size_t first = 0;
+        while (first < count) {
+            ssize_t written = writev(fd, &iov[first], (int)(count - first));
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                return -1;
+            }
+            /* Skip the iovecs written in full and trim a partial one */
+            size_t done = (size_t)written;
+            while ((first < count) && (done >= iov[first].iov_len))
+                done -= iov[first++].iov_len;
+            if (first < count) {
+                iov[first].iov_base = (char*)iov[first].iov_base + done;
+                iov[first].iov_len -= done;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Write the rope to fd and release its chunks. The rope is left untouched
+ * if the write fails. */
+static int rope_flush(rope_t* rope, int fd) {
+    if (rope_write(rope, fd) < 0)
+        return -1;
+    rope_clear(rope);
+    return 0;
+}
+
+/* Copy the rope into a single NUL terminated string allocated with the
+ * rope's allocator, sized rope_size()+1, and clear the rope */
+static char* rope_finish(rope_t* rope) {
+    char* str = (char*)alloc_new(rope->alloc, rope->length + 1u);
+    size_t index = 0;
+    rope_foreach(chunk, rope) {
+        memcpy(&str[index], rope_chunk_data(chunk), chunk->used);
+        index += chunk->used;
+    }
+    str[index] = '\0';
+    rope_clear(rope);
+    return str;
+}
+
+#endif /* ROPE_H */
@@ -100,3 +100,124 @@ static slist_node_t* slist_node_next(slist_node_t* node) {
 
 #define slist_foreach(elem, list) \
     for(slist_node_t* elem = slist_front(list); elem != NULL; elem = elem->next)
+
+/* Singly-Linked Queues
+ *****************************************************************************
+ * A squeue_t links the same slist_node_t nodes but also tracks the tail and
+ * the node count, so pushing on either end, appending a whole queue and
+ * taking the size are all O(1). Only squeue_pop_back still walks the list.
+ */
+typedef struct {
+    slist_node_t* head;
+    slist_node_t* tail;
+    size_t count;
+} squeue_t;
+
+static void squeue_init(squeue_t* queue) {
+    queue->head  = NULL;
+    queue->tail  = NULL;
+    queue->count = 0;
+}
+
+static bool squeue_empty(squeue_t* queue) {
+    return (queue->head == NULL);
+}
+
+static size_t squeue_size(squeue_t* queue) {
+    return queue->count;
+}
+
+static slist_node_t* squeue_front(squeue_t* queue) {
+    return queue->head;
+}
+
+static slist_node_t* squeue_back(squeue_t* queue) {
+    return queue->tail;
+}
+
+static void squeue_push_front(squeue_t* queue, slist_node_t* node) {
+    node->next = queue->head;
+    queue->head = node;
+    if (queue->tail == NULL)
+        queue->tail = node;
+    queue->count++;
+}
+
+static void squeue_push_back(squeue_t* queue, slist_node_t* node) {
+    node->next = NULL;
+    if (queue->tail != NULL)
+        queue->tail->next = node;
+    else
+        queue->head = node;
+    queue->tail = node;
+    queue->count++;
+}
+
+static slist_node_t* squeue_pop_front(squeue_t* queue) {
+    slist_node_t* node = queue->head;
+    if (node == NULL)
+        return NULL;
+    queue->head = node->next;
+    if (queue->head == NULL)
+        queue->tail = NULL;
+    node->next = NULL;
+    queue->count--;
+    return node;
+}
+
+/* Walks the list to find the new tail */
+static slist_node_t* squeue_pop_back(squeue_t* queue) {
+    slist_node_t* node = queue->tail;
+    if (node == NULL)
+        return NULL;
+    if (queue->head == node) {
+        queue->head = NULL;
+        queue->tail = NULL;
+    } else {
+        slist_node_t* prev = queue->head;
+        while (prev->next != node)
+            prev = prev->next;
+        prev->next  = NULL;
+        queue->tail = prev;
+    }
+    queue->count--;
+    return node;
+}
+
+/* Move every node of src onto the end of dest, leaving src empty */
+static void squeue_append(squeue_t* dest, squeue_t* src) {
+    if (src->head == NULL)
+        return;
+    if (dest->tail != NULL)
+        dest->tail->next = src->head;
+    else
+        dest->head = src->head;
+    dest->tail   = src->tail;
+    dest->count += src->count;
+    squeue_init(src);
+}
+
+/* Move every node of list onto the end of queue, leaving list empty. This
+ * walks list once to find its tail and count its nodes. */
+static void squeue_append_slist(squeue_t* queue, slist_t* list) {
+    squeue_t src = { list->head, NULL, 0 };
+    for (slist_node_t* node = list->head; node != NULL; node = node->next) {
+        src.tail = node;
+        src.count++;
+    }
+    squeue_append(queue, &src);
+    list->head = NULL;
+}
+
+/* FIFO work queue names for push_back and pop_front. Dequeuing from an
+ * empty queue returns NULL. */
+static void squeue_enqueue(squeue_t* queue, slist_node_t* node) {
+    squeue_push_back(queue, node);
+}
+
+static slist_node_t* squeue_dequeue(squeue_t* queue) {
+    return squeue_pop_front(queue);
+}
+
+#define squeue_foreach(elem, queue) \
+    for(slist_node_t* elem = squeue_front(queue); elem != NULL; elem = elem->next)
@@ -0,0 +1,351 @@
+/**
+    Radix sorts and type specialized introsort with optional parallel merge.
+
+    Copyright 2017, Michael D. Lowis
+
+    Permission to use, copy, modify, and/or distribute this software
+    for any purpose with or without fee is hereby granted, provided
+    that the above copyright notice and this permission notice appear
+    in all copies.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+    WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE
+    AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+    DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA
+    OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+    TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+    PERFORMANCE OF THIS SOFTWARE.
+*/
+#ifndef SORT_H
+#define SORT_H
+
+/*
+    NOTE: This file depends on stdc.h. Define SORT_PARALLEL before including
+    it to get the multi-threaded merge sorts, which need -lpthread.
+
+    sort_radix_* sort arrays of integer or floating point keys with an LSD
+    radix sort over bytes. All byte histograms are gathered in a single pass
+    and any byte position where every key agrees is skipped, so narrow ranges
+    of wide keys cost only a few passes. Signed and floating point keys are
+    mapped onto unsigned keys that order the same way as each one is read,
+    so the data itself is never rewritten through another type.
+    Floating point keys order as their bit patterns do: -0.0 sorts before 0.0
+    and NaNs go to the ends according to their sign.
+
+    SORT_DEFINE(name, T, less) generates name_sort(T* data, size_t count), an
+    introsort whose comparisons are the expression less(a, b) on two T values
+    and so can be inlined, unlike the comparator calls made by qsort. It falls
+    back to heapsort if partitioning degrades, keeping it O(n log n).
+*/
+
+#ifndef SORT_INSERTION_MAX
+#define SORT_INSERTION_MAX 16u
+#endif
+
+#ifndef SORT_PARALLEL_MIN
+#define SORT_PARALLEL_MIN ((size_t)1 << 16)
+#endif
+
+/* Radix Sorts
+ *****************************************************************************/
+/* key(x) maps each T onto an unsigned K that orders the same way. The data
+ * is only ever read and written as T, so float keys are never accessed
+ * through an integer pointer. */
+#define SORT_RADIX_DEFINE(name, T, K, key) \
+    static void name(T* data, size_t count) { \
+        size_t hist[sizeof(K)][256]; \
+        if (count < 2) \
+            return; \
+        memset(hist, 0, sizeof(hist)); \
+        for (size_t i = 0; i < count; i++) { \
+            K k = key(data[i]); \
+            for (size_t b = 0; b < sizeof(K); b++) \
+                hist[b][(k >> (b * 8u)) & 0xFFu]++; \
+        } \
+        T* tmp = (T*)emalloc(count * sizeof(T)); \
+        T* src = data; \
+        T* dst = tmp; \
+        K first = key(data[0]); \
+        for (size_t b = 0; b < sizeof(K); b++) { \
+            size_t offset = 0; \
+            if (hist[b][(first >> (b * 8u)) & 0xFFu] == count) \
+                continue; \
+            for (size_t d = 0; d < 256u; d++) { \
+                size_t n = hist[b][d]; \
+                hist[b][d] = offset; \
+                offset += n; \
+            } \
+            for (size_t i = 0; i < count; i++) \
+                dst[hist[b][(key(src[i]) >> (b * 8u)) & 0xFFu]++] = src[i]; \
+            T* swap = src; \
+            src = dst; \
+            dst = swap; \
+        } \
+        if (src != data) \
+            memcpy(data, src, count * sizeof(T)); \
+        free(tmp); \
+    }
+
+static inline uint32_t sort_key_u32(uint32_t val) {
+    return val;
+}
+
+static inline uint64_t sort_key_u64(uint64_t val) {
+    return val;
+}
+
+static inline uint32_t sort_key_i32(int32_t val) {
+    return (uint32_t)val ^ UINT32_C(0x80000000);
+}
+
+static inline uint64_t sort_key_i64(int64_t val) {
+    return (uint64_t)val ^ UINT64_C(0x8000000000000000);
+}
+
+/* Negative floats have every bit flipped so larger magnitudes sort lower,
+ * positive ones only the sign bit so they sort above all negatives */
+static inline uint32_t sort_key_f32(float val) {
+    uint32_t key;
+    memcpy(&key, &val, sizeof(key));
+    return key ^ ((key & UINT32_C(0x80000000)) ? UINT32_C(0xFFFFFFFF) : UINT32_C(0x80000000));
+}
+
+static inline uint64_t sort_key_f64(double val) {
+    uint64_t key;
+    memcpy(&key, &val, sizeof(key));
+    return key ^ ((key & UINT64_C(0x8000000000000000)) ? UINT64_C(0xFFFFFFFFFFFFFFFF) : UINT64_C(0x8000000000000000));
+}
+
+SORT_RADIX_DEFINE(sort_radix_u32, uint32_t, uint32_t, sort_key_u32)
+SORT_RADIX_DEFINE(sort_radix_u64, uint64_t, uint64_t, sort_key_u64)
+SORT_RADIX_DEFINE(sort_radix_i32, int32_t, uint32_t, sort_key_i32)
+SORT_RADIX_DEFINE(sort_radix_i64, int64_t, uint64_t, sort_key_i64)
+SORT_RADIX_DEFINE(sort_radix_f32, float, uint32_t, sort_key_f32)
+SORT_RADIX_DEFINE(sort_radix_f64, double, uint64_t, sort_key_f64)
+
+/* Type Specialized Introsort
+ *****************************************************************************/
+#define SORT_DEFINE(name, T, less) \
+    static inline void name##_insertion(T* data, size_t count) { \
+        for (size_t i = 1; i < count; i++) { \
+            T val = data[i]; \
+            size_t j = i; \
+            for (; (j > 0) && less(val, data[j-1]); j--) \
+                data[j] = data[j-1]; \
+            data[j] = val; \
+        } \
+    } \
+    \
+    static inline void name##_sift(T* data, size_t root, size_t count) { \
+        T val = data[root]; \
+        size_t child; \
+        while ((child = (2 * root) + 1) < count) { \
+            if (((child + 1) < count) && less(data[child], data[child + 1])) \
+                child++; \
+            if (!less(val, data[child])) \
+                break; \
+            data[root] = data[child]; \
+            root = child; \
+        } \
+        data[root] = val; \
+    } \
+    \
+    static void name##_heapsort(T* data, size_t count) { \
+        for (size_t i = count / 2; i > 0; i--) \
+            name##_sift(data, i - 1, count); \
+        for (size_t i = count; i > 1; i--) { \
+            T top = data[0]; \
+            data[0] = data[i - 1]; \
+            data[i - 1] = top; \
+            name##_sift(data, 0, i - 1); \
+        } \
+    } \
+    \
+    /* Order data[a] <= data[b] <= data[c] */ \
+    static inline void name##_median3(T* data, size_t a, size_t b, size_t c) { \
+        T tmp; \
+        if (less(data[b], data[a])) { tmp = data[a]; data[a] = data[b]; data[b] = tmp; } \
+        if (less(data[c], data[b])) { tmp = data[b]; data[b] = data[c]; data[c] = tmp; } \
+        if (less(data[b], data[a])) { tmp = data[a]; data[a] = data[b]; data[b] = tmp; } \
+    } \
+    \
+    static void name##_introsort(T* data, size_t count, unsigned int depth) { \
+        while (count > SORT_INSERTION_MAX) { \
+            if (depth-- == 0) { \
+                name##_heapsort(data, count); \
+                return; \
+            } \
+            /* Median of three moved to the front as the pivot, with the \
+             * outer two acting as sentinels for the partition loops */ \
+            size_t mid = count / 2; \
+            name##_median3(data, 0, mid, count - 1); \
+            T pivot = data[mid]; \
+            data[mid] = data[1]; \
+            data[1] = pivot; \
+            size_t i = 1, j = count - 1; \
+            while (true) { \
+                do { i++; } while (less(data[i], pivot)); \
+                do { j--; } while (less(pivot, data[j])); \
+                if (i >= j) \
+                    break; \
+                T tmp = data[i]; \
+                data[i] = data[j]; \
+                data[j] = tmp; \
+            } \
+            data[1] = data[j]; \
+            data[j] = pivot; \
+            /* Recurse into the smaller side and loop on the larger one */ \
+            if (j < (count - j)) { \
+                name##_introsort(data, j, depth); \
+                data  += j + 1; \
+                count -= j + 1; \
+            } else { \
+                name##_introsort(data + j + 1, count - j - 1, depth); \
+                count = j; \
+            } \
+        } \
+        name##_insertion(data, count); \
+    } \
+    \
+    static void name##_sort(T* data, size_t count) { \
+        unsigned int depth = 0; \
+        for (size_t n = count; n > 1; n >>= 1) \
+            depth += 2; \
+        name##_introsort(data, count, depth); \
+    } \
+    SORT_PARALLEL_DEFINE(name, T, less)
+
+/* Parallel Merge Sort
+ *****************************************************************************
+ * name_sort_parallel splits the input into nthreads runs (rounded down to a
+ * power of two) that are sorted concurrently, then merges pairs of runs in
+ * parallel rounds through a scratch buffer. Inputs below SORT_PARALLEL_MIN
+ * are sorted on the calling thread.
+ */
+#ifdef SORT_PARALLEL
+#include <pthread.h>
+
+typedef struct {
+    void* src;
+    void* dst;
+    size_t lo, mid, hi;
+    void (*fn)(void* task);
+} sort_task_t;
+
+static void* sort_task_run(void* arg) {
+    sort_task_t* task = (sort_task_t*)arg;
+    task->fn(task);
+    return NULL;
+}
+
+/* Run every task on its own thread, with the last one on the caller's */
+static void sort_run_tasks(sort_task_t* tasks, size_t ntasks) {
+    pthread_t* threads = (pthread_t*)emalloc(ntasks * sizeof(pthread_t));
+    for (size_t i = 0; (i + 1) < ntasks; i++)
+        if (0 != pthread_create(&threads[i], NULL, sort_task_run, &tasks[i]))
+            fatal("pthread_create failed:");
+    tasks[ntasks - 1].fn(&tasks[ntasks - 1]);
+    for (size_t i = 0; (i + 1) < ntasks; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+}
+
+#define SORT_PARALLEL_DEFINE(name, T, less) \
+    static void name##_sort_task(void* arg) { \
+        sort_task_t* task = (sort_task_t*)arg; \
+        name##_sort((T*)task->src + task->lo, task->hi - task->lo); \
+    } \
+    \
+    static void name##_merge_task(void* arg) { \
+        sort_task_t* task = (sort_task_t*)arg; \
+        T* src = (T*)task->src; \
+        T* dst = (T*)task->dst; \
+        size_t i = task->lo, j = task->mid, k = task->lo; \
+        while ((i < task->mid) && (j < task->hi)) \
+            dst[k++] = less(src[j], src[i]) ? src[j++] : src[i++]; \
+        while (i < task->mid) \
+            dst[k++] = src[i++]; \
+        while (j < task->hi) \
+            dst[k++] = src[j++]; \
+    } \
+    \
+    static void name##_sort_parallel(T* data, size_t count, unsigned int nthreads) { \
+        size_t runs = 1; \
+        while ((runs * 2) <= nthreads) \
+            runs *= 2; \
+        if ((runs < 2) || (count < SORT_PARALLEL_MIN)) { \
+            name##_sort(data, count); \
+            return; \
+        } \
+        T* tmp = (T*)emalloc(count * sizeof(T)); \
+        sort_task_t* tasks = (sort_task_t*)emalloc(runs * sizeof(sort_task_t)); \
+        for (size_t r = 0; r < runs; r++) { \
+            tasks[r].src = data; \
+            tasks[r].lo  = (count * r) / runs; \
+            tasks[r].hi  = (count * (r + 1)) / runs; \
+            tasks[r].fn  = name##_sort_task; \
+        } \
+        sort_run_tasks(tasks, runs); \
+        T* src = data; \
+        T* dst = tmp; \
+        for (size_t width = 1; width < runs; width *= 2) { \
+            size_t ntasks = 0; \
+            for (size_t r = 0; r < runs; r += 2 * width) { \
+                tasks[ntasks].src = src; \
+                tasks[ntasks].dst = dst; \
+                tasks[ntasks].lo  = (count * r) / runs; \
+                tasks[ntasks].mid = (count * (r + width)) / runs; \
+                tasks[ntasks].hi  = (count * (r + (2 * width))) / runs; \
+                tasks[ntasks].fn  = name##_merge_task; \
+                ntasks++; \
+            } \
+            sort_run_tasks(tasks, ntasks); \
+            T* swap = src; \
+            src = dst; \
+            dst = swap; \
+        } \
+        if (src != data) \
+            memcpy(data, src, count * sizeof(T)); \
+        free(tasks); \
+        free(tmp); \
+    }
+#else
+#define SORT_PARALLEL_DEFINE(name, T, less)
+#endif
+
+/* Vector Wrappers
+ *****************************************************************************/
+#ifdef VEC_H
+static void vec_sort_u32(vec_t* vec) {
+    assert(vec->elem_size == sizeof(uint32_t));
+    sort_radix_u32((uint32_t*)vec->elem_buffer, vec->elem_count);
+}
+
+static void vec_sort_u64(vec_t* vec) {
+    assert(vec->elem_size == sizeof(uint64_t));
+    sort_radix_u64((uint64_t*)vec->elem_buffer, vec->elem_count);
+}
+
+static void vec_sort_i32(vec_t* vec) {
+    assert(vec->elem_size == sizeof(int32_t));
+    sort_radix_i32((int32_t*)vec->elem_buffer, vec->elem_count);
+}
+
+static void vec_sort_i64(vec_t* vec) {
+    assert(vec->elem_size == sizeof(int64_t));
+    sort_radix_i64((int64_t*)vec->elem_buffer, vec->elem_count);
+}
+
+static void vec_sort_f32(vec_t* vec) {
+    assert(vec->elem_size == sizeof(float));
+    sort_radix_f32((float*)vec->elem_buffer, vec->elem_count);
+}
+
+static void vec_sort_f64(vec_t* vec) {
+    assert(vec->elem_size == sizeof(double));
+    sort_radix_f64((double*)vec->elem_buffer, vec->elem_count);
+}
+#endif
+
+#endif /* SORT_H */
@@ -18,16 +18,50 @@
     PERFORMANCE OF THIS SOFTWARE.
 */
 
+/*
+    NOTE: This file depends on stdc.h and utf8.h, and on alloc.h when buffers
+    should be allocated through an allocator_t. Include alloc.h first in that
+    case.
+*/
+#if !defined(ALLOC_H) && !defined(alloc_new)
+#define alloc_new(a, size)                     (assert((a) == NULL), malloc(size))
+#define alloc_zero(a, size)                    (assert((a) == NULL), calloc(1u, (size)))
+#define alloc_resize(a, ptr, oldsize, newsize) (assert((a) == NULL), realloc((ptr), (newsize)))
+#define alloc_free(a, ptr, size)               (assert((a) == NULL), free(ptr))
+#endif
+
+/* Strings shorter than this are kept inline in the strbuf_t and never touch
+ * the heap. Because the string may point into the struct itself, a strbuf_t
+ * must not be copied or moved while it holds a string. */
+#ifndef STRBUF_SMALL_SIZE
+#define STRBUF_SMALL_SIZE 32u
+#endif
+
 typedef struct {
     size_t index;
     size_t capacity;
     char* string;
+    struct allocator_t* alloc;
+    char small[STRBUF_SMALL_SIZE];
 } strbuf_t;
 
 static void strbuf_reset(strbuf_t* buf) {
     buf->index    = 0;
     buf->capacity = 0;
     buf->string   = NULL;
+    buf->alloc    = NULL;
+}
+
+static void strbuf_init_alloc(strbuf_t* buf, struct allocator_t* alloc) {
+    strbuf_reset(buf);
+    buf->alloc = alloc;
+}
+
+/* Release the string, which must not have been handed out by strbuf_finish */
+static void strbuf_deinit(strbuf_t* buf) {
+    if (buf->string != buf->small)
+        alloc_free(buf->alloc, buf->string, buf->capacity);
+    strbuf_init_alloc(buf, buf->alloc);
 }
 
 static void strbuf_clear(strbuf_t* buf) {
@@ -40,29 +74,64 @@ static char* strbuf_string(strbuf_t* buf) {
     return buf->string;
 }
 
+/* Hand the string over to the caller and start a new one with the same
+ * allocator. A string still held in the small buffer is copied out to the
+ * heap first. With an allocator set, the string is trimmed to strlen()+1
+ * bytes and must be freed through the allocator with that size. */
 static char* strbuf_finish(strbuf_t* buf) {
     char* str = buf->string;
-    strbuf_reset(buf);
+    if (str == buf->small)
+        str = (char*)memcpy(alloc_new(buf->alloc, buf->index + 1u), buf->small, buf->index + 1u);
+    else if ((buf->alloc != NULL) && (str != NULL))
+        str = (char*)alloc_resize(buf->alloc, str, buf->capacity, buf->index + 1u);
+    strbuf_init_alloc(buf, buf->alloc);
     return str;
 }
 
-static void strbuf_add_char(strbuf_t* buf, char ch) {
-    /* Make sure there's space for the new char */
+/* Make sure there is room for at least size characters plus the terminator */
+static void strbuf_reserve(strbuf_t* buf, size_t size) {
+    if (size < buf->capacity)
+        return;
+    if (buf->string == NULL && size < STRBUF_SMALL_SIZE) {
+        buf->capacity = STRBUF_SMALL_SIZE;
+        buf->string   = buf->small;
+        buf->string[0] = '\0';
+        return;
+    }
+    size_t capacity = (buf->capacity ? buf->capacity : 8u);
+    while (capacity <= size)
+        capacity <<= 1u;
     if (buf->string == NULL) {
-        buf->capacity = 8u;
-        buf->string   = (char*)calloc(buf->capacity, 1u);
-    } else if (buf->index+1u >= buf->capacity) {
-        buf->capacity = buf->capacity << 1u;
-        buf->string = (char*)realloc(buf->string, buf->capacity);
+        buf->string    = (char*)alloc_new(buf->alloc, capacity);
+        buf->string[0] = '\0';
+    } else if (buf->string == buf->small) {
+        buf->string = (char*)memcpy(alloc_new(buf->alloc, capacity), buf->small, buf->index + 1u);
+    } else {
+        buf->string = (char*)alloc_resize(buf->alloc, buf->string, buf->capacity, capacity);
     }
+    buf->capacity = capacity;
+}
+
+static void strbuf_add_char(strbuf_t* buf, char ch) {
+    /* Make sure there's space for the new char */
+    if (buf->index+1u >= buf->capacity)
+        strbuf_reserve(buf, buf->index+1u);
     /* Append the char */
     buf->string[buf->index++] = ch;
     buf->string[buf->index]   = '\0';
 }
 
+/* Append len bytes with a single reservation and copy */
+static void strbuf_add_bytes(strbuf_t* buf, const char* bytes, size_t len) {
+    if (buf->index+len >= buf->capacity)
+        strbuf_reserve(buf, buf->index+len);
+    memcpy(&(buf->string[buf->index]), bytes, len);
+    buf->index += len;
+    buf->string[buf->index] = '\0';
+}
+
 static void strbuf_add_string(strbuf_t* buf, char* str) {
-    while (*str)
-        strbuf_add_char(buf, *(str++));
+    strbuf_add_bytes(buf, str, strlen(str));
 }
 
 static void strbuf_add_rune(strbuf_t* buf, Rune rune) {
@@ -71,7 +140,87 @@ static void strbuf_add_rune(strbuf_t* buf, Rune rune) {
     strbuf_add_string(buf, utf);
 }
 
-
 static void strbuf_cat(strbuf_t* dest, strbuf_t* src) {
-    strbuf_add_string(dest, strbuf_string(src));
+    if (src->string != NULL)
+        strbuf_add_bytes(dest, src->string, src->index);
+}
+
+/* Formatted Appends
+ *****************************************************************************/
+/* Format directly into the spare capacity, retrying once with exactly enough
+ * room if the first attempt did not fit */
+static void strbuf_vprintf(strbuf_t* buf, const char* fmt, va_list args) {
+    va_list copy;
+    strbuf_reserve(buf, buf->index);
+    va_copy(copy, args);
+    size_t spare = buf->capacity - buf->index;
+    int len = vsnprintf(&(buf->string[buf->index]), spare, fmt, copy);
+    va_end(copy);
+    if (len < 0) {
+        buf->string[buf->index] = '\0';
+        return;
+    }
+    if ((size_t)len >= spare) {
+        strbuf_reserve(buf, buf->index + (size_t)len);
+        vsnprintf(&(buf->string[buf->index]), (size_t)len + 1u, fmt, args);
+    }
+    buf->index += (size_t)len;
+}
+
+static void strbuf_printf(strbuf_t* buf, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    strbuf_vprintf(buf, fmt, args);
+    va_end(args);
+}
+
+static const char StrBuf_DigitPairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Write the digits two at a time from the end of a scratch buffer */
+static void strbuf_add_u64(strbuf_t* buf, uint64_t val) {
+    char digits[20];
+    char* p = &digits[sizeof(digits)];
+    while (val >= 100u) {
+        const char* pair = &StrBuf_DigitPairs[(val % 100u) * 2u];
+        val /= 100u;
+        *(--p) = pair[1];
+        *(--p) = pair[0];
+    }
+    if (val >= 10u) {
+        *(--p) = StrBuf_DigitPairs[(val * 2u) + 1u];
+        *(--p) = StrBuf_DigitPairs[val * 2u];
+    } else {
+        *(--p) = (char)('0' + val);
+    }
+    strbuf_add_bytes(buf, p, (size_t)(&digits[sizeof(digits)] - p));
+}
+
+static void strbuf_add_i64(strbuf_t* buf, int64_t val) {
+    if (val < 0) {
+        strbuf_add_char(buf, '-');
+        strbuf_add_u64(buf, (uint64_t)0 - (uint64_t)val);
+    } else {
+        strbuf_add_u64(buf, (uint64_t)val);
+    }
+}
+
+/* Append the shortest of %.15g, %.16g and %.17g that reads back as exactly
+ * the same double. 17 significant digits always round trip. Integral values
+ * below 1e15, which %.15g prints without an exponent, skip formatting. */
+static void strbuf_add_double(strbuf_t* buf, double val) {
+    char str[32];
+    int len = 0;
+    if ((val > -1e15) && (val < 1e15) && (val == (double)(int64_t)val) && (val != 0)) {
+        strbuf_add_i64(buf, (int64_t)val);
+        return;
+    }
+    for (int precision = 15; precision <= 17; precision++) {
+        len = snprintf(str, sizeof(str), "%.*g", precision, val);
+        if ((val != val) || (strtod(str, NULL) == val))
+            break;
+    }
+    strbuf_add_bytes(buf, str, (size_t)len);
 }
@@ -18,6 +18,22 @@
     PERFORMANCE OF THIS SOFTWARE.
 */
 
+/*
+    NOTE: The bulk routines at the end of this file check 16 bytes at a time
+    for ASCII with SSE2, or 32 with AVX2, and otherwise 16 at a time with
+    plain 64-bit words. When built with SSSE3 or AVX2 enabled, utf8_validate
+    uses the Keiser-Lemire lookup algorithm (as used by simdjson) to check
+    multibyte text a vector at a time as well. Without them it falls back to
+    a scalar check of each sequence.
+*/
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 typedef uint32_t Rune;
 
 #define UTF_MAX   6u
@@ -50,11 +66,19 @@ static size_t runelen(Rune rune) {
         return 4;
 }
 
+/* Sequence length indexed by the number of leading one bits in a lead byte */
+static const uint8_t UTF8_OnesLens[] = { 0x01u, 0x00u, 0x02u, 0x03u, 0x04u, 0x05u, 0x06u, 0x00u, 0x00u };
+
 static uint8_t utfseq(uint8_t byte) {
+#ifdef __GNUC__
+    /* the low 24 bits of the complement are all ones, so it is never 0 */
+    return UTF8_OnesLens[__builtin_clz(~((unsigned int)byte << 24))];
+#else
     for (int i = 1; i < 8; i++)
         if ((byte & UTF8_SeqBits[i]) == UTF8_SeqBits[i-1])
             return UTF8_SeqLens[i-1];
     return 0;
+#endif
 }
 
 static size_t utf8encode(char str[UTF_MAX], Rune rune) {
@@ -115,3 +139,257 @@ static void fputrune(Rune rune, FILE* f) {
     utf8encode(utf, rune);
     fprintf(f, "%s", utf);
 }
+
+/* Bulk Validation and Decoding
+ *****************************************************************************/
+/* Number of leading bytes of buf that are ASCII */
+static size_t utf8_ascii_prefix(const uint8_t* buf, size_t len) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; (i + 32) <= len; i += 32) {
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(buf + i)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#elif defined(__SSE2__)
+    for (; (i + 16) <= len; i += 16) {
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(buf + i)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#else
+    for (; (i + 16) <= len; i += 16) {
+        uint64_t lo, hi;
+        memcpy(&lo, buf + i, sizeof(lo));
+        memcpy(&hi, buf + i + 8, sizeof(hi));
+        if ((lo | hi) & 0x8080808080808080ull)
+            break;
+    }
+#endif
+    while ((i < len) && (buf[i] < 0x80u))
+        i++;
+    return i;
+}
+
+/* Check the sequences of buf one at a time, skipping ASCII runs in bulk */
+static bool utf8_validate_scalar(const uint8_t* buf, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        i += utf8_ascii_prefix(buf + i, len - i);
+        if (i >= len)
+            break;
+        uint8_t byte = buf[i];
+        size_t need;
+        uint8_t lo = 0x80u, hi = 0xBFu;
+        if (byte < 0xC2u)
+            return false;
+        else if (byte < 0xE0u)
+            need = 1;
+        else if (byte < 0xF0u)
+            need = 2, lo = (byte == 0xE0u ? 0xA0u : lo), hi = (byte == 0xEDu ? 0x9Fu : hi);
+        else if (byte < 0xF5u)
+            need = 3, lo = (byte == 0xF0u ? 0x90u : lo), hi = (byte == 0xF4u ? 0x8Fu : hi);
+        else
+            return false;
+        if ((len - i) <= need || buf[i+1] < lo || buf[i+1] > hi)
+            return false;
+        for (size_t k = 2; k <= need; k++)
+            if ((buf[i+k] & 0xC0u) != 0x80u)
+                return false;
+        i += need + 1;
+    }
+    return true;
+}
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+/* Error classes of the Keiser-Lemire lookup tables. Each table maps a
+ * nibble of the previous or current byte to the errors it could be part
+ * of, and a byte pair is in error when all three tables agree. */
+enum {
+    UTF8_TOO_SHORT      = (1 << 0), /* lead byte not followed by a continuation */
+    UTF8_TOO_LONG       = (1 << 1), /* continuation after an ASCII byte */
+    UTF8_OVERLONG_3     = (1 << 2),
+    UTF8_TOO_LARGE      = (1 << 3), /* above U+10FFFF */
+    UTF8_SURROGATE      = (1 << 4),
+    UTF8_OVERLONG_2     = (1 << 5),
+    UTF8_TOO_LARGE_1000 = (1 << 6),
+    UTF8_OVERLONG_4     = (1 << 6),
+    UTF8_TWO_CONTS      = (1 << 7), /* continuation after a continuation */
+    UTF8_CARRY          = (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS),
+};
+
+#define UTF8_BYTE_1_HIGH \
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, \
+    (UTF8_TOO_SHORT | UTF8_OVERLONG_2), \
+    UTF8_TOO_SHORT, \
+    (UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE), \
+    (UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4)
+
+#define UTF8_BYTE_1_LOW \
+    (UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4), \
+    (UTF8_CARRY | UTF8_OVERLONG_2), \
+    UTF8_CARRY, \
+    UTF8_CARRY, \
+    (UTF8_CARRY | UTF8_TOO_LARGE), \
+    (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+    (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+    (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+    (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+    (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+    (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+    (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+    (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+    (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE), \
+    (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+    (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000)
+
+#define UTF8_BYTE_2_HIGH \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+    (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4), \
+    (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE), \
+    (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE), \
+    (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE), \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+#endif
+
+#if defined(__AVX2__)
+typedef __m256i utf8_vec_t;
+#define UTF8_VEC_SIZE 32u
+
+/* Errors in the two byte sequences ending in each byte of input, plus the
+ * third and fourth bytes of longer sequences left unclaimed */
+static __m256i utf8_check_block(__m256i input, __m256i prev_input) {
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+    __m256i byte_1_high = _mm256_shuffle_epi8(_mm256_setr_epi8(UTF8_BYTE_1_HIGH, UTF8_BYTE_1_HIGH),
+        _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    __m256i byte_1_low = _mm256_shuffle_epi8(_mm256_setr_epi8(UTF8_BYTE_1_LOW, UTF8_BYTE_1_LOW),
+        _mm256_and_si256(prev1, nibble));
+    __m256i byte_2_high = _mm256_shuffle_epi8(_mm256_setr_epi8(UTF8_BYTE_2_HIGH, UTF8_BYTE_2_HIGH),
+        _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+    __m256i third  = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0u - 0x80u)));
+    __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0u - 0x80u)));
+    __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must23, special);
+}
+
+/* Nonzero if the block ends part way through a sequence */
+static __m256i utf8_check_incomplete(__m256i input) {
+    const __m256i max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0u - 1), (char)(0xE0u - 1), (char)(0xC0u - 1));
+    return _mm256_subs_epu8(input, max);
+}
+
+#define utf8_vec_load(p)    _mm256_loadu_si256((const __m256i*)(p))
+#define utf8_vec_zero()     _mm256_setzero_si256()
+#define utf8_vec_or(a, b)   _mm256_or_si256(a, b)
+#define utf8_vec_ascii(v)   (_mm256_movemask_epi8(v) == 0)
+#define utf8_vec_clean(v)   _mm256_testz_si256(v, v)
+#elif defined(__SSSE3__)
+typedef __m128i utf8_vec_t;
+#define UTF8_VEC_SIZE 16u
+
+static __m128i utf8_check_block(__m128i input, __m128i prev_input) {
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+    __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+    __m128i byte_1_high = _mm_shuffle_epi8(_mm_setr_epi8(UTF8_BYTE_1_HIGH),
+        _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    __m128i byte_1_low = _mm_shuffle_epi8(_mm_setr_epi8(UTF8_BYTE_1_LOW),
+        _mm_and_si128(prev1, nibble));
+    __m128i byte_2_high = _mm_shuffle_epi8(_mm_setr_epi8(UTF8_BYTE_2_HIGH),
+        _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+    __m128i third  = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0u - 0x80u)));
+    __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0u - 0x80u)));
+    __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+    return _mm_xor_si128(must23, special);
+}
+
+static __m128i utf8_check_incomplete(__m128i input) {
+    const __m128i max = _mm_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0u - 1), (char)(0xE0u - 1), (char)(0xC0u - 1));
+    return _mm_subs_epu8(input, max);
+}
+
+#define utf8_vec_load(p)    _mm_loadu_si128((const __m128i*)(p))
+#define utf8_vec_zero()     _mm_setzero_si128()
+#define utf8_vec_or(a, b)   _mm_or_si128(a, b)
+#define utf8_vec_ascii(v)   (_mm_movemask_epi8(v) == 0)
+#define utf8_vec_clean(v)   (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xFFFF)
+#endif
+
+/* True if buf holds only well-formed UTF-8 as defined by RFC 3629. This
+ * rejects overlong forms, surrogates, values above U+10FFFF and the old 5 and
+ * 6 byte forms. Noncharacters such as U+FFFE are well-formed and pass,
+ * though utf8decode maps them to RUNE_ERR. */
+static bool utf8_validate(const char* buf, size_t len) {
+#if defined(__AVX2__) || defined(__SSSE3__)
+    const uint8_t* bytes = (const uint8_t*)buf;
+    utf8_vec_t error = utf8_vec_zero(), prev = utf8_vec_zero(), incomplete = utf8_vec_zero();
+    size_t i = 0;
+    for (; (i + UTF8_VEC_SIZE) <= len; i += UTF8_VEC_SIZE) {
+        utf8_vec_t input = utf8_vec_load(bytes + i);
+        if (utf8_vec_ascii(input)) {
+            error = utf8_vec_or(error, incomplete);
+        } else {
+            error = utf8_vec_or(error, utf8_check_block(input, prev));
+            incomplete = utf8_check_incomplete(input);
+        }
+        prev = input;
+    }
+    /* The zero padding after the last partial block is ASCII, so it also
+     * catches a sequence cut off by the end of the buffer */
+    uint8_t tail[UTF8_VEC_SIZE] = {0};
+    memcpy(tail, bytes + i, len - i);
+    utf8_vec_t input = utf8_vec_load(tail);
+    error = utf8_vec_or(error, utf8_check_block(input, prev));
+    error = utf8_vec_or(error, utf8_check_incomplete(input));
+    return utf8_vec_clean(error);
+#else
+    return utf8_validate_scalar((const uint8_t*)buf, len);
+#endif
+}
+
+/* Decode len bytes of buf into out, which must have room for len runes, and
+ * return the number of runes written. The runes match those fgetrune would
+ * read from the same bytes: a bad lead byte or a missing continuation byte
+ * gives RUNE_ERR and the offending byte is consumed along with it, as is a
+ * sequence cut off by the end of buf. */
+static size_t utf8_decode_buf(const char* buf, size_t len, Rune* out) {
+    const uint8_t* bytes = (const uint8_t*)buf;
+    size_t i = 0, count = 0;
+    while (i < len) {
+        size_t ascii = utf8_ascii_prefix(bytes + i, len - i);
+        for (size_t k = 0; k < ascii; k++)
+            out[count + k] = bytes[i + k];
+        i += ascii, count += ascii;
+        if (i >= len)
+            break;
+        size_t seqlen = utfseq(bytes[i]);
+        Rune rune = (seqlen == 0 ? RUNE_ERR : (bytes[i] & UTF8_SeqMask[seqlen]));
+        i++;
+        for (size_t k = 1; (rune != RUNE_ERR) && (k < seqlen); k++) {
+            if ((i >= len) || ((bytes[i] & 0xC0u) != 0x80u))
+                rune = RUNE_ERR;
+            else
+                rune = (rune << 6) | (bytes[i] & 0x3Fu);
+            i += (i < len);
+        }
+        if ((seqlen > 1) && (rune != RUNE_ERR) && !runevalid(rune))
+            rune = RUNE_ERR;
+        out[count++] = rune;
+    }
+    return count;
+}
@@ -20,17 +20,31 @@
 #ifndef VEC_H
 #define VEC_H
 
+/*
+    NOTE: This file depends on alloc.h when vectors should be allocated
+    through an allocator_t. Include alloc.h first in that case.
+*/
+#include <assert.h>
+#include <stdarg.h>
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if !defined(ALLOC_H) && !defined(alloc_new)
+#define alloc_new(a, size)                     (assert((a) == NULL), malloc(size))
+#define alloc_zero(a, size)                    (assert((a) == NULL), calloc(1u, (size)))
+#define alloc_resize(a, ptr, oldsize, newsize) (assert((a) == NULL), realloc((ptr), (newsize)))
+#define alloc_free(a, ptr, size)               (assert((a) == NULL), free(ptr))
+#endif
+
 typedef struct {
     size_t   elem_count;
     size_t   elem_size;
     size_t   elem_capacity;
     uint8_t* elem_buffer;
+    struct allocator_t* alloc;
 } vec_t;
 
 typedef int (*vec_cmpfn_t)(const void*,const void*);
@@ -39,11 +53,33 @@ typedef int (*vec_cmpfn_t)(const void*,const void*);
 #define DEFAULT_VEC_CAPACITY (size_t)8
 #endif
 
-static void vec_init(vec_t* vec, size_t elem_size) {
+/* When full, the capacity is multiplied by VEC_GROWTH_NUM / VEC_GROWTH_DEN.
+ * The default doubles it; 3/2 trades more reallocations for less slack. */
+#ifndef VEC_GROWTH_NUM
+#define VEC_GROWTH_NUM (size_t)2
+#endif
+
+#ifndef VEC_GROWTH_DEN
+#define VEC_GROWTH_DEN (size_t)1
+#endif
+
+static void vec_init_alloc(vec_t* vec, size_t elem_size, struct allocator_t* alloc) {
     vec->elem_size     = elem_size;
     vec->elem_count    = 0;
     vec->elem_capacity = DEFAULT_VEC_CAPACITY;
-    vec->elem_buffer   = malloc(elem_size * vec->elem_capacity);
+    vec->alloc         = alloc;
+    vec->elem_buffer   = alloc_new(alloc, elem_size * vec->elem_capacity);
+}
+
+static void vec_init(vec_t* vec, size_t elem_size) {
+    vec_init_alloc(vec, elem_size, NULL);
+}
+
+static void vec_deinit(vec_t* vec) {
+    alloc_free(vec->alloc, vec->elem_buffer, vec->elem_capacity * vec->elem_size);
+    vec->elem_buffer   = NULL;
+    vec->elem_count    = 0;
+    vec->elem_capacity = 0;
 }
 
 static size_t vec_size(vec_t* vec) {
@@ -72,14 +108,31 @@ static size_t vec_next_capacity(size_t req_size) {
     return next_power;
 }
 
+/* Grow capacity geometrically from its current value until it holds req_size */
+static size_t vec_grow_capacity(size_t capacity, size_t req_size) {
+    if (capacity < DEFAULT_VEC_CAPACITY)
+        capacity = DEFAULT_VEC_CAPACITY;
+    while (capacity < req_size) {
+        size_t next = (capacity / VEC_GROWTH_DEN) * VEC_GROWTH_NUM;
+        capacity = (next > capacity ? next : capacity + 1);
+    }
+    return capacity;
+}
+
 static void vec_reserve(vec_t* vec, size_t size) {
-    vec->elem_buffer   = realloc(vec->elem_buffer, size * vec->elem_size);
+    vec->elem_buffer   = alloc_resize(vec->alloc, vec->elem_buffer, vec->elem_capacity * vec->elem_size, size * vec->elem_size);
     vec->elem_capacity = size;
 }
 
+/* Reallocate only when count exceeds the current capacity */
+static void vec_grow(vec_t* vec, size_t count) {
+    if (count > vec->elem_capacity)
+        vec_reserve(vec, vec_grow_capacity(vec->elem_capacity, count));
+}
+
 static void vec_resize(vec_t* vec, size_t count, void* fillval) {
     if (count > vec->elem_count) {
-        vec_reserve(vec, vec_next_capacity(count+1));
+        vec_grow(vec, count);
         for (; vec->elem_count < count; vec->elem_count++)
             memcpy(&(vec->elem_buffer[vec->elem_count * vec->elem_size]), fillval, vec->elem_size);
     } else if (count < vec->elem_count) {
@@ -88,8 +141,7 @@ static void vec_resize(vec_t* vec, size_t count, void* fillval) {
 }
 
 static void vec_shrink_to_fit(vec_t* vec) {
-    vec->elem_buffer   = realloc(vec->elem_buffer, vec->elem_count * vec->elem_size);
-    vec->elem_capacity = vec->elem_count;
+    vec_reserve(vec, vec->elem_count);
 }
 
 static void* vec_at(vec_t* vec, size_t index) {
@@ -100,22 +152,77 @@ static void vec_set(vec_t* vec, size_t index, void* data) {
     memcpy(&(vec->elem_buffer[index * vec->elem_size]), data, vec->elem_size);
 }
 
+/* Insert a contiguous run of num_elements elements before index. The data
+ * must not point into the vector itself. */
+static bool vec_insert_range(vec_t* vec, size_t index, const void* data, size_t num_elements) {
+    if (index > vec->elem_count)
+        return false;
+    vec_grow(vec, vec->elem_count + num_elements);
+    uint8_t* at = &(vec->elem_buffer[index * vec->elem_size]);
+    memmove(at + (num_elements * vec->elem_size), at, (vec->elem_count - index) * vec->elem_size);
+    memcpy(at, data, num_elements * vec->elem_size);
+    vec->elem_count += num_elements;
+    return true;
+}
+
+static void vec_append_range(vec_t* vec, const void* data, size_t num_elements) {
+    vec_insert_range(vec, vec->elem_count, data, num_elements);
+}
+
+/* Insert num_elements elements before index. Each variadic argument is a
+ * pointer to an element to be copied in. */
 static bool vec_insert(vec_t* vec, size_t index, size_t num_elements, ...) {
-    (void)vec;
-    (void)index;
-    (void)num_elements;
-    return false;
+    va_list elements;
+    if (index > vec->elem_count)
+        return false;
+    vec_grow(vec, vec->elem_count + num_elements);
+    uint8_t* at = &(vec->elem_buffer[index * vec->elem_size]);
+    memmove(at + (num_elements * vec->elem_size), at, (vec->elem_count - index) * vec->elem_size);
+    va_start(elements, num_elements);
+    for (size_t i = 0; i < num_elements; i++)
+        memcpy(at + (i * vec->elem_size), va_arg(elements, void*), vec->elem_size);
+    va_end(elements);
+    vec->elem_count += num_elements;
+    return true;
 }
 
+/* Remove the elements from start_idx through end_idx inclusive */
 static bool vec_erase(vec_t* vec, size_t start_idx, size_t end_idx) {
-    (void)vec;
-    (void)start_idx;
-    (void)end_idx;
-    return false;
+    if ((start_idx > end_idx) || (end_idx >= vec->elem_count))
+        return false;
+    uint8_t* at = &(vec->elem_buffer[start_idx * vec->elem_size]);
+    size_t removed = (end_idx - start_idx) + 1;
+    memmove(at, at + (removed * vec->elem_size), (vec->elem_count - end_idx - 1) * vec->elem_size);
+    vec->elem_count -= removed;
+    return true;
+}
+
+/* Remove every element for which predfn returns true, keeping the relative
+ * order of the rest. Returns the number of elements removed. */
+static size_t vec_erase_if(vec_t* vec, bool (*predfn)(void* elem, void* arg), void* arg) {
+    size_t kept = 0;
+    for (size_t i = 0; i < vec->elem_count; i++) {
+        uint8_t* elem = &(vec->elem_buffer[i * vec->elem_size]);
+        if (predfn(elem, arg))
+            continue;
+        if (kept != i)
+            memcpy(&(vec->elem_buffer[kept * vec->elem_size]), elem, vec->elem_size);
+        kept++;
+    }
+    size_t removed = vec->elem_count - kept;
+    vec->elem_count = kept;
+    return removed;
+}
+
+/* Append an uninitialized element and return a pointer to it so the caller
+ * can construct it in place. The pointer is invalidated by the next growth. */
+static void* vec_emplace_back(vec_t* vec) {
+    vec_grow(vec, vec->elem_count + 1);
+    return &(vec->elem_buffer[vec->elem_count++ * vec->elem_size]);
 }
 
 static void vec_push_back(vec_t* vec, void* data) {
-    vec_resize(vec, vec->elem_count+1, data);
+    memcpy(vec_emplace_back(vec), data, vec->elem_size);
 }
 
 static void vec_pop_back(vec_t* vec, void* outdata) {
@@ -131,4 +238,95 @@ static void vec_sort(vec_t* vec, int (*cmpfn)(const void*,const void*)) {
     qsort(vec->elem_buffer, vec->elem_count, vec->elem_size, cmpfn);
 }
 
+/* Type Specialized Vectors
+ *****************************************************************************/
+/* VEC_DEFINE(name, T) generates a name_t vector of T along with name_init,
+ * name_push_back, name_at and friends mirroring the vec_t API. Elements are
+ * addressed and assigned through a T* so the compiler sees the real element
+ * size instead of a runtime elem_size and memcpy. */
+#define VEC_DEFINE(name, T) \
+    typedef struct { \
+        size_t elem_count; \
+        size_t elem_capacity; \
+        T*     elem_buffer; \
+        struct allocator_t* alloc; \
+    } name##_t; \
+    \
+    static inline void name##_init_alloc(name##_t* vec, struct allocator_t* alloc) { \
+        vec->elem_count    = 0; \
+        vec->elem_capacity = DEFAULT_VEC_CAPACITY; \
+        vec->alloc         = alloc; \
+        vec->elem_buffer   = (T*)alloc_new(alloc, sizeof(T) * vec->elem_capacity); \
+    } \
+    \
+    static inline void name##_init(name##_t* vec) { \
+        name##_init_alloc(vec, NULL); \
+    } \
+    \
+    static inline void name##_deinit(name##_t* vec) { \
+        alloc_free(vec->alloc, vec->elem_buffer, vec->elem_capacity * sizeof(T)); \
+        vec->elem_buffer   = NULL; \
+        vec->elem_count    = 0; \
+        vec->elem_capacity = 0; \
+    } \
+    \
+    static inline size_t name##_size(name##_t* vec) { \
+        return vec->elem_count; \
+    } \
+    \
+    static inline bool name##_empty(name##_t* vec) { \
+        return (vec->elem_count == 0); \
+    } \
+    \
+    static inline size_t name##_capacity(name##_t* vec) { \
+        return vec->elem_capacity; \
+    } \
+    \
+    static inline void name##_reserve(name##_t* vec, size_t size) { \
+        vec->elem_buffer   = (T*)alloc_resize(vec->alloc, vec->elem_buffer, vec->elem_capacity * sizeof(T), size * sizeof(T)); \
+        vec->elem_capacity = size; \
+    } \
+    \
+    static inline void name##_resize(name##_t* vec, size_t count, T fillval) { \
+        if (count > vec->elem_capacity) \
+            name##_reserve(vec, vec_grow_capacity(vec->elem_capacity, count)); \
+        for (; vec->elem_count < count; vec->elem_count++) \
+            vec->elem_buffer[vec->elem_count] = fillval; \
+        vec->elem_count = count; \
+    } \
+    \
+    static inline void name##_shrink_to_fit(name##_t* vec) { \
+        name##_reserve(vec, vec->elem_count); \
+    } \
+    \
+    static inline T* name##_at(name##_t* vec, size_t index) { \
+        return &(vec->elem_buffer[index]); \
+    } \
+    \
+    static inline void name##_set(name##_t* vec, size_t index, T data) { \
+        vec->elem_buffer[index] = data; \
+    } \
+    \
+    static inline T* name##_emplace_back(name##_t* vec) { \
+        if (vec->elem_count == vec->elem_capacity) \
+            name##_reserve(vec, vec_grow_capacity(vec->elem_capacity, vec->elem_count + 1)); \
+        return &(vec->elem_buffer[vec->elem_count++]); \
+    } \
+    \
+    static inline void name##_push_back(name##_t* vec, T data) { \
+        *name##_emplace_back(vec) = data; \
+    } \
+    \
+    static inline T name##_pop_back(name##_t* vec) { \
+        return vec->elem_buffer[--vec->elem_count]; \
+    } \
+    \
+    static inline void name##_clear(name##_t* vec) { \
+        vec->elem_count = 0; \
+    } \
+    \
+    static inline void name##_sort(name##_t* vec, vec_cmpfn_t cmpfn) { \
+        qsort(vec->elem_buffer, vec->elem_count, sizeof(T), cmpfn); \
+    }
+
 #endif /* VEC_H */
@@ -0,0 +1,262 @@
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#include <stdc.h>
+#include <alloc.h>
+#include <utf8.h>
+#include <strbuf.h>
+#include <vec.h>
+#include <hash.h>
+
+typedef int tokval_t;
+#include <parse.h>
+
+typedef struct {
+    hash_entry_t link;
+    uint val;
+} int_node_t;
+
+/* Counts calls so tests can see that containers route through the allocator */
+typedef struct {
+    pool_alloc_t pool;
+    size_t allocs;
+    size_t reallocs;
+    size_t frees;
+    size_t live;
+} counting_alloc_t;
+
+static void* counting_alloc(allocator_t* a, size_t size)
+{
+    counting_alloc_t* c = (counting_alloc_t*)a;
+    c->allocs++;
+    c->live += size;
+    return pool_alloc(a, size);
+}
+
+static void* counting_realloc(allocator_t* a, void* ptr, size_t oldsize, size_t newsize)
+{
+    counting_alloc_t* c = (counting_alloc_t*)a;
+    c->reallocs++;
+    c->live += newsize - oldsize;
+    return pool_realloc(a, ptr, oldsize, newsize);
+}
+
+static void counting_free(allocator_t* a, void* ptr, size_t size)
+{
+    counting_alloc_t* c = (counting_alloc_t*)a;
+    c->frees++;
+    c->live -= size;
+    pool_free(a, ptr, size);
+}
+
+static void counting_init(counting_alloc_t* c)
+{
+    pool_init(&(c->pool));
+    c->pool.base.alloc   = counting_alloc;
+    c->pool.base.realloc = counting_realloc;
+    c->pool.base.free    = counting_free;
+    c->allocs = c->reallocs = c->frees = c->live = 0;
+}
+
+static unsigned int hash_func(const hash_entry_t* entry)
+{
+    int_node_t* node = container_of(entry, int_node_t, link);
+    return node->val;
+}
+
+static int compare_func(const hash_entry_t* entry1, const hash_entry_t* entry2)
+{
+    int_node_t* node1 = container_of(entry1, int_node_t, link);
+    int_node_t* node2 = container_of(entry2, int_node_t, link);
+    return node1->val - node2->val;
+}
+
+static void delete_func(hash_entry_t* entry)
+{
+    (void)entry;
+}
+
+static void lex_func(void* data, token_t* tok)
+{
+    int* next = (int*)data;
+    tok->type  = (*next)++;
+    tok->value = tok->type * 10;
+}
+
+TEST_SUITE(Alloc) {
+    /* Bump Allocator
+     *************************************************************************/
+    TEST(Verify bump_alloc hands out aligned blocks until the buffer is full)
+    {
+        static uint8_t buffer[256];
+        bump_alloc_t bump;
+        bump_init(&bump, buffer, sizeof(buffer));
+        void* a = alloc_new(&(bump.base), 10);
+        void* b = alloc_new(&(bump.base), 10);
+        CHECK(a == buffer);
+        CHECK(((uintptr_t)b % ALLOC_ALIGN) == 0);
+        CHECK((uint8_t*)b == buffer + 16);
+        CHECK(NULL == alloc_new(&(bump.base), 512));
+        bump_reset(&bump);
+        CHECK(alloc_new(&(bump.base), 10) == buffer);
+    }
+
+    TEST(Verify bump_realloc grows the last block in place)
+    {
+        static uint8_t buffer[256];
+        bump_alloc_t bump;
+        bump_init(&bump, buffer, sizeof(buffer));
+        char* a = alloc_new(&(bump.base), 8);
+        strcpy(a, "abcdefg");
+        CHECK(alloc_resize(&(bump.base), a, 8, 64) == a);
+        char* b = alloc_new(&(bump.base), 8);
+        CHECK(b == a + 64);
+        char* c = alloc_resize(&(bump.base), a, 64, 128);
+        CHECK(c != a);
+        CHECK(0 == strcmp(c, "abcdefg"));
+    }
+
+    TEST(Verify bump_free only reclaims the last block)
+    {
+        static uint8_t buffer[256];
+        bump_alloc_t bump;
+        bump_init(&bump, buffer, sizeof(buffer));
+        void* a = alloc_new(&(bump.base), 16);
+        void* b = alloc_new(&(bump.base), 16);
+        alloc_free(&(bump.base), a, 16);
+        CHECK(bump.used == 32);
+        alloc_free(&(bump.base), b, 16);
+        CHECK(bump.used == 16);
+    }
+
+    /* Pool Allocator
+     *************************************************************************/
+    TEST(Verify pool_alloc reuses freed blocks of the same class)
+    {
+        pool_alloc_t pool;
+        pool_init(&pool);
+        void* a = alloc_new(&(pool.base), 20);
+        void* b = alloc_new(&(pool.base), 20);
+        CHECK(a != b);
+        CHECK(((uintptr_t)a % ALLOC_ALIGN) == 0);
+        alloc_free(&(pool.base), a, 20);
+        CHECK(alloc_new(&(pool.base), 32) == a);
+        pool_deinit(&pool);
+    }
+
+    TEST(Verify pool_realloc keeps data across size classes)
+    {
+        pool_alloc_t pool;
+        pool_init(&pool);
+        char* a = alloc_new(&(pool.base), 16);
+        strcpy(a, "hello");
+        CHECK(alloc_resize(&(pool.base), a, 16, 12) == a);
+        char* b = alloc_resize(&(pool.base), a, 16, 100);
+        CHECK(0 == strcmp(b, "hello"));
+        char* c = alloc_resize(&(pool.base), b, 100, 10000);
+        CHECK(0 == strcmp(c, "hello"));
+        alloc_free(&(pool.base), c, 10000);
+        pool_deinit(&pool);
+    }
+
+    /* Container Integration
+     *************************************************************************/
+    TEST(Verify vec_init_alloc routes every buffer through the allocator)
+    {
+        counting_alloc_t ca;
+        vec_t vec;
+        counting_init(&ca);
+        vec_init_alloc(&vec, sizeof(int), &(ca.pool.base));
+        for (int i = 0; i < 1000; i++)
+            vec_push_back(&vec, &i);
+        for (int i = 0; i < 1000; i++)
+            CHECK(*(int*)vec_at(&vec, i) == i);
+        CHECK(ca.allocs == 1);
+        CHECK(ca.reallocs > 0);
+        vec_deinit(&vec);
+        CHECK(ca.frees == 1);
+        CHECK(ca.live == 0);
+        pool_deinit(&(ca.pool));
+    }
+
+    TEST(Verify strbuf_init_alloc routes every buffer through the allocator)
+    {
+        counting_alloc_t ca;
+        strbuf_t buf;
+        counting_init(&ca);
+        strbuf_init_alloc(&buf, &(ca.pool.base));
+        for (int i = 0; i < 100; i++)
+            strbuf_add_string(&buf, "ab");
+        CHECK(strlen(strbuf_string(&buf)) == 200);
+        char* str = strbuf_finish(&buf);
+        CHECK(buf.alloc == &(ca.pool.base));
+        CHECK(strlen(str) == 200);
+        alloc_free(&(ca.pool.base), str, strlen(str) + 1);
+        strbuf_add_string(&buf, "xyz");
+        CHECK(0 == strcmp(strbuf_string(&buf), "xyz"));
+        strbuf_deinit(&buf);
+        CHECK(ca.live == 0);
+        pool_deinit(&(ca.pool));
+    }
+
+    TEST(Verify hash_init_alloc routes every buffer through the allocator)
+    {
+        counting_alloc_t ca;
+        hash_t hash;
+        int_node_t nodes[1000];
+        counting_init(&ca);
+        hash_init_alloc(&hash, hash_func, compare_func, delete_func, HASH_INCREMENTAL, &(ca.pool.base));
+        for (uint i = 0; i < 1000; i++) {
+            nodes[i].val = i;
+            hash_set(&hash, &(nodes[i].link));
+        }
+        for (uint i = 0; i < 1000; i++)
+            CHECK(hash_get(&hash, &(nodes[i].link)) == &(nodes[i].link));
+        CHECK(ca.allocs > 1);
+        hash_deinit(&hash);
+        CHECK(ca.frees == ca.allocs);
+        CHECK(ca.live == 0);
+        pool_deinit(&(ca.pool));
+    }
+
+    TEST(Verify rhash_init_alloc routes every buffer through the allocator)
+    {
+        counting_alloc_t ca;
+        rhash_t hash;
+        int_node_t nodes[1000];
+        counting_init(&ca);
+        rhash_init_alloc(&hash, hash_func, compare_func, delete_func, &(ca.pool.base));
+        for (uint i = 0; i < 1000; i++) {
+            nodes[i].val = i;
+            rhash_set(&hash, &(nodes[i].link));
+        }
+        for (uint i = 0; i < 1000; i++)
+            CHECK(rhash_get(&hash, &(nodes[i].link)) == &(nodes[i].link));
+        CHECK(ca.allocs > 1);
+        rhash_deinit(&hash);
+        CHECK(ca.frees == ca.allocs);
+        CHECK(ca.live == 0);
+        pool_deinit(&(ca.pool));
+    }
+
+    TEST(Verify parse_init_alloc routes every buffer through the allocator)
+    {
+        counting_alloc_t ca;
+        parser_t ctx;
+        int next = 0;
+        counting_init(&ca);
+        parse_init_alloc(&ctx, lex_func, &next, &(ca.pool.base));
+        mark(&ctx);
+        for (int i = 0; i < 100; i++) {
+            CHECK(peektype(&ctx, 1) == i);
+            consume(&ctx);
+        }
+        release(&ctx);
+        CHECK(peektok(&ctx, 1)->value == 0);
+        CHECK(ca.reallocs > 0);
+        parse_deinit(&ctx);
+        CHECK(ca.live == 0);
+        pool_deinit(&(ca.pool));
+    }
+}
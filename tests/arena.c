@@ -0,0 +1,176 @@
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#include <stdc.h>
+#include <alloc.h>
+#include <arena.h>
+#include <vec.h>
+
+TEST_SUITE(Arena) {
+    /* Allocation
+     *************************************************************************/
+    TEST(Verify arena_alloc returns aligned and distinct blocks)
+    {
+        arena_t arena;
+        arena_init(&arena, 0);
+        char* a = arena_alloc(&arena, 3);
+        char* b = arena_alloc(&arena, 5);
+        CHECK(((uintptr_t)a % ARENA_ALIGN) == 0);
+        CHECK(((uintptr_t)b % ARENA_ALIGN) == 0);
+        CHECK(b >= a + 3);
+        arena_deinit(&arena);
+    }
+
+    TEST(Verify arena_alloc_aligned honors large alignments)
+    {
+        arena_t arena;
+        arena_init(&arena, 0);
+        arena_alloc_aligned(&arena, 1, 1);
+        void* p = arena_alloc_aligned(&arena, 64, 256);
+        CHECK(((uintptr_t)p % 256) == 0);
+        arena_deinit(&arena);
+    }
+
+    TEST(Verify arena_alloc spills into new chunks and oversized chunks)
+    {
+        arena_t arena;
+        arena_init(&arena, 256);
+        for (int i = 0; i < 100; i++) {
+            char* p = arena_alloc(&arena, 100);
+            memset(p, i, 100);
+        }
+        char* big = arena_alloc(&arena, 10000);
+        memset(big, 0xAA, 10000);
+        CHECK(arena.first != arena.current);
+        arena_deinit(&arena);
+    }
+
+    TEST(Verify arena_calloc zeroes memory reused after a reset)
+    {
+        arena_t arena;
+        arena_init(&arena, 256);
+        memset(arena_alloc(&arena, 64), 0xFF, 64);
+        arena_reset(&arena);
+        uint8_t* p = arena_calloc(&arena, 8, 8);
+        for (int i = 0; i < 64; i++)
+            CHECK(p[i] == 0);
+        arena_deinit(&arena);
+    }
+
+    TEST(Verify arena_realloc grows the last block in place)
+    {
+        arena_t arena;
+        arena_init(&arena, 0);
+        char* a = arena_alloc(&arena, 8);
+        strcpy(a, "abc");
+        CHECK(arena_realloc(&arena, a, 8, 128) == a);
+        arena_alloc(&arena, 8);
+        char* b = arena_realloc(&arena, a, 128, 256);
+        CHECK(b != a);
+        CHECK(0 == strcmp(b, "abc"));
+        arena_deinit(&arena);
+    }
+
+    /* Marks and Resets
+     *************************************************************************/
+    TEST(Verify arena_release rewinds to the mark)
+    {
+        arena_t arena;
+        arena_init(&arena, 256);
+        arena_alloc(&arena, 16);
+        arena_mark_t mark = arena_mark(&arena);
+        size_t before = arena_allocated(&arena);
+        void* first = arena_alloc(&arena, 16);
+        for (int i = 0; i < 50; i++)
+            arena_alloc(&arena, 100);
+        arena_release(&arena, mark);
+        CHECK(arena_allocated(&arena) == before);
+        CHECK(arena_alloc(&arena, 16) == first);
+        arena_deinit(&arena);
+    }
+
+    TEST(Verify arena_reset reuses chunks without growing)
+    {
+        arena_t arena;
+        arena_init(&arena, 256);
+        for (int round = 0; round < 10; round++) {
+            for (int i = 0; i < 50; i++)
+                arena_alloc(&arena, 100);
+            arena_reset(&arena);
+            CHECK(arena_allocated(&arena) == 0);
+        }
+        size_t chunks = 0;
+        for (arena_chunk_t* chunk = arena.first; chunk; chunk = chunk->next)
+            chunks++;
+        CHECK(chunks <= 50);
+        arena_deinit(&arena);
+    }
+
+    TEST(Verify arena_high_water tracks the peak across resets)
+    {
+        arena_t arena;
+        arena_init(&arena, 0);
+        arena_alloc(&arena, 1000);
+        arena_reset(&arena);
+        arena_alloc(&arena, 100);
+        CHECK(arena_allocated(&arena) == 100);
+        CHECK(arena_high_water(&arena) == 1000);
+        arena_deinit(&arena);
+    }
+
+    /* Helpers
+     *************************************************************************/
+    TEST(Verify arena_strdup copies the string)
+    {
+        arena_t arena;
+        arena_init(&arena, 0);
+        const char* s = "hello world";
+        char* d = arena_strdup(&arena, s);
+        CHECK(d != s);
+        CHECK(0 == strcmp(d, s));
+        arena_deinit(&arena);
+    }
+
+    TEST(Verify arena_smprintf formats into the arena)
+    {
+        arena_t arena;
+        arena_init(&arena, 16);
+        char* s = arena_smprintf(&arena, "%s-%d-%s", "abc", 12345, "a longer tail than one chunk");
+        CHECK(0 == strcmp(s, "abc-12345-a longer tail than one chunk"));
+        arena_deinit(&arena);
+    }
+
+    TEST(Verify arena_freadline reads each line and then NULL)
+    {
+        arena_t arena;
+        FILE* file = tmpfile();
+        fputs("short\na much longer line of text to force growth\nlast", file);
+        rewind(file);
+        arena_init(&arena, 32);
+        char* l1 = arena_freadline(&arena, file);
+        char* l2 = arena_freadline(&arena, file);
+        char* l3 = arena_freadline(&arena, file);
+        CHECK(0 == strcmp(l1, "short\n"));
+        CHECK(0 == strcmp(l2, "a much longer line of text to force growth\n"));
+        CHECK(0 == strcmp(l3, "last"));
+        CHECK(NULL == arena_freadline(&arena, file));
+        fclose(file);
+        arena_deinit(&arena);
+    }
+
+    TEST(Verify arena_allocator backs a container)
+    {
+        arena_t arena;
+        arena_allocator_t adapter;
+        vec_t vec;
+        arena_init(&arena, 0);
+        vec_init_alloc(&vec, sizeof(int), arena_allocator(&adapter, &arena));
+        for (int i = 0; i < 10000; i++)
+            vec_push_back(&vec, &i);
+        for (int i = 0; i < 10000; i++)
+            CHECK(*(int*)vec_at(&vec, i) == i);
+        vec_deinit(&vec);
+        arena_deinit(&arena);
+    }
+}
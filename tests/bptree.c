@@ -0,0 +1,181 @@
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#include <stdc.h>
+#include <arena.h>
+#include <bptree.h>
+
+enum { NUM_KEYS = 20000 };
+
+static int compare_str(const void* a, const void* b) {
+    return strcmp((const char*)a, (const char*)b);
+}
+
+/* Check the leaves hold exactly the keys 0, step, 2*step... in order */
+static bool keys_in_order(bptree_t* tree, int64_t count, int64_t step) {
+    bptree_iter_t iter;
+    int64_t expect = 0;
+    for (bptree_begin(tree, &iter); bptree_iter_valid(&iter); bptree_iter_next(&iter)) {
+        if ((bptree_iter_key_int(&iter) != expect) || ((intptr_t)bptree_iter_value(&iter) != expect + 1))
+            return false;
+        expect += step;
+    }
+    return (expect == count * step);
+}
+
+TEST_SUITE(BPTree) {
+    TEST(Verify bptree_init_int creates an empty tree)
+    {
+        bptree_t tree;
+        bptree_iter_t iter;
+        bptree_init_int(&tree);
+        CHECK(bptree_empty(&tree));
+        CHECK(bptree_lookup_int(&tree, 42) == NULL);
+        CHECK(!bptree_delete_int(&tree, 42));
+        bptree_begin(&tree, &iter);
+        CHECK(!bptree_iter_valid(&iter));
+        bptree_seek_int(&tree, 42, &iter);
+        CHECK(!bptree_iter_valid(&iter));
+        bptree_deinit(&tree);
+    }
+
+    TEST(Verify integer keys inserted in random order can be found)
+    {
+        bptree_t tree;
+        bptree_init_int(&tree);
+        for (int64_t i = 0; i < NUM_KEYS; i++) {
+            int64_t key = (i * 7919) % NUM_KEYS;
+            CHECK(bptree_insert_int(&tree, key, (void*)(intptr_t)(key + 1)));
+        }
+        CHECK(bptree_size(&tree) == NUM_KEYS);
+        CHECK(!tree.root->leaf);
+        CHECK(((uintptr_t)tree.root % BPTREE_CACHE_LINE) == 0);
+        for (int64_t i = 0; i < NUM_KEYS; i++) {
+            void** val = bptree_lookup_int(&tree, i);
+            CHECK(val != NULL && (intptr_t)*val == i + 1);
+        }
+        CHECK(bptree_lookup_int(&tree, -1) == NULL);
+        CHECK(bptree_lookup_int(&tree, NUM_KEYS) == NULL);
+        CHECK(keys_in_order(&tree, NUM_KEYS, 1));
+        bptree_deinit(&tree);
+    }
+
+    TEST(Verify inserting an existing key replaces its value)
+    {
+        bptree_t tree;
+        bptree_init_int(&tree);
+        CHECK(bptree_insert_int(&tree, INT64_MIN, (void*)1));
+        CHECK(bptree_insert_int(&tree, INT64_MAX, (void*)2));
+        CHECK(!bptree_insert_int(&tree, INT64_MIN, (void*)3));
+        CHECK(bptree_size(&tree) == 2);
+        CHECK(*bptree_lookup_int(&tree, INT64_MIN) == (void*)3);
+        CHECK(*bptree_lookup_int(&tree, INT64_MAX) == (void*)2);
+        bptree_deinit(&tree);
+    }
+
+    TEST(Verify deleted keys are skipped by lookups and scans)
+    {
+        bptree_t tree;
+        bptree_init_int(&tree);
+        for (int64_t i = NUM_KEYS - 1; i >= 0; i--)
+            bptree_insert_int(&tree, i, (void*)(intptr_t)(i + 1));
+        for (int64_t i = 0; i < NUM_KEYS; i++)
+            if (i % 2)
+                CHECK(bptree_delete_int(&tree, i));
+        CHECK(!bptree_delete_int(&tree, 1));
+        CHECK(bptree_size(&tree) == NUM_KEYS / 2);
+        CHECK(bptree_lookup_int(&tree, 1) == NULL);
+        CHECK(keys_in_order(&tree, NUM_KEYS / 2, 2));
+        /* Emptied leaves are stepped over */
+        for (int64_t i = 0; i < NUM_KEYS / 2; i += 2)
+            bptree_delete_int(&tree, i);
+        bptree_iter_t iter;
+        bptree_begin(&tree, &iter);
+        CHECK(bptree_iter_valid(&iter) && bptree_iter_key_int(&iter) == NUM_KEYS / 2);
+        bptree_seek_int(&tree, 3, &iter);
+        CHECK(bptree_iter_valid(&iter) && bptree_iter_key_int(&iter) == NUM_KEYS / 2);
+        bptree_deinit(&tree);
+    }
+
+    TEST(Verify bptree_seek_int starts range scans at the lower bound)
+    {
+        bptree_t tree;
+        bptree_iter_t iter;
+        bptree_init_int(&tree);
+        for (int64_t i = 0; i < NUM_KEYS; i++)
+            bptree_insert_int(&tree, i * 10, (void*)(intptr_t)(i * 10 + 1));
+        bptree_seek_int(&tree, 1234, &iter);
+        int64_t expect = 1240;
+        for (int n = 0; n < 100; n++, bptree_iter_next(&iter)) {
+            CHECK(bptree_iter_valid(&iter));
+            CHECK(bptree_iter_key_int(&iter) == expect);
+            expect += 10;
+        }
+        bptree_seek_int(&tree, 500, &iter);
+        CHECK(bptree_iter_key_int(&iter) == 500);
+        bptree_seek_int(&tree, (NUM_KEYS - 1) * 10 + 1, &iter);
+        CHECK(!bptree_iter_valid(&iter));
+        bptree_deinit(&tree);
+    }
+
+    TEST(Verify bptree_bulk_load_int builds a searchable tree)
+    {
+        static int64_t keys[NUM_KEYS];
+        static void* values[NUM_KEYS];
+        for (size_t count = 0; count < NUM_KEYS; count = (count * 3) + 1) {
+            bptree_t tree;
+            bptree_init_int(&tree);
+            for (size_t i = 0; i < count; i++) {
+                keys[i]   = (int64_t)i * 3;
+                values[i] = (void*)(intptr_t)(i * 3 + 1);
+            }
+            bptree_bulk_load_int(&tree, keys, values, count);
+            CHECK(bptree_size(&tree) == count);
+            CHECK(keys_in_order(&tree, (int64_t)count, 3));
+            for (size_t i = 0; i < count; i++) {
+                void** val = bptree_lookup_int(&tree, (int64_t)i * 3);
+                CHECK(val != NULL && *val == values[i]);
+                CHECK(bptree_lookup_int(&tree, (int64_t)i * 3 + 1) == NULL);
+            }
+            /* The loaded tree keeps accepting inserts */
+            for (size_t i = 0; i < count; i++)
+                CHECK(bptree_insert_int(&tree, (int64_t)i * 3 + 1, NULL));
+            CHECK(bptree_size(&tree) == count * 2);
+            bptree_deinit(&tree);
+        }
+    }
+
+    TEST(Verify comparator trees order keys with cmpfn)
+    {
+        static char names[NUM_KEYS][8];
+        static const void* sorted[NUM_KEYS];
+        bptree_t tree;
+        bptree_iter_t iter;
+        bptree_init(&tree, compare_str);
+        for (int i = 0; i < NUM_KEYS; i++) {
+            int n = (i * 7919) % NUM_KEYS;
+            sprintf(names[n], "k%05d", n);
+            CHECK(bptree_insert(&tree, names[n], names[n]));
+        }
+        CHECK(bptree_size(&tree) == NUM_KEYS);
+        CHECK(*bptree_lookup(&tree, "k01234") == names[1234]);
+        CHECK(bptree_lookup(&tree, "k1") == NULL);
+        CHECK(bptree_delete(&tree, "k01234"));
+        CHECK(bptree_lookup(&tree, "k01234") == NULL);
+        bptree_seek(&tree, "k01234", &iter);
+        CHECK(bptree_iter_valid(&iter) && 0 == strcmp(bptree_iter_key(&iter), "k01235"));
+        bptree_deinit(&tree);
+
+        for (int i = 0; i < NUM_KEYS; i++)
+            sorted[i] = names[i];
+        bptree_init(&tree, compare_str);
+        bptree_bulk_load(&tree, sorted, NULL, NUM_KEYS);
+        int n = 0;
+        for (bptree_begin(&tree, &iter); bptree_iter_valid(&iter); bptree_iter_next(&iter), n++)
+            CHECK(bptree_iter_key(&iter) == names[n] && bptree_iter_value(&iter) == NULL);
+        CHECK(n == NUM_KEYS);
+        CHECK(bptree_lookup(&tree, "k19999") != NULL);
+        bptree_deinit(&tree);
+    }
+}
@@ -17,6 +17,34 @@ int compare(bstree_node_t* a, bstree_node_t* b)
     return (nodea->val < nodeb->val) ? -1 : (nodea->val > nodeb->val) ? 1 : 0;
 }
 
+/* Return the black height of the subtree, or -1 if it breaks a red-black
+ * property, is out of order or has a wrong parent pointer */
+static int rb_height(bstree_node_t* node, bstree_node_t* parent) {
+    if (node == NULL)
+        return 1;
+    if (bstree_parent(node) != parent)
+        return -1;
+    if (bstree_is_red(node) && (bstree_is_red(node->left) || bstree_is_red(node->right)))
+        return -1;
+    if ((node->left && compare(node->left, node) > 0) || (node->right && compare(node->right, node) < 0))
+        return -1;
+    int left  = rb_height(node->left, node);
+    int right = rb_height(node->right, node);
+    if ((left < 0) || (left != right))
+        return -1;
+    return left + (bstree_is_red(node) ? 0 : 1);
+}
+
+static size_t tree_depth(bstree_node_t* node) {
+    if (node == NULL)
+        return 0;
+    size_t left  = tree_depth(node->left);
+    size_t right = tree_depth(node->right);
+    return 1 + (left > right ? left : right);
+}
+
+enum { NUM_NODES = 1000 };
+
 //-----------------------------------------------------------------------------
 // Begin Unit Tests
 //-----------------------------------------------------------------------------
@@ -59,28 +87,50 @@ TEST_SUITE(BSTree) {
 
     TEST(Verify_bstree_size_should_return_1)
     {
-        bstree_node_t node1 = { NULL, NULL };
-        bstree_t tree = { &node1, NULL, false };
+        int_node_t node1 = { {0,0}, 42 };
+        bstree_t tree;
+        bstree_init(&tree, compare, false);
+        bstree_insert(&tree, &(node1.node));
         CHECK(1 == bstree_size(&tree));
     }
 
     TEST(Verify_bstree_size_should_return_2)
     {
-        bstree_node_t node2 = { NULL, NULL };
-        bstree_node_t node1 = { &node2, NULL };
-        bstree_t tree = { &node1, NULL, false };
+        int_node_t node1 = { {0,0}, 42 };
+        int_node_t node2 = { {0,0}, 41 };
+        bstree_t tree;
+        bstree_init(&tree, compare, false);
+        bstree_insert(&tree, &(node1.node));
+        bstree_insert(&tree, &(node2.node));
         CHECK(2 == bstree_size(&tree));
     }
 
     TEST(Verify_bstree_size_should_return_3)
     {
-        bstree_node_t node3 = { NULL, NULL };
-        bstree_node_t node2 = { NULL, NULL };
-        bstree_node_t node1 = { &node2, &node3 };
-        bstree_t tree = { &node1, NULL, false };
+        int_node_t node1 = { {0,0}, 42 };
+        int_node_t node2 = { {0,0}, 41 };
+        int_node_t node3 = { {0,0}, 43 };
+        bstree_t tree;
+        bstree_init(&tree, compare, false);
+        bstree_insert(&tree, &(node1.node));
+        bstree_insert(&tree, &(node2.node));
+        bstree_insert(&tree, &(node3.node));
         CHECK(3 == bstree_size(&tree));
     }
 
+    TEST(Verify_bstree_size_should_not_count_duplicates_that_were_not_inserted)
+    {
+        int_node_t node1 = { {0,0}, 42 };
+        int_node_t node2 = { {0,0}, 42 };
+        bstree_t tree;
+        bstree_init(&tree, compare, false);
+        bstree_insert(&tree, &(node1.node));
+        bstree_insert(&tree, &(node2.node));
+        CHECK(1 == bstree_size(&tree));
+        bstree_delete(&tree, &(node1.node));
+        CHECK(0 == bstree_size(&tree));
+    }
+
     //-------------------------------------------------------------------------
     // bstree_insert
     //-------------------------------------------------------------------------
@@ -143,4 +193,96 @@ TEST_SUITE(BSTree) {
         CHECK(bstree_lookup(&tree, &(node2.node)) == &(node2.node));
     }
 
+    //-------------------------------------------------------------------------
+    // Balanced Trees
+    //-------------------------------------------------------------------------
+    TEST(Verify_bstree_init_balanced_should_init_a_balanced_tree)
+    {
+        bstree_t tree;
+        bstree_init_balanced(&tree, compare, false);
+        CHECK(tree.root == NULL);
+        CHECK(tree.balanced == true);
+        CHECK(tree.allow_dups == false);
+    }
+
+    TEST(Verify_balanced_insert_of_sorted_keys_keeps_the_tree_shallow)
+    {
+        static int_node_t nodes[NUM_NODES];
+        bstree_t tree;
+        bstree_init_balanced(&tree, compare, false);
+        for (int i = 0; i < NUM_NODES; i++) {
+            nodes[i].val = i;
+            bstree_insert(&tree, &(nodes[i].node));
+        }
+        CHECK(bstree_size(&tree) == NUM_NODES);
+        CHECK(bstree_color(tree.root) == BSTREE_BLACK);
+        CHECK(rb_height(tree.root, NULL) > 0);
+        CHECK(tree_depth(tree.root) <= 20);
+        for (int i = 0; i < NUM_NODES; i++)
+            CHECK(bstree_lookup(&tree, &(nodes[i].node)) == &(nodes[i].node));
+    }
+
+    TEST(Verify_balanced_delete_keeps_the_red_black_properties)
+    {
+        static int_node_t nodes[NUM_NODES];
+        bstree_t tree;
+        bstree_init_balanced(&tree, compare, false);
+        for (int i = 0; i < NUM_NODES; i++) {
+            nodes[i].val = (i * 7919) % NUM_NODES;
+            bstree_insert(&tree, &(nodes[i].node));
+        }
+        for (int i = 0; i < NUM_NODES; i += 2) {
+            bstree_delete(&tree, &(nodes[i].node));
+            CHECK(rb_height(tree.root, NULL) > 0);
+        }
+        CHECK(bstree_size(&tree) == NUM_NODES / 2);
+        for (int i = 0; i < NUM_NODES; i++)
+            CHECK(bstree_lookup(&tree, &(nodes[i].node)) == ((i % 2) ? &(nodes[i].node) : NULL));
+        for (int i = 1; i < NUM_NODES; i += 2)
+            bstree_delete(&tree, &(nodes[i].node));
+        CHECK(bstree_empty(&tree));
+    }
+
+    TEST(Verify_unbalanced_delete_handles_leaves_and_inner_nodes)
+    {
+        int vals[] = { 50, 30, 70, 20, 40, 60, 80, 35 };
+        int_node_t nodes[nelem(vals)];
+        bstree_t tree;
+        bstree_init(&tree, compare, false);
+        for (size_t i = 0; i < nelem(vals); i++) {
+            nodes[i].val = vals[i];
+            bstree_insert(&tree, &(nodes[i].node));
+        }
+        bstree_delete(&tree, &(nodes[3].node));
+        bstree_delete(&tree, &(nodes[1].node));
+        bstree_delete(&tree, &(nodes[0].node));
+        CHECK(tree.root == &(nodes[5].node));
+        CHECK(bstree_size(&tree) == 5);
+        int expect[] = { 35, 40, 60, 70, 80 };
+        size_t i = 0;
+        bstree_foreach(elem, &tree) {
+            int_node_t* node = container_of(elem, int_node_t, node);
+            CHECK(node->val == expect[i++]);
+        }
+        CHECK(i == nelem(expect));
+    }
+
+    TEST(Verify_bstree_prev_walks_the_tree_in_reverse_order)
+    {
+        static int_node_t nodes[NUM_NODES];
+        bstree_t tree;
+        bstree_init_balanced(&tree, compare, true);
+        for (int i = 0; i < NUM_NODES; i++) {
+            nodes[i].val = (NUM_NODES - i) / 2;
+            bstree_insert(&tree, &(nodes[i].node));
+        }
+        int count = 0, last = NUM_NODES;
+        for (bstree_node_t* elem = bstree_last(&tree); elem != NULL; elem = bstree_prev(elem)) {
+            int_node_t* node = container_of(elem, int_node_t, node);
+            CHECK(node->val <= last);
+            last = node->val;
+            count++;
+        }
+        CHECK(count == NUM_NODES);
+    }
 }
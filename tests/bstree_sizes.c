@@ -0,0 +1,93 @@
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#include <stdc.h>
+#define BSTREE_SUBTREE_SIZES
+#include <bstree.h>
+
+typedef struct {
+    bstree_node_t node;
+    int val;
+} int_node_t;
+
+static int compare(bstree_node_t* a, bstree_node_t* b)
+{
+    int_node_t* nodea = container_of(a, int_node_t, node);
+    int_node_t* nodeb = container_of(b, int_node_t, node);
+    return (nodea->val < nodeb->val) ? -1 : (nodea->val > nodeb->val) ? 1 : 0;
+}
+
+/* Return the number of nodes in the subtree, or 0 if any node's size field
+ * disagrees with its children */
+static size_t checked_size(bstree_node_t* node) {
+    if (node == NULL)
+        return 0;
+    size_t left  = checked_size(node->left);
+    size_t right = checked_size(node->right);
+    if ((node->left && !left) || (node->right && !right))
+        return 0;
+    return (node->size == 1 + left + right) ? node->size : 0;
+}
+
+enum { NUM_NODES = 1000 };
+
+//-----------------------------------------------------------------------------
+// Begin Unit Tests
+//-----------------------------------------------------------------------------
+TEST_SUITE(BSTreeSizes) {
+    TEST(Verify_subtree_sizes_survive_balanced_inserts_and_deletes)
+    {
+        static int_node_t nodes[NUM_NODES];
+        bstree_t tree;
+        bstree_init_balanced(&tree, compare, false);
+        for (int i = 0; i < NUM_NODES; i++) {
+            nodes[i].val = (i * 7919) % NUM_NODES;
+            bstree_insert(&tree, &(nodes[i].node));
+            CHECK(checked_size(tree.root) == (size_t)i + 1);
+        }
+        for (int i = 0; i < NUM_NODES; i += 2) {
+            bstree_delete(&tree, &(nodes[i].node));
+            CHECK(checked_size(tree.root) == bstree_size(&tree));
+        }
+        CHECK(bstree_size(&tree) == NUM_NODES / 2);
+    }
+
+    TEST(Verify_bstree_rank_and_select_agree_with_in_order_position)
+    {
+        static int_node_t nodes[NUM_NODES];
+        bstree_t tree;
+        bstree_init_balanced(&tree, compare, false);
+        for (int i = 0; i < NUM_NODES; i++) {
+            nodes[i].val = ((i * 7919) % NUM_NODES) * 2;
+            bstree_insert(&tree, &(nodes[i].node));
+        }
+        for (int i = 0; i < NUM_NODES; i += 3)
+            bstree_delete(&tree, &(nodes[i].node));
+        CHECK(checked_size(tree.root) == bstree_size(&tree));
+        size_t rank = 0;
+        bstree_foreach(elem, &tree) {
+            CHECK(bstree_rank(elem) == rank);
+            CHECK(bstree_select(&tree, rank) == elem);
+            rank++;
+        }
+        CHECK(rank == bstree_size(&tree));
+        CHECK(bstree_select(&tree, rank) == NULL);
+    }
+
+    TEST(Verify_bstree_rank_and_select_work_on_unbalanced_trees)
+    {
+        static int_node_t nodes[NUM_NODES];
+        bstree_t tree;
+        bstree_init(&tree, compare, false);
+        for (int i = 0; i < NUM_NODES; i++) {
+            nodes[i].val = NUM_NODES - i;
+            bstree_insert(&tree, &(nodes[i].node));
+        }
+        bstree_delete(&tree, &(nodes[0].node));
+        CHECK(tree.root->size == NUM_NODES - 1);
+        CHECK(bstree_rank(&(nodes[1].node)) == NUM_NODES - 2);
+        CHECK(bstree_select(&tree, 0) == &(nodes[NUM_NODES - 1].node));
+        CHECK(bstree_select(&tree, NUM_NODES / 2) == &(nodes[NUM_NODES / 2 - 1].node));
+    }
+}
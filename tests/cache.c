@@ -0,0 +1,220 @@
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#include <stdc.h>
+#include <hash.h>
+#include <list.h>
+#include <cache.h>
+
+typedef struct {
+    cache_entry_t cache;
+    uint val;
+    uint evicted;
+} int_node_t;
+
+static unsigned int hash_func(const hash_entry_t* entry)
+{
+    int_node_t* node = container_of(entry, int_node_t, cache.hash);
+    return node->val;
+}
+
+static int compare_func(const hash_entry_t* entry1, const hash_entry_t* entry2)
+{
+    int_node_t* node1 = container_of(entry1, int_node_t, cache.hash);
+    int_node_t* node2 = container_of(entry2, int_node_t, cache.hash);
+    return (node1->val < node2->val) ? -1 : (node1->val > node2->val) ? 1 : 0;
+}
+
+static void evict_func(cache_entry_t* entry, void* arg)
+{
+    int_node_t* node = container_of(entry, int_node_t, cache);
+    node->evicted++;
+    (*(uint*)arg)++;
+}
+
+static bool cached(cache_t* cache, uint val)
+{
+    int_node_t search = { .val = val };
+    return (NULL != cache_peek(cache, &(search.cache)));
+}
+
+static bool touch(cache_t* cache, uint val)
+{
+    int_node_t search = { .val = val };
+    return (NULL != cache_get(cache, &(search.cache)));
+}
+
+//-----------------------------------------------------------------------------
+// Begin Unit Tests
+//-----------------------------------------------------------------------------
+TEST_SUITE(Cache) {
+    //-------------------------------------------------------------------------
+    // cache_get / cache_put
+    //-------------------------------------------------------------------------
+    TEST(Verify cache_get finds put entries and counts hits and misses)
+    {
+        cache_t cache;
+        uint released = 0;
+        int_node_t nodes[3] = { { .val = 1 }, { .val = 2 }, { .val = 3 } };
+        cache_init(&cache, CACHE_LRU, 100, hash_func, compare_func, evict_func, &released);
+        for (uint i = 0; i < 3; i++)
+            CHECK(cache_put(&cache, &(nodes[i].cache), 10));
+        CHECK(3 == cache_size(&cache));
+        CHECK(30 == cache_used(&cache));
+        int_node_t search = { .val = 2 };
+        CHECK(&(nodes[1].cache) == cache_get(&cache, &(search.cache)));
+        search.val = 42;
+        CHECK(NULL == cache_get(&cache, &(search.cache)));
+        CHECK(1 == cache_stats(&cache).hits);
+        CHECK(1 == cache_stats(&cache).misses);
+        CHECK(0 == cache_stats(&cache).evictions);
+        cache_deinit(&cache);
+        CHECK(3 == released);
+    }
+
+    TEST(Verify cache_put replaces an entry with the same key)
+    {
+        cache_t cache;
+        uint released = 0;
+        int_node_t old = { .val = 7 }, new = { .val = 7 };
+        cache_init(&cache, CACHE_LRU, 100, hash_func, compare_func, evict_func, &released);
+        cache_put(&cache, &(old.cache), 40);
+        cache_put(&cache, &(new.cache), 20);
+        CHECK(1 == old.evicted);
+        CHECK(1 == cache_size(&cache));
+        CHECK(20 == cache_used(&cache));
+        CHECK(&(new.cache) == cache_peek(&cache, &(old.cache)));
+        CHECK(0 == cache_stats(&cache).evictions);
+        cache_deinit(&cache);
+    }
+
+    TEST(Verify cache_put rejects entries larger than the budget)
+    {
+        cache_t cache;
+        uint released = 0;
+        int_node_t node = { .val = 1 };
+        cache_init(&cache, CACHE_LRU, 100, hash_func, compare_func, evict_func, &released);
+        CHECK(!cache_put(&cache, &(node.cache), 101));
+        CHECK(1 == node.evicted);
+        CHECK(0 == cache_size(&cache));
+        cache_deinit(&cache);
+    }
+
+    TEST(Verify cache_del hands the entry back)
+    {
+        cache_t cache;
+        uint released = 0;
+        int_node_t node = { .val = 1 };
+        cache_init(&cache, CACHE_CLOCK, 100, hash_func, compare_func, evict_func, &released);
+        cache_put(&cache, &(node.cache), 10);
+        CHECK(cache_del(&cache, &(node.cache)));
+        CHECK(!cache_del(&cache, &(node.cache)));
+        CHECK(1 == node.evicted);
+        CHECK(0 == cache_size(&cache));
+        CHECK(0 == cache_used(&cache));
+        cache_deinit(&cache);
+    }
+
+    //-------------------------------------------------------------------------
+    // Eviction policies
+    //-------------------------------------------------------------------------
+    TEST(Verify LRU evicts the least recently used entries to fit the budget)
+    {
+        cache_t cache;
+        uint released = 0;
+        int_node_t nodes[5];
+        cache_init(&cache, CACHE_LRU, 40, hash_func, compare_func, evict_func, &released);
+        for (uint i = 0; i < 4; i++) {
+            nodes[i] = (int_node_t){ .val = i };
+            cache_put(&cache, &(nodes[i].cache), 10);
+        }
+        CHECK(touch(&cache, 0));
+        nodes[4] = (int_node_t){ .val = 4 };
+        cache_put(&cache, &(nodes[4].cache), 20);
+        CHECK(cached(&cache, 0));
+        CHECK(!cached(&cache, 1));
+        CHECK(!cached(&cache, 2));
+        CHECK(cached(&cache, 3));
+        CHECK(cached(&cache, 4));
+        CHECK(2 == cache_stats(&cache).evictions);
+        CHECK(40 == cache_used(&cache));
+        cache_deinit(&cache);
+    }
+
+    TEST(Verify CLOCK gives referenced entries a second chance)
+    {
+        cache_t cache;
+        uint released = 0;
+        int_node_t nodes[4];
+        cache_init(&cache, CACHE_CLOCK, 3, hash_func, compare_func, evict_func, &released);
+        for (uint i = 0; i < 3; i++) {
+            nodes[i] = (int_node_t){ .val = i };
+            cache_put(&cache, &(nodes[i].cache), 1);
+        }
+        CHECK(touch(&cache, 0));
+        nodes[3] = (int_node_t){ .val = 3 };
+        cache_put(&cache, &(nodes[3].cache), 1);
+        CHECK(cached(&cache, 0));
+        CHECK(!cached(&cache, 1));
+        CHECK(cached(&cache, 2));
+        CHECK(cached(&cache, 3));
+        cache_deinit(&cache);
+    }
+
+    TEST(Verify S3-FIFO keeps a reused working set through a scan)
+    {
+        cache_t cache;
+        uint released = 0;
+        int_node_t* nodes = (int_node_t*)calloc(1100, sizeof(int_node_t));
+        cache_init(&cache, CACHE_S3FIFO, 100, hash_func, compare_func, evict_func, &released);
+        for (uint i = 0; i < 1100; i++)
+            nodes[i].val = i;
+        /* warm up a working set of 50 keys, each used more than once */
+        for (uint round = 0; round < 3; round++) {
+            for (uint i = 0; i < 50; i++) {
+                if (!touch(&cache, i))
+                    cache_put(&cache, &(nodes[i].cache), 1);
+            }
+        }
+        /* then scan 1000 keys that are each used once */
+        for (uint i = 100; i < 1100; i++) {
+            if (!touch(&cache, i))
+                cache_put(&cache, &(nodes[i].cache), 1);
+        }
+        uint kept = 0;
+        for (uint i = 0; i < 50; i++)
+            kept += cached(&cache, i);
+        CHECK(50 == kept);
+        CHECK(cache_used(&cache) <= 100);
+        cache_deinit(&cache);
+        CHECK(1050 == released);
+        free(nodes);
+    }
+
+    TEST(Verify S3-FIFO admits keys remembered by the ghost into the main queue)
+    {
+        cache_t cache;
+        uint released = 0;
+        int_node_t nodes[21];
+        cache_init(&cache, CACHE_S3FIFO, 20, hash_func, compare_func, evict_func, &released);
+        for (uint i = 0; i < 21; i++)
+            nodes[i] = (int_node_t){ .val = i };
+        /* keys 0 and 1 reach the main queue, then key 2 is pushed out of the
+         * small queue by key 20 */
+        for (uint i = 0; i < 2; i++) {
+            cache_put(&cache, &(nodes[i].cache), 1);
+            touch(&cache, i);
+        }
+        for (uint i = 2; i < 20; i++)
+            cache_put(&cache, &(nodes[i].cache), 1);
+        cache_put(&cache, &(nodes[20].cache), 1);
+        CHECK(!cached(&cache, 2));
+        CHECK(1 == nodes[2].evicted);
+        cache_put(&cache, &(nodes[2].cache), 1);
+        CHECK(CACHE_MAIN == nodes[2].cache.queue);
+        CHECK(CACHE_SMALL == nodes[20].cache.queue);
+        CHECK(!cached(&cache, 3));
+        cache_deinit(&cache);
+    }
+}
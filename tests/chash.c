@@ -0,0 +1,250 @@
+#define _POSIX_C_SOURCE 200112L
+
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#include <stdc.h>
+#include <hash.h>
+#include <chash.h>
+
+enum { NUM_THREADS = 8, KEYS_PER_THREAD = 50000, NUM_CHURN = 4096 };
+
+typedef struct {
+    hash_entry_t link;
+    uint val;
+} int_node_t;
+
+typedef struct {
+    chash_t* chash;
+    uint first;
+} worker_t;
+
+static bool Released[NUM_CHURN];
+static atomic_bool Writing;
+
+static unsigned int hash_func(const hash_entry_t* entry)
+{
+    int_node_t* node = container_of(entry, int_node_t, link);
+    return node->val;
+}
+
+static int compare_func(const hash_entry_t* entry1, const hash_entry_t* entry2)
+{
+    int_node_t* node1 = container_of(entry1, int_node_t, link);
+    int_node_t* node2 = container_of(entry2, int_node_t, link);
+    return node1->val - node2->val;
+}
+
+static void delete_func(hash_entry_t* entry)
+{
+    free(container_of(entry, int_node_t, link));
+}
+
+static void release_func(hash_entry_t* entry)
+{
+    int_node_t* node = container_of(entry, int_node_t, link);
+    Released[node->val] = true;
+}
+
+/* Only for comparing identities, as the entry may be released once the
+ * shard lock is dropped */
+static void find_visit(hash_entry_t* entry, void* arg)
+{
+    *(hash_entry_t**)arg = entry;
+}
+
+static hash_entry_t* visit_find(chash_t* chash, hash_entry_t* key)
+{
+    hash_entry_t* found = NULL;
+    chash_visit(chash, key, find_visit, &found);
+    return found;
+}
+
+static void count_visit(hash_entry_t* entry, void* arg)
+{
+    (void)entry;
+    (*(int*)arg)++;
+}
+
+/* Each worker inserts its own range of keys, reading back every one, then
+ * deletes the odd keys in its range */
+static void* worker(void* arg)
+{
+    worker_t* work = (worker_t*)arg;
+    for (uint i = work->first; i < work->first + KEYS_PER_THREAD; i++) {
+        int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+        entry->val = i;
+        chash_set(work->chash, &(entry->link));
+        int_node_t search = { .val = i };
+        if (visit_find(work->chash, &(search.link)) != &(entry->link))
+            return arg;
+    }
+    for (uint i = work->first + 1; i < work->first + KEYS_PER_THREAD; i += 2) {
+        int_node_t search = { .val = i };
+        if (!chash_del(work->chash, &(search.link)))
+            return arg;
+    }
+    return NULL;
+}
+
+/* Each churner inserts and deletes its own range of keys over and over,
+ * growing the shards underneath the readers */
+static void* churner(void* arg)
+{
+    worker_t* work = (worker_t*)arg;
+    for (int round = 0; round < 4; round++) {
+        for (uint i = work->first; i < work->first + KEYS_PER_THREAD; i++) {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = i;
+            chash_set(work->chash, &(entry->link));
+        }
+        for (uint i = work->first; i < work->first + KEYS_PER_THREAD; i++) {
+            int_node_t search = { .val = i };
+            chash_del(work->chash, &(search.link));
+        }
+    }
+    return NULL;
+}
+
+/* Readers look up keys that are never removed without taking any locks */
+static void* finder(void* arg)
+{
+    worker_t* work = (worker_t*)arg;
+    chash_reader_t* reader = chash_reader(work->chash);
+    while (atomic_load(&Writing)) {
+        for (uint i = 0; i < NUM_CHURN; i++) {
+            int_node_t search = { .val = i };
+            chash_read_enter(work->chash, reader);
+            hash_entry_t* found = chash_find(work->chash, &(search.link));
+            int_node_t* node = (found ? container_of(found, int_node_t, link) : NULL);
+            bool ok = (node != NULL && node->val == i);
+            chash_read_exit(reader);
+            if (!ok)
+                return arg;
+        }
+    }
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Begin Unit Tests
+//-----------------------------------------------------------------------------
+TEST_SUITE(CHash) {
+    TEST(Verify chash_init rounds the shard count up to a power of two)
+    {
+        chash_t chash;
+        chash_init(&chash, 5, hash_func, compare_func, delete_func);
+        CHECK(8 == chash.nshards);
+        CHECK(0 == chash_size(&chash));
+        chash_deinit(&chash);
+    }
+
+    TEST(Verify chash inserts lookups visits and deletions)
+    {
+        chash_t chash;
+        chash_init(&chash, 0, hash_func, compare_func, delete_func);
+        for (uint i = 0; i < 100000; i++) {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = i;
+            chash_set(&chash, &(entry->link));
+            CHECK(&(entry->link) == visit_find(&chash, &(entry->link)));
+        }
+        CHECK(100000 == chash_size(&chash));
+        int visits = 0;
+        int_node_t search = { .val = 42 };
+        CHECK(chash_visit(&chash, &(search.link), count_visit, &visits));
+        CHECK(1 == visits);
+        CHECK(chash_del(&chash, &(search.link)));
+        CHECK(!chash_visit(&chash, &(search.link), count_visit, &visits));
+        CHECK(1 == visits);
+        CHECK(99999 == chash_size(&chash));
+        chash_deinit(&chash);
+    }
+
+    TEST(Verify chash handles concurrent writers and readers)
+    {
+        chash_t chash;
+        pthread_t threads[NUM_THREADS];
+        worker_t work[NUM_THREADS];
+        chash_init(&chash, 16, hash_func, compare_func, delete_func);
+        for (uint i = 0; i < NUM_THREADS; i++) {
+            work[i].chash = &chash;
+            work[i].first = i * KEYS_PER_THREAD;
+            CHECK(0 == pthread_create(&threads[i], NULL, worker, &work[i]));
+        }
+        for (uint i = 0; i < NUM_THREADS; i++) {
+            void* result = &work[i];
+            pthread_join(threads[i], &result);
+            CHECK(result == NULL);
+        }
+        CHECK((NUM_THREADS * KEYS_PER_THREAD)/2 == chash_size(&chash));
+        for (uint i = 0; i < NUM_THREADS * KEYS_PER_THREAD; i++) {
+            int_node_t search = { .val = i };
+            CHECK((visit_find(&chash, &(search.link)) != NULL) == ((i % 2) == 0));
+        }
+        chash_deinit(&chash);
+    }
+
+    TEST(Verify chash_find keeps removed entries alive until the read section ends)
+    {
+        chash_t chash;
+        int_node_t* nodes = (int_node_t*)malloc(NUM_CHURN * sizeof(int_node_t));
+        memset(Released, 0, sizeof(Released));
+        chash_init(&chash, 1, hash_func, compare_func, release_func);
+        chash_reader_t* reader = chash_reader(&chash);
+        for (uint i = 0; i < NUM_CHURN; i++) {
+            nodes[i].val = i;
+            chash_set(&chash, &(nodes[i].link));
+        }
+        chash_read_enter(&chash, reader);
+        CHECK(&(nodes[0].link) == chash_find(&chash, &(nodes[0].link)));
+        for (uint i = 0; i < NUM_CHURN; i++)
+            CHECK(chash_del(&chash, &(nodes[i].link)));
+        CHECK(NULL == chash_find(&chash, &(nodes[0].link)));
+        bool any = false;
+        for (uint i = 0; i < NUM_CHURN; i++)
+            any |= Released[i];
+        CHECK(!any);
+        chash_read_exit(reader);
+        for (uint i = 0; i < NUM_CHURN; i++) {
+            CHECK(!chash_del(&chash, &(nodes[i].link)));
+            chash_set(&chash, &(nodes[i].link));
+            CHECK(chash_del(&chash, &(nodes[i].link)));
+        }
+        CHECK(Released[0]);
+        chash_deinit(&chash);
+        for (uint i = 0; i < NUM_CHURN; i++)
+            CHECK(Released[i]);
+        free(nodes);
+    }
+
+    TEST(Verify chash_find sees every key while other keys churn)
+    {
+        chash_t chash;
+        pthread_t threads[NUM_THREADS];
+        worker_t work[NUM_THREADS];
+        chash_init(&chash, 4, hash_func, compare_func, delete_func);
+        for (uint i = 0; i < NUM_CHURN; i++) {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = i;
+            chash_set(&chash, &(entry->link));
+        }
+        atomic_store(&Writing, true);
+        for (uint i = 0; i < NUM_THREADS; i++) {
+            work[i].chash = &chash;
+            work[i].first = NUM_CHURN + ((i / 2) * KEYS_PER_THREAD);
+            CHECK(0 == pthread_create(&threads[i], NULL, ((i % 2) ? finder : churner), &work[i]));
+        }
+        for (uint i = 0; i < NUM_THREADS; i += 2)
+            pthread_join(threads[i], NULL);
+        atomic_store(&Writing, false);
+        for (uint i = 1; i < NUM_THREADS; i += 2) {
+            void* result = &work[i];
+            pthread_join(threads[i], &result);
+            CHECK(result == NULL);
+        }
+        CHECK(NUM_CHURN == chash_size(&chash));
+        chash_deinit(&chash);
+    }
+}
@@ -0,0 +1,278 @@
+#define _POSIX_C_SOURCE 200112L
+
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#include <stdc.h>
+#include <hash.h>
+#include <fhash.h>
+
+#define IMAGE_PATH "fhash_test.img"
+
+enum { NUM_KEYS = 10000 };
+
+typedef struct {
+    hash_entry_t link;
+    char key[16];
+    uint val;
+} str_node_t;
+
+static unsigned int hash_func(const hash_entry_t* entry)
+{
+    str_node_t* node = container_of(entry, str_node_t, link);
+    return hash_bytes(node->key, strlen(node->key));
+}
+
+static int compare_func(const hash_entry_t* entry1, const hash_entry_t* entry2)
+{
+    str_node_t* node1 = container_of(entry1, str_node_t, link);
+    str_node_t* node2 = container_of(entry2, str_node_t, link);
+    return strcmp(node1->key, node2->key);
+}
+
+static void delete_func(hash_entry_t* entry)
+{
+    (void)entry;
+}
+
+static void key_func(const hash_entry_t* entry, const void** data, size_t* len)
+{
+    str_node_t* node = container_of(entry, str_node_t, link);
+    *data = node->key;
+    *len  = strlen(node->key);
+}
+
+static void val_func(const hash_entry_t* entry, const void** data, size_t* len)
+{
+    str_node_t* node = container_of(entry, str_node_t, link);
+    *data = &(node->val);
+    *len  = sizeof(node->val);
+}
+
+/* Claims a value too long for a slot to record. fhash_write must reject it
+ * before reading any of the bytes. */
+static void huge_val_func(const hash_entry_t* entry, const void** data, size_t* len)
+{
+    str_node_t* node = container_of(entry, str_node_t, link);
+    *data = &(node->val);
+    *len  = (strcmp(node->key, "key-42") == 0) ? ((size_t)UINT32_MAX + 1u) : sizeof(node->val);
+}
+
+static str_node_t* build_table(hash_t* hash, size_t count)
+{
+    str_node_t* nodes = (str_node_t*)calloc(count + 1, sizeof(str_node_t));
+    hash_init(hash, hash_func, compare_func, delete_func);
+    for (size_t i = 0; i < count; i++) {
+        sprintf(nodes[i].key, "key-%u", (uint)i);
+        nodes[i].val = (uint)(i * 7);
+        hash_set(hash, &(nodes[i].link));
+    }
+    return nodes;
+}
+
+static bool check_image(fhash_t* fhash, size_t count)
+{
+    char key[16];
+    const void* val;
+    size_t vallen;
+    bool ok = (fhash_size(fhash) == count);
+    for (size_t i = 0; ok && i < count; i++) {
+        sprintf(key, "key-%u", (uint)i);
+        uint found;
+        ok = fhash_get(fhash, key, strlen(key), &val, &vallen) && (vallen == sizeof(uint));
+        memcpy(&found, val, sizeof(found));
+        ok = ok && (found == (uint)(i * 7));
+    }
+    for (size_t i = count; ok && i < count + 100; i++) {
+        sprintf(key, "key-%u", (uint)i);
+        ok = !fhash_get(fhash, key, strlen(key), NULL, NULL);
+    }
+    return ok;
+}
+
+TEST_SUITE(FHash) {
+    /* Linear Probing Images
+     *************************************************************************/
+    TEST(Verify fhash_write produces an image that finds every key and value)
+    {
+        hash_t hash;
+        fhash_t fhash;
+        str_node_t* nodes = build_table(&hash, NUM_KEYS);
+        CHECK(fhash_write(&hash, IMAGE_PATH, key_func, val_func, 0));
+        CHECK(fhash_open(&fhash, IMAGE_PATH));
+        CHECK(!(fhash.header->flags & FHASH_PERFECT));
+        CHECK(check_image(&fhash, NUM_KEYS));
+        fhash_close(&fhash);
+        hash_deinit(&hash);
+        free(nodes);
+        remove(IMAGE_PATH);
+    }
+
+    TEST(Verify an empty table produces an image with no keys)
+    {
+        hash_t hash;
+        fhash_t fhash;
+        str_node_t* nodes = build_table(&hash, 0);
+        CHECK(fhash_write(&hash, IMAGE_PATH, key_func, val_func, 0));
+        CHECK(fhash_open(&fhash, IMAGE_PATH));
+        CHECK(check_image(&fhash, 0));
+        fhash_close(&fhash);
+        hash_deinit(&hash);
+        free(nodes);
+        remove(IMAGE_PATH);
+    }
+
+    TEST(Verify the image is position independent)
+    {
+        hash_t hash;
+        fhash_t fhash, copy;
+        str_node_t* nodes = build_table(&hash, NUM_KEYS);
+        CHECK(fhash_write(&hash, IMAGE_PATH, key_func, val_func, 0));
+        CHECK(fhash_open(&fhash, IMAGE_PATH));
+        size_t size = fhash.size;
+        void* buf = malloc(size);
+        memcpy(buf, fhash.base, size);
+        fhash_close(&fhash);
+        CHECK(fhash_map(&copy, buf, size));
+        CHECK(check_image(&copy, NUM_KEYS));
+        fhash_close(&copy);
+        free(buf);
+        hash_deinit(&hash);
+        free(nodes);
+        remove(IMAGE_PATH);
+    }
+
+    TEST(Verify fhash_map rejects a corrupt or truncated image)
+    {
+        hash_t hash;
+        fhash_t fhash, copy;
+        str_node_t* nodes = build_table(&hash, 100);
+        CHECK(fhash_write(&hash, IMAGE_PATH, key_func, val_func, 0));
+        CHECK(fhash_open(&fhash, IMAGE_PATH));
+        uint8_t* buf = (uint8_t*)malloc(fhash.size);
+        memcpy(buf, fhash.base, fhash.size);
+        CHECK(!fhash_map(&copy, buf, fhash.size - 1));
+        buf[0] ^= 0xFF;
+        CHECK(!fhash_map(&copy, buf, fhash.size));
+        fhash_close(&fhash);
+        free(buf);
+        hash_deinit(&hash);
+        free(nodes);
+        remove(IMAGE_PATH);
+    }
+
+    TEST(Verify fhash_map rejects slots and displacements outside the image)
+    {
+        hash_t hash;
+        fhash_t fhash, copy;
+        str_node_t* nodes = build_table(&hash, 100);
+        CHECK(fhash_write(&hash, IMAGE_PATH, key_func, val_func, FHASH_PERFECT));
+        CHECK(fhash_open(&fhash, IMAGE_PATH));
+        uint8_t* buf = (uint8_t*)malloc(fhash.size);
+        fhash_header_t* header = (fhash_header_t*)buf;
+        fhash_slot_t* slots = (fhash_slot_t*)(buf + fhash.header->slots_off);
+        uint32_t* disp = (uint32_t*)(buf + fhash.header->disp_off);
+        memcpy(buf, fhash.base, fhash.size);
+        CHECK(fhash_map(&copy, buf, fhash.size));
+        /* a key running past the end of the image */
+        slots[0].keylen = UINT32_MAX;
+        CHECK(!fhash_map(&copy, buf, fhash.size));
+        memcpy(buf, fhash.base, fhash.size);
+        slots[0].offset = UINT64_MAX - 2;
+        CHECK(!fhash_map(&copy, buf, fhash.size));
+        /* a direct slot index past the last slot */
+        memcpy(buf, fhash.base, fhash.size);
+        disp[0] = FHASH_DIRECT | (uint32_t)header->nslots;
+        CHECK(!fhash_map(&copy, buf, fhash.size));
+        /* a slot count whose size overflows */
+        memcpy(buf, fhash.base, fhash.size);
+        header->nslots = UINT64_MAX / 8;
+        CHECK(!fhash_map(&copy, buf, fhash.size));
+        fhash_close(&fhash);
+        free(buf);
+        hash_deinit(&hash);
+        free(nodes);
+        remove(IMAGE_PATH);
+    }
+
+    TEST(Verify fhash_write replaces an image without disturbing its readers)
+    {
+        hash_t hash;
+        fhash_t fhash;
+        str_node_t* nodes = build_table(&hash, 100);
+        CHECK(fhash_write(&hash, IMAGE_PATH, key_func, val_func, 0));
+        CHECK(fhash_open(&fhash, IMAGE_PATH));
+        CHECK(fhash_write(&hash, IMAGE_PATH, key_func, val_func, FHASH_PERFECT));
+        CHECK(check_image(&fhash, 100));
+        CHECK(!(fhash.header->flags & FHASH_PERFECT));
+        CHECK(NULL == fopen(IMAGE_PATH ".tmp", "rb"));
+        fhash_close(&fhash);
+        CHECK(fhash_open(&fhash, IMAGE_PATH));
+        CHECK(fhash.header->flags & FHASH_PERFECT);
+        CHECK(check_image(&fhash, 100));
+        fhash_close(&fhash);
+        hash_deinit(&hash);
+        free(nodes);
+        remove(IMAGE_PATH);
+    }
+
+#if SIZE_MAX > UINT32_MAX
+    TEST(Verify fhash_write rejects data too long for a slot and leaves the old image)
+    {
+        hash_t hash;
+        fhash_t fhash;
+        str_node_t* nodes = build_table(&hash, 100);
+        CHECK(fhash_write(&hash, IMAGE_PATH, key_func, val_func, 0));
+        CHECK(!fhash_write(&hash, IMAGE_PATH, key_func, huge_val_func, 0));
+        CHECK(NULL == fopen(IMAGE_PATH ".tmp", "rb"));
+        CHECK(fhash_open(&fhash, IMAGE_PATH));
+        CHECK(check_image(&fhash, 100));
+        fhash_close(&fhash);
+        hash_deinit(&hash);
+        free(nodes);
+        remove(IMAGE_PATH);
+    }
+#endif
+
+    TEST(Verify fhash_open fails for a missing file)
+    {
+        fhash_t fhash;
+        remove(IMAGE_PATH);
+        CHECK(!fhash_open(&fhash, IMAGE_PATH));
+    }
+
+    /* Minimal Perfect Hash Images
+     *************************************************************************/
+    TEST(Verify FHASH_PERFECT produces an image with one slot per key)
+    {
+        hash_t hash;
+        fhash_t fhash;
+        str_node_t* nodes = build_table(&hash, NUM_KEYS);
+        CHECK(fhash_write(&hash, IMAGE_PATH, key_func, val_func, FHASH_PERFECT));
+        CHECK(fhash_open(&fhash, IMAGE_PATH));
+        CHECK(fhash.header->flags & FHASH_PERFECT);
+        CHECK(fhash.header->nslots == NUM_KEYS);
+        CHECK(check_image(&fhash, NUM_KEYS));
+        fhash_close(&fhash);
+        hash_deinit(&hash);
+        free(nodes);
+        remove(IMAGE_PATH);
+    }
+
+    TEST(Verify FHASH_PERFECT handles small and empty tables)
+    {
+        hash_t hash;
+        fhash_t fhash;
+        for (size_t count = 0; count < 20; count++) {
+            str_node_t* nodes = build_table(&hash, count);
+            CHECK(fhash_write(&hash, IMAGE_PATH, key_func, val_func, FHASH_PERFECT));
+            CHECK(fhash_open(&fhash, IMAGE_PATH));
+            CHECK(check_image(&fhash, count));
+            fhash_close(&fhash);
+            hash_deinit(&hash);
+            free(nodes);
+        }
+        remove(IMAGE_PATH);
+    }
+}
@@ -30,6 +30,51 @@ static void delete_func(hash_entry_t* entry)
     free(container_of(entry, int_node_t, link));
 }
 
+/* Fixed generator so the distribution tests do not depend on the seed */
+static uint64_t next_rand(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return (*state = x);
+}
+
+static int cmp_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+/* Flip every input bit of a batch of random keys and return the worst bias,
+ * over all pairs of input and output bits, away from a 50% flip rate */
+static double avalanche_bias(size_t len, size_t nkeys)
+{
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    uint32_t* flips = (uint32_t*)calloc(len * 8 * 64, sizeof(uint32_t));
+    uint8_t key[64];
+    for (size_t k = 0; k < nkeys; k++) {
+        for (size_t i = 0; i < len; i++)
+            key[i] = (uint8_t)next_rand(&state);
+        uint64_t base = hash_bytes64(key, len, 0);
+        for (size_t bit = 0; bit < len * 8; bit++) {
+            key[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+            uint64_t diff = base ^ hash_bytes64(key, len, 0);
+            key[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+            for (size_t out = 0; out < 64; out++)
+                flips[(bit * 64) + out] += (uint32_t)((diff >> out) & 1u);
+        }
+    }
+    double worst = 0.0;
+    for (size_t i = 0; i < len * 8 * 64; i++) {
+        double bias = ((double)flips[i] / (double)nkeys) - 0.5;
+        if (bias < 0) bias = -bias;
+        if (bias > worst) worst = bias;
+    }
+    free(flips);
+    return worst;
+}
+
 //-----------------------------------------------------------------------------
 // Begin Unit Tests
 //-----------------------------------------------------------------------------
@@ -172,4 +217,366 @@ TEST_SUITE(Hash) {
         }
         hash_deinit(&hash);
     }
+
+    TEST(Verify incremental hash inserts lookups and deletions)
+    {
+        hash_t hash;
+        hash_init_flags(&hash, hash_func, compare_func, delete_func, HASH_INCREMENTAL);
+        for (uint i = 0; i < Num_Iterations; i++)
+        {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = i;
+            hash_set(&hash, &(entry->link));
+            CHECK(i+1 == hash_size(&hash));
+            CHECK(&(entry->link) == hash_get(&hash, &(entry->link)));
+            /* Every earlier entry must stay reachable mid-migration */
+            int_node_t search = { .val = i/2 };
+            CHECK(NULL != hash_get(&hash, &(search.link)));
+        }
+        for (uint i = 0; i < Num_Iterations; i += 2)
+        {
+            int_node_t search = { .val = i };
+            CHECK(hash_del(&hash, &(search.link)));
+            CHECK(NULL == hash_get(&hash, &(search.link)));
+        }
+        CHECK((Num_Iterations/2) == hash_size(&hash));
+        hash_deinit(&hash);
+    }
+
+    TEST(Verify incremental hash replaces entries that have not been migrated)
+    {
+        hash_t hash;
+        hash_init_flags(&hash, hash_func, compare_func, delete_func, HASH_INCREMENTAL);
+        /* Fill the table up to the point where the next set starts a rehash */
+        uint count = num_buckets(&hash, 0);
+        for (uint i = 0; i < count; i++)
+        {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = i;
+            hash_set(&hash, &(entry->link));
+        }
+        for (uint i = 0; i < count; i++)
+        {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = i;
+            hash_set(&hash, &(entry->link));
+            CHECK(count == hash_size(&hash));
+            CHECK(&(entry->link) == hash_get(&hash, &(entry->link)));
+        }
+        hash_deinit(&hash);
+    }
+
+    TEST(Verify power of two hash inserts lookups and deletions)
+    {
+        hash_t hash;
+        hash_init_flags(&hash, hash_func, compare_func, delete_func, HASH_POW2);
+        for (uint i = 0; i < Num_Iterations; i++)
+        {
+            /* Strided keys would all collide if the table just masked them */
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = i << 10;
+            hash_set(&hash, &(entry->link));
+            CHECK(i+1 == hash_size(&hash));
+            CHECK(&(entry->link) == hash_get(&hash, &(entry->link)));
+        }
+        CHECK(0 == (num_buckets(&hash, hash.bkt_count) & (num_buckets(&hash, hash.bkt_count) - 1)));
+        for (uint i = 0; i < Num_Iterations; i++)
+        {
+            int_node_t search = { .val = i << 10 };
+            CHECK(hash_del(&hash, &(search.link)));
+        }
+        CHECK(0 == hash_size(&hash));
+        hash_deinit(&hash);
+    }
+
+    TEST(Verify incremental power of two hash inserts and lookups)
+    {
+        hash_t hash;
+        hash_init_flags(&hash, hash_func, compare_func, delete_func, HASH_POW2|HASH_INCREMENTAL);
+        for (uint i = 0; i < Num_Iterations; i++)
+        {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = (uint)rand();
+            hash_set(&hash, &(entry->link));
+            CHECK(&(entry->link) == hash_get(&hash, &(entry->link)));
+        }
+        hash_deinit(&hash);
+    }
+
+    TEST(Verify batched lookups match single lookups)
+    {
+        static const unsigned int flags[] = { 0, HASH_POW2, HASH_INCREMENTAL };
+        enum { NKEYS = 100000, NBATCH = 1000 };
+        for (size_t f = 0; f < nelem(flags); f++)
+        {
+            hash_t hash;
+            hash_init_flags(&hash, hash_func, compare_func, delete_func, flags[f]);
+            for (uint i = 0; i < NKEYS; i++)
+            {
+                int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+                entry->val = i * 2;
+                hash_set(&hash, &(entry->link));
+            }
+            /* Odd keys are never present so about half of the batch misses */
+            int_node_t search[NBATCH];
+            hash_entry_t* entries[NBATCH];
+            hash_entry_t* results[NBATCH];
+            for (uint i = 0; i < NBATCH; i++)
+            {
+                search[i].val = (uint)rand() % (NKEYS * 2);
+                entries[i] = &(search[i].link);
+            }
+            hash_get_batch(&hash, entries, NBATCH - 3, results);
+            for (uint i = 0; i < NBATCH - 3; i++)
+            {
+                CHECK(results[i] == hash_get(&hash, entries[i]));
+                CHECK((results[i] != NULL) == ((search[i].val % 2) == 0));
+            }
+            hash_deinit(&hash);
+        }
+    }
+
+    TEST(Verify hash_reserve presizes the table)
+    {
+        hash_t hash;
+        hash_init(&hash, hash_func, compare_func, delete_func);
+        hash_reserve(&hash, Num_Iterations);
+        size_t bkt_count = hash.bkt_count;
+        CHECK(num_buckets(&hash, bkt_count) >= Num_Iterations);
+        for (uint i = 0; i < Num_Iterations; i++)
+        {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = i;
+            hash_set(&hash, &(entry->link));
+        }
+        CHECK(bkt_count == hash.bkt_count);
+        CHECK(Num_Iterations == hash_size(&hash));
+        /* Reserving less than the current size does nothing */
+        hash_reserve(&hash, 10);
+        CHECK(bkt_count == hash.bkt_count);
+        hash_deinit(&hash);
+    }
+
+    TEST(Verify hash_load bulk loads unique entries)
+    {
+        hash_t hash;
+        hash_init(&hash, hash_func, compare_func, delete_func);
+        hash_entry_t** entries = (hash_entry_t**)malloc(Num_Iterations * sizeof(hash_entry_t*));
+        for (uint i = 0; i < Num_Iterations; i++)
+        {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = i;
+            entries[i] = &(entry->link);
+        }
+        hash_load(&hash, entries, Num_Iterations);
+        CHECK(Num_Iterations == hash_size(&hash));
+        for (uint i = 0; i < Num_Iterations; i++)
+            CHECK(entries[i] == hash_get(&hash, entries[i]));
+        free(entries);
+        hash_deinit(&hash);
+    }
+
+    TEST(Verify hash iteration visits every entry once)
+    {
+        static const unsigned int flags[] = { 0, HASH_POW2, HASH_INCREMENTAL };
+        enum { NKEYS = 100003 };
+        for (size_t f = 0; f < nelem(flags); f++)
+        {
+            hash_t hash;
+            hash_iter_t iter;
+            hash_init_flags(&hash, hash_func, compare_func, delete_func, flags[f]);
+            CHECK(NULL == hash_iter_first(&iter, &hash));
+            for (uint i = 0; i < NKEYS; i++)
+            {
+                int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+                entry->val = i;
+                hash_set(&hash, &(entry->link));
+            }
+            uint8_t* seen = (uint8_t*)calloc(NKEYS, 1);
+            size_t count = 0;
+            hash_foreach(elem, iter, &hash)
+            {
+                int_node_t* node = container_of(elem, int_node_t, link);
+                seen[node->val]++;
+                count++;
+            }
+            CHECK(NKEYS == count);
+            for (uint i = 0; i < NKEYS; i++)
+                CHECK(1 == seen[i]);
+            free(seen);
+            hash_deinit(&hash);
+        }
+    }
+
+    TEST(Verify the current entry may be deleted while iterating)
+    {
+        hash_t hash;
+        hash_iter_t iter;
+        hash_init(&hash, hash_func, compare_func, delete_func);
+        for (uint i = 0; i < 10000; i++)
+        {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = i;
+            hash_set(&hash, &(entry->link));
+        }
+        hash_foreach(elem, iter, &hash)
+        {
+            int_node_t* node = container_of(elem, int_node_t, link);
+            if (node->val % 2)
+                CHECK(hash_del(&hash, elem));
+        }
+        CHECK(5000 == hash_size(&hash));
+        hash_deinit(&hash);
+    }
+
+    //-------------------------------------------------------------------------
+    // hash_bytes
+    //-------------------------------------------------------------------------
+    TEST(Verify hash_bytes64 is deterministic and seeded)
+    {
+        char key[] = "The quick brown fox jumps over the lazy dog";
+        CHECK(hash_bytes64(key, sizeof(key)-1, 0) == hash_bytes64(key, sizeof(key)-1, 0));
+        CHECK(hash_bytes64(key, sizeof(key)-1, 0) != hash_bytes64(key, sizeof(key)-1, 1));
+        CHECK(hash_bytes64(key, sizeof(key)-1, 0) != hash_bytes64(key, sizeof(key)-2, 0));
+        CHECK(hash_bytes64("", 0, 0) != hash_bytes64("", 0, 1));
+    }
+
+    TEST(Verify hash_bytes64 avalanches for short and long keys)
+    {
+        /* Single byte keys are left out as 256 samples are too few to tell
+         * bias from noise */
+        static const size_t lens[] = { 2, 3, 4, 8, 15, 16, 17, 33, 49, 64 };
+        for (size_t i = 0; i < nelem(lens); i++)
+            CHECK(avalanche_bias(lens[i], 2000) < 0.1);
+    }
+
+    TEST(Verify hash_bytes64 has no collisions on small and sequential keys)
+    {
+        size_t count = 65536 + 500000;
+        uint64_t* hashes = (uint64_t*)malloc(count * sizeof(uint64_t));
+        for (uint i = 0; i < 65536; i++) {
+            uint8_t key[2] = { (uint8_t)i, (uint8_t)(i >> 8) };
+            hashes[i] = hash_bytes64(key, 2, 0);
+        }
+        for (uint i = 0; i < 500000; i++) {
+            char key[32];
+            int len = sprintf(key, "key-%u", i);
+            hashes[65536 + i] = hash_bytes64(key, (size_t)len, 0);
+        }
+        qsort(hashes, count, sizeof(uint64_t), cmp_u64);
+        size_t collisions = 0;
+        for (size_t i = 1; i < count; i++)
+            collisions += (hashes[i] == hashes[i-1]);
+        CHECK(collisions == 0);
+        free(hashes);
+    }
+
+    TEST(Verify hash_bytes spreads sequential keys evenly across buckets)
+    {
+        enum { NBUCKETS = 1024, NKEYS = 1024 * 256 };
+        uint* counts = (uint*)calloc(NBUCKETS, sizeof(uint));
+        for (uint i = 0; i < NKEYS; i++) {
+            char key[32];
+            int len = sprintf(key, "symbol_%u", i);
+            counts[hash_bytes(key, (size_t)len) % NBUCKETS]++;
+        }
+        /* Chi-squared with 1023 degrees of freedom has a standard deviation
+         * of about 45, so anything past 1250 indicates real clustering */
+        double expected = (double)NKEYS / NBUCKETS, chisq = 0.0;
+        for (uint i = 0; i < NBUCKETS; i++)
+            chisq += ((counts[i] - expected) * (counts[i] - expected)) / expected;
+        CHECK(chisq < 1250.0);
+        free(counts);
+    }
+
+    //-------------------------------------------------------------------------
+    // rhash_t
+    //-------------------------------------------------------------------------
+    TEST(Verify rhash sequential inserts and lookups)
+    {
+        rhash_t hash;
+        rhash_init(&hash, hash_func, compare_func, delete_func);
+        for (uint i = 0; i < Num_Iterations; i++)
+        {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = i;
+            rhash_set(&hash, &(entry->link));
+            CHECK(i+1 == rhash_size(&hash));
+            CHECK(&(entry->link) == rhash_get(&hash, &(entry->link)));
+        }
+        for (uint i = 0; i < Num_Iterations; i++)
+        {
+            int_node_t search = { .val = i };
+            hash_entry_t* entry = rhash_get(&hash, &(search.link));
+            int_node_t* ientry = container_of(entry, int_node_t, link);
+            CHECK(entry != NULL);
+            CHECK(search.val == ientry->val);
+        }
+        int_node_t missing = { .val = Num_Iterations };
+        CHECK(NULL == rhash_get(&hash, &(missing.link)));
+        rhash_deinit(&hash);
+    }
+
+    TEST(Verify rhash set replaces an existing entry)
+    {
+        rhash_t hash;
+        rhash_init(&hash, hash_func, compare_func, delete_func);
+        int_node_t* entry1 = (int_node_t*)malloc(sizeof(int_node_t));
+        int_node_t* entry2 = (int_node_t*)malloc(sizeof(int_node_t));
+        entry1->val = 42;
+        entry2->val = 42;
+        rhash_set(&hash, &(entry1->link));
+        rhash_set(&hash, &(entry2->link));
+        CHECK(1 == rhash_size(&hash));
+        int_node_t search = { .val = 42 };
+        CHECK(&(entry2->link) == rhash_get(&hash, &(search.link)));
+        rhash_deinit(&hash);
+    }
+
+    TEST(Verify rhash set does not grow a full table when replacing)
+    {
+        rhash_t hash;
+        rhash_init(&hash, hash_func, compare_func, delete_func);
+        uint count = 0;
+        while ((hash.size + 1) * 100u <= hash.capacity * hash.max_load) {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = count++;
+            rhash_set(&hash, &(entry->link));
+        }
+        size_t capacity = hash.capacity;
+        int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+        entry->val = 0;
+        rhash_set(&hash, &(entry->link));
+        CHECK(capacity == hash.capacity);
+        CHECK(count == rhash_size(&hash));
+        CHECK(&(entry->link) == rhash_get(&hash, &(entry->link)));
+        rhash_deinit(&hash);
+    }
+
+    TEST(Verify rhash random inserts and deletions)
+    {
+        rhash_t hash;
+        rhash_init(&hash, hash_func, compare_func, delete_func);
+        for (uint i = 0; i < Num_Iterations; i++)
+        {
+            int_node_t* entry = (int_node_t*)malloc(sizeof(int_node_t));
+            entry->val = (uint)rand() & 0xFFFFF;
+            rhash_set(&hash, &(entry->link));
+            CHECK(&(entry->link) == rhash_get(&hash, &(entry->link)));
+        }
+        for (uint i = 0; i <= 0xFFFFF; i++)
+        {
+            int_node_t search = { .val = i };
+            size_t size = rhash_size(&hash);
+            if (rhash_get(&hash, &(search.link))) {
+                CHECK(rhash_del(&hash, &(search.link)));
+                CHECK(NULL == rhash_get(&hash, &(search.link)));
+                CHECK(size-1 == rhash_size(&hash));
+            } else {
+                CHECK(!rhash_del(&hash, &(search.link)));
+            }
+        }
+        CHECK(0 == rhash_size(&hash));
+        rhash_deinit(&hash);
+    }
 }
@@ -0,0 +1,225 @@
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#include <stdc.h>
+#include <list.h>
+
+/* Check the links run both ways and match the expected order and count */
+static bool list_matches(list_t* list, list_node_t** nodes, size_t count)
+{
+    size_t i = 0;
+    list_node_t* prev = NULL;
+    list_foreach(node, list) {
+        if (i >= count || node != nodes[i] || node->prev != prev)
+            return false;
+        prev = node;
+        i++;
+    }
+    return (i == count) && (list_back(list) == prev) && (list_size(list) == count);
+}
+
+//-----------------------------------------------------------------------------
+// Begin Unit Tests
+//-----------------------------------------------------------------------------
+TEST_SUITE(List) {
+    //-------------------------------------------------------------------------
+    // list_init
+    //-------------------------------------------------------------------------
+    TEST(Verify list_init initializes an empty list)
+    {
+        list_t list;
+        list_init(&list);
+        CHECK(list_empty(&list));
+        CHECK(0 == list_size(&list));
+        CHECK(NULL == list_front(&list));
+        CHECK(NULL == list_back(&list));
+    }
+
+    //-------------------------------------------------------------------------
+    // list_push_front / list_push_back
+    //-------------------------------------------------------------------------
+    TEST(Verify list_push_front links the old head back to the new one)
+    {
+        list_t list;
+        list_node_t a, b, c;
+        list_init(&list);
+        list_push_front(&list, &c);
+        list_push_front(&list, &b);
+        list_push_front(&list, &a);
+        list_node_t* expect[] = { &a, &b, &c };
+        CHECK(list_matches(&list, expect, 3));
+    }
+
+    TEST(Verify list_push_back links the old tail to the new one)
+    {
+        list_t list;
+        list_node_t a, b, c;
+        list_init(&list);
+        list_push_back(&list, &a);
+        list_push_back(&list, &b);
+        list_push_back(&list, &c);
+        list_node_t* expect[] = { &a, &b, &c };
+        CHECK(list_matches(&list, expect, 3));
+        CHECK(!list_node_has_prev(&a));
+        CHECK(list_node_next(&a) == &b);
+        CHECK(list_node_prev(&c) == &b);
+        CHECK(!list_node_has_next(&c));
+    }
+
+    //-------------------------------------------------------------------------
+    // list_pop_front / list_pop_back
+    //-------------------------------------------------------------------------
+    TEST(Verify list_pop_front and list_pop_back unlink the ends)
+    {
+        list_t list;
+        list_node_t a, b, c;
+        list_init(&list);
+        CHECK(NULL == list_pop_front(&list));
+        CHECK(NULL == list_pop_back(&list));
+        list_push_back(&list, &a);
+        list_push_back(&list, &b);
+        list_push_back(&list, &c);
+        CHECK(&a == list_pop_front(&list));
+        CHECK(a.next == NULL && a.prev == NULL);
+        CHECK(&c == list_pop_back(&list));
+        CHECK(c.next == NULL && c.prev == NULL);
+        list_node_t* expect[] = { &b };
+        CHECK(list_matches(&list, expect, 1));
+        CHECK(&b == list_pop_back(&list));
+        CHECK(list_empty(&list));
+        CHECK(NULL == list_back(&list));
+        CHECK(0 == list_size(&list));
+    }
+
+    //-------------------------------------------------------------------------
+    // list_insert_before / list_insert_after / list_remove
+    //-------------------------------------------------------------------------
+    TEST(Verify list_insert_before and list_insert_after link in place)
+    {
+        list_t list;
+        list_node_t a, b, c, d;
+        list_init(&list);
+        list_push_back(&list, &b);
+        list_insert_before(&list, &b, &a);
+        list_insert_after(&list, &b, &d);
+        list_insert_before(&list, &d, &c);
+        list_node_t* expect[] = { &a, &b, &c, &d };
+        CHECK(list_matches(&list, expect, 4));
+    }
+
+    TEST(Verify list_remove unlinks nodes from anywhere in the list)
+    {
+        list_t list;
+        list_node_t a, b, c, d;
+        list_init(&list);
+        list_push_back(&list, &a);
+        list_push_back(&list, &b);
+        list_push_back(&list, &c);
+        list_push_back(&list, &d);
+        list_remove(&list, &b);
+        CHECK(b.next == NULL && b.prev == NULL);
+        list_node_t* expect1[] = { &a, &c, &d };
+        CHECK(list_matches(&list, expect1, 3));
+        list_remove(&list, &a);
+        list_remove(&list, &d);
+        list_node_t* expect2[] = { &c };
+        CHECK(list_matches(&list, expect2, 1));
+        list_remove(&list, &c);
+        CHECK(list_empty(&list));
+        CHECK(NULL == list_back(&list));
+    }
+
+    //-------------------------------------------------------------------------
+    // list_move_front / list_move_back
+    //-------------------------------------------------------------------------
+    TEST(Verify list_move_front and list_move_back reorder nodes)
+    {
+        list_t list;
+        list_node_t a, b, c;
+        list_init(&list);
+        list_push_back(&list, &a);
+        list_push_back(&list, &b);
+        list_push_back(&list, &c);
+        list_move_front(&list, &b);
+        list_node_t* expect1[] = { &b, &a, &c };
+        CHECK(list_matches(&list, expect1, 3));
+        list_move_front(&list, &b);
+        CHECK(list_matches(&list, expect1, 3));
+        list_move_back(&list, &b);
+        list_node_t* expect2[] = { &a, &c, &b };
+        CHECK(list_matches(&list, expect2, 3));
+    }
+
+    //-------------------------------------------------------------------------
+    // list_splice / list_append
+    //-------------------------------------------------------------------------
+    TEST(Verify list_splice moves a list into the middle of another)
+    {
+        list_t dest, src;
+        list_node_t a, b, c, d;
+        list_init(&dest);
+        list_init(&src);
+        list_push_back(&dest, &a);
+        list_push_back(&dest, &d);
+        list_splice(&dest, &d, &src);
+        list_push_back(&src, &b);
+        list_push_back(&src, &c);
+        list_splice(&dest, &d, &src);
+        CHECK(list_empty(&src));
+        CHECK(0 == list_size(&src));
+        list_node_t* expect[] = { &a, &b, &c, &d };
+        CHECK(list_matches(&dest, expect, 4));
+    }
+
+    TEST(Verify list_splice at the front and list_append at the back)
+    {
+        list_t dest, src;
+        list_node_t a, b, c, d;
+        list_init(&dest);
+        list_init(&src);
+        list_append(&dest, &src);
+        CHECK(list_empty(&dest));
+        list_push_back(&src, &b);
+        list_append(&dest, &src);
+        list_push_back(&src, &a);
+        list_splice(&dest, &b, &src);
+        list_push_back(&src, &c);
+        list_push_back(&src, &d);
+        list_append(&dest, &src);
+        list_node_t* expect[] = { &a, &b, &c, &d };
+        CHECK(list_matches(&dest, expect, 4));
+    }
+
+    //-------------------------------------------------------------------------
+    // list_foreach_safe / list_foreach_reverse
+    //-------------------------------------------------------------------------
+    TEST(Verify list_foreach_safe allows removing the current node)
+    {
+        list_t list;
+        list_node_t nodes[6];
+        list_init(&list);
+        for (size_t i = 0; i < nelem(nodes); i++)
+            list_push_back(&list, &nodes[i]);
+        list_foreach_safe(node, next, &list) {
+            if ((node - nodes) % 2 == 0)
+                list_remove(&list, node);
+        }
+        list_node_t* expect[] = { &nodes[1], &nodes[3], &nodes[5] };
+        CHECK(list_matches(&list, expect, 3));
+    }
+
+    TEST(Verify list_foreach_reverse walks from the tail)
+    {
+        list_t list;
+        list_node_t nodes[4];
+        size_t i = nelem(nodes);
+        bool ordered = true;
+        list_init(&list);
+        for (size_t j = 0; j < nelem(nodes); j++)
+            list_push_back(&list, &nodes[j]);
+        list_foreach_reverse(node, &list)
+            ordered = ordered && (node == &nodes[--i]);
+        CHECK(ordered && i == 0);
+    }
+}
@@ -0,0 +1,282 @@
+#define _POSIX_C_SOURCE 200112L
+
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#include <stdc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <slist.h>
+#include <lockfree.h>
+
+enum { NUM_THREADS = 4, ITEMS_PER_THREAD = 20000 };
+
+typedef struct {
+    slist_node_t link;
+    uint producer;
+    uint seq;
+} item_t;
+
+typedef struct {
+    void* queue;
+    item_t* items;
+    uint producer;
+    atomic_uint* received;
+} worker_t;
+
+static atomic_uint Producers_Done;
+
+static item_t* item_of(slist_node_t* node)
+{
+    return container_of(node, item_t, link);
+}
+
+/* Each worker pops a node and pushes it back, over and over, so the same
+ * nodes keep coming back to the top of the stack */
+static void* stack_worker(void* arg)
+{
+    worker_t* work = (worker_t*)arg;
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        slist_node_t* node = lfstack_pop((lfstack_t*)work->queue);
+        if (node != NULL)
+            lfstack_push((lfstack_t*)work->queue, node);
+    }
+    return NULL;
+}
+
+static void* mpscq_producer(void* arg)
+{
+    worker_t* work = (worker_t*)arg;
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        work->items[i].producer = work->producer;
+        work->items[i].seq      = i;
+        mpscq_push((mpscq_t*)work->queue, &(work->items[i].link));
+    }
+    return NULL;
+}
+
+static void* mpmcq_producer(void* arg)
+{
+    worker_t* work = (worker_t*)arg;
+    for (uint i = 0; i < ITEMS_PER_THREAD; i++) {
+        work->items[i].producer = work->producer;
+        work->items[i].seq      = i;
+        while (!mpmcq_push((mpmcq_t*)work->queue, &(work->items[i].link)))
+            sched_yield();
+    }
+    atomic_fetch_add(&Producers_Done, 1);
+    return NULL;
+}
+
+/* Consumers check that every producer's items arrive in the order they were
+ * pushed and count what they took */
+static void* mpmcq_consumer(void* arg)
+{
+    worker_t* work = (worker_t*)arg;
+    uint last[NUM_THREADS];
+    for (uint i = 0; i < NUM_THREADS; i++)
+        last[i] = 0;
+    while (true) {
+        slist_node_t* node = mpmcq_pop((mpmcq_t*)work->queue);
+        if (node == NULL) {
+            if (atomic_load(&Producers_Done) == NUM_THREADS && mpmcq_pop((mpmcq_t*)work->queue) == NULL)
+                break;
+            sched_yield();
+            continue;
+        }
+        item_t* item = item_of(node);
+        if (item->seq + 1 <= last[item->producer])
+            return arg;
+        last[item->producer] = item->seq + 1;
+        atomic_fetch_add(work->received, 1);
+    }
+    return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Begin Unit Tests
+//-----------------------------------------------------------------------------
+TEST_SUITE(LockFree) {
+    //-------------------------------------------------------------------------
+    // lfstack_t
+    //-------------------------------------------------------------------------
+    TEST(Verify lfstack swaps its top without a lock)
+    {
+        lfstack_t stack;
+        lfstack_init(&stack);
+        CHECK(atomic_is_lock_free(&(stack.top)));
+    }
+
+    TEST(Verify lfstack pops nodes in reverse push order)
+    {
+        lfstack_t stack;
+        item_t items[3];
+        lfstack_init(&stack);
+        CHECK(lfstack_empty(&stack));
+        CHECK(NULL == lfstack_pop(&stack));
+        for (uint i = 0; i < 3; i++)
+            lfstack_push(&stack, &(items[i].link));
+        CHECK(!lfstack_empty(&stack));
+        CHECK(&(items[2].link) == lfstack_pop(&stack));
+        CHECK(NULL == items[2].link.next);
+        CHECK(&(items[1].link) == lfstack_pop(&stack));
+        CHECK(&(items[0].link) == lfstack_pop(&stack));
+        CHECK(NULL == lfstack_pop(&stack));
+        CHECK(lfstack_empty(&stack));
+    }
+
+    TEST(Verify lfstack_pop_all takes the whole chain)
+    {
+        lfstack_t stack;
+        item_t items[3];
+        lfstack_init(&stack);
+        CHECK(NULL == lfstack_pop_all(&stack));
+        items[0].link.next = &(items[1].link);
+        lfstack_push_chain(&stack, &(items[0].link), &(items[1].link));
+        lfstack_push(&stack, &(items[2].link));
+        slist_node_t* chain = lfstack_pop_all(&stack);
+        CHECK(lfstack_empty(&stack));
+        CHECK(chain == &(items[2].link));
+        CHECK(chain->next == &(items[0].link));
+        CHECK(chain->next->next == &(items[1].link));
+        CHECK(chain->next->next->next == NULL);
+    }
+
+    TEST(Verify lfstack keeps every node under concurrent pops and pushes)
+    {
+        lfstack_t stack;
+        item_t items[16];
+        pthread_t threads[NUM_THREADS];
+        worker_t work[NUM_THREADS];
+        lfstack_init(&stack);
+        for (uint i = 0; i < nelem(items); i++)
+            lfstack_push(&stack, &(items[i].link));
+        for (uint i = 0; i < NUM_THREADS; i++) {
+            work[i].queue = &stack;
+            CHECK(0 == pthread_create(&threads[i], NULL, stack_worker, &work[i]));
+        }
+        for (uint i = 0; i < NUM_THREADS; i++)
+            pthread_join(threads[i], NULL);
+        uint count = 0, seen = 0;
+        for (slist_node_t* node = lfstack_pop_all(&stack); node != NULL; node = node->next) {
+            count++;
+            seen |= 1u << (item_of(node) - items);
+        }
+        CHECK(nelem(items) == count);
+        CHECK(0xFFFF == seen);
+    }
+
+    //-------------------------------------------------------------------------
+    // mpscq_t
+    //-------------------------------------------------------------------------
+    TEST(Verify mpscq pops nodes in push order)
+    {
+        mpscq_t queue;
+        item_t items[3];
+        mpscq_init(&queue);
+        CHECK(mpscq_empty(&queue));
+        CHECK(NULL == mpscq_pop(&queue));
+        for (uint i = 0; i < 3; i++)
+            mpscq_push(&queue, &(items[i].link));
+        CHECK(!mpscq_empty(&queue));
+        CHECK(&(items[0].link) == mpscq_pop(&queue));
+        CHECK(&(items[1].link) == mpscq_pop(&queue));
+        mpscq_push(&queue, &(items[0].link));
+        CHECK(&(items[2].link) == mpscq_pop(&queue));
+        CHECK(&(items[0].link) == mpscq_pop(&queue));
+        CHECK(NULL == mpscq_pop(&queue));
+        CHECK(mpscq_empty(&queue));
+    }
+
+    TEST(Verify mpscq delivers every node in per-producer order)
+    {
+        mpscq_t queue;
+        pthread_t threads[NUM_THREADS];
+        worker_t work[NUM_THREADS];
+        uint last[NUM_THREADS] = { 0 };
+        mpscq_init(&queue);
+        for (uint i = 0; i < NUM_THREADS; i++) {
+            work[i].queue    = &queue;
+            work[i].items    = (item_t*)malloc(ITEMS_PER_THREAD * sizeof(item_t));
+            work[i].producer = i;
+            CHECK(0 == pthread_create(&threads[i], NULL, mpscq_producer, &work[i]));
+        }
+        uint received = 0;
+        bool ordered = true;
+        while (received < (NUM_THREADS * ITEMS_PER_THREAD)) {
+            slist_node_t* node = mpscq_pop(&queue);
+            if (node == NULL) {
+                sched_yield();
+                continue;
+            }
+            item_t* item = item_of(node);
+            ordered = ordered && (item->seq == last[item->producer]);
+            last[item->producer] = item->seq + 1;
+            received++;
+        }
+        for (uint i = 0; i < NUM_THREADS; i++) {
+            pthread_join(threads[i], NULL);
+            free(work[i].items);
+        }
+        CHECK(ordered);
+        CHECK(mpscq_empty(&queue));
+    }
+
+    //-------------------------------------------------------------------------
+    // mpmcq_t
+    //-------------------------------------------------------------------------
+    TEST(Verify mpmcq pops nodes in push order and rejects pushes when full)
+    {
+        mpmcq_t queue;
+        item_t items[5];
+        mpmcq_init(&queue, 4);
+        CHECK(4 == mpmcq_capacity(&queue));
+        CHECK(NULL == mpmcq_pop(&queue));
+        for (uint i = 0; i < 4; i++)
+            CHECK(mpmcq_push(&queue, &(items[i].link)));
+        CHECK(!mpmcq_push(&queue, &(items[4].link)));
+        CHECK(&(items[0].link) == mpmcq_pop(&queue));
+        CHECK(mpmcq_push(&queue, &(items[4].link)));
+        for (uint i = 1; i < 5; i++)
+            CHECK(&(items[i].link) == mpmcq_pop(&queue));
+        CHECK(NULL == mpmcq_pop(&queue));
+        mpmcq_deinit(&queue);
+    }
+
+    TEST(Verify mpmcq delivers every node once with several consumers)
+    {
+        mpmcq_t queue;
+        pthread_t producers[NUM_THREADS], consumers[NUM_THREADS];
+        worker_t work[NUM_THREADS], take[NUM_THREADS];
+        atomic_uint received;
+        atomic_init(&received, 0);
+        atomic_store(&Producers_Done, 0);
+        mpmcq_init(&queue, 256);
+        for (uint i = 0; i < NUM_THREADS; i++) {
+            take[i].queue    = &queue;
+            take[i].received = &received;
+            CHECK(0 == pthread_create(&consumers[i], NULL, mpmcq_consumer, &take[i]));
+        }
+        for (uint i = 0; i < NUM_THREADS; i++) {
+            work[i].queue    = &queue;
+            work[i].items    = (item_t*)malloc(ITEMS_PER_THREAD * sizeof(item_t));
+            work[i].producer = i;
+            CHECK(0 == pthread_create(&producers[i], NULL, mpmcq_producer, &work[i]));
+        }
+        for (uint i = 0; i < NUM_THREADS; i++)
+            pthread_join(producers[i], NULL);
+        bool ordered = true;
+        for (uint i = 0; i < NUM_THREADS; i++) {
+            void* result = NULL;
+            pthread_join(consumers[i], &result);
+            ordered = ordered && (result == NULL);
+        }
+        for (uint i = 0; i < NUM_THREADS; i++)
+            free(work[i].items);
+        CHECK(ordered);
+        CHECK((NUM_THREADS * ITEMS_PER_THREAD) == atomic_load(&received));
+        CHECK(NULL == mpmcq_pop(&queue));
+        mpmcq_deinit(&queue);
+    }
+}
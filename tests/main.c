@@ -11,9 +11,22 @@ int main(int argc, char** argv)
     uint seed = (uint)time(NULL);
     srand(seed);
     printf("Random Number Generation Seed: %u\n", seed);
+    RUN_EXTERN_TEST_SUITE(Alloc);
+    RUN_EXTERN_TEST_SUITE(Arena);
+    RUN_EXTERN_TEST_SUITE(Sort);
     RUN_EXTERN_TEST_SUITE(SList);
+    RUN_EXTERN_TEST_SUITE(List);
     RUN_EXTERN_TEST_SUITE(BSTree);
+    RUN_EXTERN_TEST_SUITE(BSTreeSizes);
+    RUN_EXTERN_TEST_SUITE(BPTree);
     RUN_EXTERN_TEST_SUITE(Hash);
+    RUN_EXTERN_TEST_SUITE(CHash);
+    RUN_EXTERN_TEST_SUITE(Cache);
+    RUN_EXTERN_TEST_SUITE(LockFree);
+    RUN_EXTERN_TEST_SUITE(FHash);
+    RUN_EXTERN_TEST_SUITE(Vec);
+    RUN_EXTERN_TEST_SUITE(StrBuf);
+    RUN_EXTERN_TEST_SUITE(Rope);
     RUN_EXTERN_TEST_SUITE(Utf8);
     return (PRINT_TEST_RESULTS());
 }
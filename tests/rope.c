@@ -0,0 +1,159 @@
+#define _POSIX_C_SOURCE 200112L
+
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#include <stdc.h>
+#include <utf8.h>
+#include <slist.h>
+#include <strbuf.h>
+#include <rope.h>
+
+/* Write the rope to a temporary file and read it back as a string. Returns
+ * an empty string if anything fails. */
+static char* write_and_read(rope_t* rope, int flush) {
+    FILE* file = tmpfile();
+    int ret = (flush ? rope_flush(rope, fileno(file)) : rope_write(rope, fileno(file)));
+    long size = (ret == 0 ? (long)lseek(fileno(file), 0, SEEK_END) : 0);
+    char* str = (char*)calloc((size_t)size + 1u, 1u);
+    lseek(fileno(file), 0, SEEK_SET);
+    if ((long)fread(str, 1u, (size_t)size, file) != size)
+        str[0] = '\0';
+    fclose(file);
+    return str;
+}
+
+TEST_SUITE(Rope) {
+    TEST(Verify rope_init creates an empty rope)
+    {
+        rope_t rope;
+        rope_init(&rope, 0);
+        CHECK(rope_empty(&rope));
+        CHECK(rope_size(&rope) == 0);
+        CHECK(rope_front(&rope) == NULL);
+        CHECK(rope.chunk_size == ROPE_CHUNK_SIZE);
+        rope_deinit(&rope);
+    }
+
+    TEST(Verify appends fill chunks in order without moving earlier data)
+    {
+        rope_t rope;
+        rope_init(&rope, 16);
+        rope_add_string(&rope, "0123456789");
+        char* first = rope_chunk_data(rope_front(&rope));
+        rope_add_string(&rope, "abcdefghij");
+        rope_add_char(&rope, '!');
+        CHECK(rope_size(&rope) == 21);
+        CHECK(rope.nchunks == 2);
+        CHECK(rope_chunk_data(rope_front(&rope)) == first);
+        CHECK(rope_front(&rope)->used == 16);
+        char* str = rope_finish(&rope);
+        CHECK(0 == strcmp(str, "0123456789abcdefghij!"));
+        CHECK(rope_empty(&rope));
+        free(str);
+        rope_deinit(&rope);
+    }
+
+    TEST(Verify appends larger than a chunk get a chunk of their own)
+    {
+        rope_t rope;
+        char big[100];
+        memset(big, 'x', sizeof(big));
+        rope_init(&rope, 16);
+        rope_add_char(&rope, '<');
+        rope_add_bytes(&rope, big, sizeof(big));
+        CHECK(rope.nchunks == 2);
+        CHECK(rope.tail->size == 85);
+        CHECK(rope_size(&rope) == 101);
+        rope_deinit(&rope);
+    }
+
+    TEST(Verify rope_printf and number appends)
+    {
+        rope_t rope;
+        rope_init(&rope, 8);
+        rope_printf(&rope, "%s=%d;", "key", 42);
+        rope_printf(&rope, "%s", "a longer string than one chunk;");
+        rope_add_u64(&rope, UINT64_MAX);
+        rope_add_char(&rope, ';');
+        rope_add_i64(&rope, INT64_MIN);
+        rope_add_char(&rope, ';');
+        rope_add_double(&rope, 0.1);
+        rope_add_rune(&rope, 0x00E9);
+        char* str = rope_finish(&rope);
+        CHECK(0 == strcmp(str, "key=42;a longer string than one chunk;18446744073709551615;-9223372036854775808;0.1\xC3\xA9"));
+        free(str);
+        rope_deinit(&rope);
+    }
+
+    TEST(Verify rope_splice moves chunks without copying)
+    {
+        rope_t a, b;
+        rope_init(&a, 8);
+        rope_init(&b, 8);
+        rope_splice(&a, &b);
+        CHECK(rope_empty(&a));
+        rope_add_string(&b, "world");
+        char* data = rope_chunk_data(rope_front(&b));
+        rope_splice(&a, &b);
+        CHECK(rope_empty(&b));
+        CHECK(rope_front(&a) != NULL && rope_chunk_data(rope_front(&a)) == data);
+        rope_add_string(&b, "hello ");
+        rope_splice(&b, &a);
+        rope_add_char(&b, '!');
+        CHECK(rope_size(&b) == 12);
+        char* str = rope_finish(&b);
+        CHECK(0 == strcmp(str, "hello world!"));
+        free(str);
+        rope_deinit(&a);
+        rope_deinit(&b);
+    }
+
+    TEST(Verify rope_iovecs describes every non empty chunk)
+    {
+        rope_t rope;
+        struct iovec iov[4];
+        rope_init(&rope, 4);
+        rope_add_string(&rope, "abcd");
+        rope_add_string(&rope, "efgh");
+        rope_add_string(&rope, "ij");
+        rope_reserve(&rope, 4);
+        rope_chunk_t* cursor = rope_front(&rope);
+        size_t count = rope_iovecs(&cursor, iov, 2);
+        CHECK(count == 2);
+        CHECK(iov[0].iov_len == 4 && 0 == memcmp(iov[0].iov_base, "abcd", 4));
+        CHECK(iov[1].iov_len == 4 && 0 == memcmp(iov[1].iov_base, "efgh", 4));
+        count = rope_iovecs(&cursor, iov, 4);
+        CHECK(count == 1);
+        CHECK(iov[0].iov_len == 2 && 0 == memcmp(iov[0].iov_base, "ij", 2));
+        CHECK(cursor == NULL);
+        CHECK(0 == rope_iovecs(&cursor, iov, 4));
+        rope_deinit(&rope);
+    }
+
+    TEST(Verify rope_write writes the whole rope with writev)
+    {
+        rope_t rope;
+        strbuf_t expect;
+        rope_init(&rope, 7);
+        strbuf_reset(&expect);
+        /* More chunks than one writev call takes */
+        for (int i = 0; i < (int)(ROPE_IOV_MAX * 3); i++) {
+            rope_printf(&rope, "%d,", i);
+            strbuf_printf(&expect, "%d,", i);
+        }
+        CHECK(rope.nchunks > ROPE_IOV_MAX);
+        char* str = write_and_read(&rope, 0);
+        CHECK(0 == strcmp(str, strbuf_string(&expect)));
+        CHECK(rope_size(&rope) == expect.index);
+        free(str);
+        str = write_and_read(&rope, 1);
+        CHECK(0 == strcmp(str, strbuf_string(&expect)));
+        CHECK(rope_empty(&rope));
+        CHECK(rope.nchunks == 0);
+        free(str);
+        strbuf_deinit(&expect);
+        rope_deinit(&rope);
+    }
+}
@@ -191,5 +191,86 @@ TEST_SUITE(SList) {
         slist_node_t node = { (slist_node_t*)0x1234 };
         CHECK((slist_node_t*)0x1234 == slist_node_next(&node));
     }
-}
 
+    //-------------------------------------------------------------------------
+    // squeue_t
+    //-------------------------------------------------------------------------
+    TEST(Verify_squeue_init_initializes_an_empty_queue)
+    {
+        squeue_t queue;
+        squeue_init(&queue);
+        CHECK(squeue_empty(&queue));
+        CHECK(0 == squeue_size(&queue));
+        CHECK(NULL == squeue_front(&queue));
+        CHECK(NULL == squeue_back(&queue));
+        CHECK(NULL == squeue_dequeue(&queue));
+        CHECK(NULL == squeue_pop_back(&queue));
+    }
+
+    TEST(Verify_squeue_dequeue_returns_nodes_in_fifo_order)
+    {
+        slist_node_t nodes[4];
+        squeue_t queue;
+        squeue_init(&queue);
+        for (int i = 0; i < 4; i++)
+            squeue_enqueue(&queue, &nodes[i]);
+        CHECK(4 == squeue_size(&queue));
+        CHECK(&nodes[0] == squeue_front(&queue));
+        CHECK(&nodes[3] == squeue_back(&queue));
+        for (int i = 0; i < 4; i++)
+            CHECK(&nodes[i] == squeue_dequeue(&queue));
+        CHECK(squeue_empty(&queue));
+        CHECK(NULL == squeue_back(&queue));
+        squeue_enqueue(&queue, &nodes[2]);
+        CHECK(&nodes[2] == squeue_front(&queue));
+        CHECK(&nodes[2] == squeue_back(&queue));
+    }
+
+    TEST(Verify_squeue_push_front_and_pop_back_maintain_the_tail)
+    {
+        slist_node_t nodes[3];
+        squeue_t queue;
+        squeue_init(&queue);
+        squeue_push_front(&queue, &nodes[1]);
+        squeue_push_front(&queue, &nodes[0]);
+        squeue_push_back(&queue, &nodes[2]);
+        CHECK(&nodes[2] == squeue_pop_back(&queue));
+        CHECK(&nodes[1] == squeue_back(&queue));
+        CHECK(NULL == nodes[1].next);
+        CHECK(&nodes[1] == squeue_pop_back(&queue));
+        CHECK(&nodes[0] == squeue_pop_back(&queue));
+        CHECK(squeue_empty(&queue));
+        CHECK(0 == squeue_size(&queue));
+    }
+
+    TEST(Verify_squeue_append_moves_every_node_of_the_source)
+    {
+        slist_node_t nodes[5];
+        squeue_t queue1, queue2;
+        squeue_init(&queue1);
+        squeue_init(&queue2);
+        squeue_append(&queue1, &queue2);
+        CHECK(squeue_empty(&queue1));
+        squeue_enqueue(&queue2, &nodes[0]);
+        squeue_append(&queue1, &queue2);
+        CHECK(squeue_empty(&queue2));
+        CHECK(&nodes[0] == squeue_back(&queue1));
+        squeue_enqueue(&queue2, &nodes[1]);
+        squeue_enqueue(&queue2, &nodes[2]);
+        squeue_append(&queue1, &queue2);
+        CHECK(3 == squeue_size(&queue1));
+        CHECK(&nodes[2] == squeue_back(&queue1));
+        slist_t list;
+        slist_init(&list);
+        slist_push_front(&list, &nodes[4]);
+        slist_push_front(&list, &nodes[3]);
+        squeue_append_slist(&queue1, &list);
+        CHECK(slist_empty(&list));
+        CHECK(5 == squeue_size(&queue1));
+        CHECK(&nodes[4] == squeue_back(&queue1));
+        int i = 0;
+        squeue_foreach(elem, &queue1)
+            CHECK(elem == &nodes[i++]);
+        CHECK(5 == i);
+    }
+}
@@ -0,0 +1,231 @@
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#define SORT_PARALLEL
+#include <stdc.h>
+#include <vec.h>
+#include <sort.h>
+
+enum { NUM_ELEMS = 100000 };
+
+typedef struct {
+    uint32_t key;
+    uint32_t order;
+} pair_t;
+
+#define LESS_NUM(a, b)  ((a) < (b))
+#define LESS_PAIR(a, b) ((a).key < (b).key)
+
+SORT_DEFINE(u64sort, uint64_t, LESS_NUM)
+SORT_DEFINE(dblsort, double, LESS_NUM)
+SORT_DEFINE(pairsort, pair_t, LESS_PAIR)
+
+static uint64_t next_rand(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return (*state = x);
+}
+
+static int cmp_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static int cmp_i64(const void* a, const void* b)
+{
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static int cmp_i32(const void* a, const void* b)
+{
+    int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static int cmp_dbl(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static int cmp_flt(const void* a, const void* b)
+{
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+/* Fill with one of: random, sorted, reversed, few distinct values, all equal */
+static void fill_u64(uint64_t* data, size_t count, int dist)
+{
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < count; i++) {
+        switch (dist) {
+            case 0:  data[i] = next_rand(&seed);       break;
+            case 1:  data[i] = i;                      break;
+            case 2:  data[i] = count - i;              break;
+            case 3:  data[i] = next_rand(&seed) % 16u; break;
+            default: data[i] = 42;                     break;
+        }
+    }
+}
+
+static bool same_u64(uint64_t* a, uint64_t* b, size_t count)
+{
+    return (0 == memcmp(a, b, count * sizeof(uint64_t)));
+}
+
+TEST_SUITE(Sort) {
+    /* Radix Sorts
+     *************************************************************************/
+    TEST(Verify sort_radix_u64 matches qsort for each distribution)
+    {
+        uint64_t* data = malloc(NUM_ELEMS * sizeof(uint64_t));
+        uint64_t* expect = malloc(NUM_ELEMS * sizeof(uint64_t));
+        for (int dist = 0; dist < 5; dist++) {
+            fill_u64(data, NUM_ELEMS, dist);
+            memcpy(expect, data, NUM_ELEMS * sizeof(uint64_t));
+            qsort(expect, NUM_ELEMS, sizeof(uint64_t), cmp_u64);
+            sort_radix_u64(data, NUM_ELEMS);
+            CHECK(same_u64(data, expect, NUM_ELEMS));
+        }
+        free(expect);
+        free(data);
+    }
+
+    TEST(Verify sort_radix_i64 and sort_radix_i32 order negative keys first)
+    {
+        int64_t data64[1000], expect64[1000];
+        int32_t data32[1000], expect32[1000];
+        uint64_t seed = 1234567;
+        for (int i = 0; i < 1000; i++) {
+            data64[i] = (int64_t)next_rand(&seed);
+            data32[i] = (int32_t)next_rand(&seed);
+        }
+        memcpy(expect64, data64, sizeof(data64));
+        memcpy(expect32, data32, sizeof(data32));
+        qsort(expect64, 1000, sizeof(int64_t), cmp_i64);
+        qsort(expect32, 1000, sizeof(int32_t), cmp_i32);
+        sort_radix_i64(data64, 1000);
+        sort_radix_i32(data32, 1000);
+        CHECK(0 == memcmp(data64, expect64, sizeof(data64)));
+        CHECK(0 == memcmp(data32, expect32, sizeof(data32)));
+    }
+
+    TEST(Verify sort_radix_f64 and sort_radix_f32 order mixed sign values)
+    {
+        double datad[1000], expectd[1000];
+        float dataf[1000], expectf[1000];
+        uint64_t seed = 7654321;
+        for (int i = 0; i < 1000; i++) {
+            datad[i] = ((double)(int64_t)next_rand(&seed)) / 1e9;
+            dataf[i] = (float)(((double)(int64_t)next_rand(&seed)) / 1e15);
+        }
+        datad[0] = 0.0;
+        dataf[0] = 0.0f;
+        memcpy(expectd, datad, sizeof(datad));
+        memcpy(expectf, dataf, sizeof(dataf));
+        qsort(expectd, 1000, sizeof(double), cmp_dbl);
+        qsort(expectf, 1000, sizeof(float), cmp_flt);
+        sort_radix_f64(datad, 1000);
+        sort_radix_f32(dataf, 1000);
+        CHECK(0 == memcmp(datad, expectd, sizeof(datad)));
+        CHECK(0 == memcmp(dataf, expectf, sizeof(dataf)));
+    }
+
+    TEST(Verify radix sorts accept empty and single element inputs)
+    {
+        uint32_t one = 5;
+        sort_radix_u32(NULL, 0);
+        sort_radix_u32(&one, 1);
+        CHECK(one == 5);
+    }
+
+    TEST(Verify vec_sort_u32 sorts a vector of keys)
+    {
+        vec_t vec;
+        vec_init(&vec, sizeof(uint32_t));
+        for (uint32_t i = 0; i < 1000; i++) {
+            uint32_t v = (i * 7919u) % 1000u;
+            vec_push_back(&vec, &v);
+        }
+        vec_sort_u32(&vec);
+        for (uint32_t i = 0; i < 1000; i++)
+            CHECK(*(uint32_t*)vec_at(&vec, i) == i);
+        vec_deinit(&vec);
+    }
+
+    /* Type Specialized Introsort
+     *************************************************************************/
+    TEST(Verify SORT_DEFINE sort matches qsort for each distribution)
+    {
+        uint64_t* data = malloc(NUM_ELEMS * sizeof(uint64_t));
+        uint64_t* expect = malloc(NUM_ELEMS * sizeof(uint64_t));
+        for (int dist = 0; dist < 5; dist++) {
+            fill_u64(data, NUM_ELEMS, dist);
+            memcpy(expect, data, NUM_ELEMS * sizeof(uint64_t));
+            qsort(expect, NUM_ELEMS, sizeof(uint64_t), cmp_u64);
+            u64sort_sort(data, NUM_ELEMS);
+            CHECK(same_u64(data, expect, NUM_ELEMS));
+        }
+        free(expect);
+        free(data);
+    }
+
+    TEST(Verify SORT_DEFINE sort handles every small size)
+    {
+        double data[40];
+        for (size_t count = 0; count < 40; count++) {
+            for (size_t i = 0; i < count; i++)
+                data[i] = (double)((i * 17) % 11) - 5.0;
+            dblsort_sort(data, count);
+            for (size_t i = 1; i < count; i++)
+                CHECK(data[i-1] <= data[i]);
+        }
+    }
+
+    TEST(Verify SORT_DEFINE heapsort fallback sorts)
+    {
+        uint64_t data[1000];
+        fill_u64(data, 1000, 0);
+        u64sort_introsort(data, 1000, 0);
+        for (size_t i = 1; i < 1000; i++)
+            CHECK(data[i-1] <= data[i]);
+    }
+
+    TEST(Verify SORT_DEFINE sort orders structs by key)
+    {
+        pair_t data[1000];
+        uint64_t seed = 99;
+        for (uint32_t i = 0; i < 1000; i++) {
+            data[i].key   = (uint32_t)(next_rand(&seed) % 100u);
+            data[i].order = i;
+        }
+        pairsort_sort(data, 1000);
+        for (size_t i = 1; i < 1000; i++)
+            CHECK(data[i-1].key <= data[i].key);
+    }
+
+    /* Parallel Merge Sort
+     *************************************************************************/
+    TEST(Verify sort_parallel matches qsort for several thread counts)
+    {
+        size_t count = SORT_PARALLEL_MIN * 3 + 7;
+        uint64_t* data = malloc(count * sizeof(uint64_t));
+        uint64_t* expect = malloc(count * sizeof(uint64_t));
+        for (unsigned int threads = 1; threads <= 8; threads++) {
+            fill_u64(data, count, (int)(threads % 4));
+            memcpy(expect, data, count * sizeof(uint64_t));
+            qsort(expect, count, sizeof(uint64_t), cmp_u64);
+            u64sort_sort_parallel(data, count, threads);
+            CHECK(same_u64(data, expect, count));
+        }
+        free(expect);
+        free(data);
+    }
+}
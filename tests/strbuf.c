@@ -0,0 +1,191 @@
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#include <stdc.h>
+#include <utf8.h>
+#include <strbuf.h>
+
+TEST_SUITE(StrBuf) {
+    /* Small Buffer
+     *************************************************************************/
+    TEST(Verify short strings are kept in the inline buffer)
+    {
+        strbuf_t buf;
+        strbuf_reset(&buf);
+        CHECK(strbuf_string(&buf) == NULL);
+        strbuf_add_string(&buf, "hello");
+        CHECK(strbuf_string(&buf) == buf.small);
+        CHECK(0 == strcmp(strbuf_string(&buf), "hello"));
+        strbuf_deinit(&buf);
+    }
+
+    TEST(Verify strings move to the heap once they outgrow the inline buffer)
+    {
+        strbuf_t buf;
+        strbuf_reset(&buf);
+        for (size_t i = 0; i < STRBUF_SMALL_SIZE - 1; i++)
+            strbuf_add_char(&buf, 'a' + (i % 26));
+        CHECK(strbuf_string(&buf) == buf.small);
+        strbuf_add_char(&buf, '!');
+        CHECK(strbuf_string(&buf) != buf.small);
+        CHECK(strlen(strbuf_string(&buf)) == STRBUF_SMALL_SIZE);
+        CHECK(strbuf_string(&buf)[0] == 'a');
+        CHECK(strbuf_string(&buf)[STRBUF_SMALL_SIZE - 1] == '!');
+        strbuf_deinit(&buf);
+    }
+
+    TEST(Verify strbuf_finish copies an inline string to the heap)
+    {
+        strbuf_t buf;
+        strbuf_reset(&buf);
+        strbuf_add_string(&buf, "short");
+        char* str = strbuf_finish(&buf);
+        CHECK(str != buf.small);
+        CHECK(0 == strcmp(str, "short"));
+        CHECK(strbuf_string(&buf) == NULL);
+        free(str);
+    }
+
+    TEST(Verify strbuf_finish hands over a heap string)
+    {
+        strbuf_t buf;
+        strbuf_reset(&buf);
+        for (int i = 0; i < 100; i++)
+            strbuf_add_char(&buf, 'x');
+        char* heap = strbuf_string(&buf);
+        char* str = strbuf_finish(&buf);
+        CHECK(str == heap);
+        CHECK(strlen(str) == 100);
+        free(str);
+    }
+
+    /* Appends
+     *************************************************************************/
+    TEST(Verify strbuf_add_bytes appends exactly len bytes)
+    {
+        strbuf_t buf;
+        strbuf_reset(&buf);
+        strbuf_add_bytes(&buf, "abcdef", 3);
+        strbuf_add_bytes(&buf, "xyz", 0);
+        strbuf_add_bytes(&buf, "0123456789012345678901234567890123456789", 40);
+        CHECK(buf.index == 43);
+        CHECK(0 == strcmp(strbuf_string(&buf), "abc0123456789012345678901234567890123456789"));
+        strbuf_deinit(&buf);
+    }
+
+    TEST(Verify strbuf_reserve makes room up front)
+    {
+        strbuf_t buf;
+        strbuf_reset(&buf);
+        strbuf_add_string(&buf, "ab");
+        strbuf_reserve(&buf, 1000);
+        CHECK(buf.capacity > 1000);
+        CHECK(0 == strcmp(strbuf_string(&buf), "ab"));
+        char* string = strbuf_string(&buf);
+        for (int i = 0; i < 998; i++)
+            strbuf_add_char(&buf, 'c');
+        CHECK(strbuf_string(&buf) == string);
+        strbuf_deinit(&buf);
+    }
+
+    TEST(Verify strbuf_add_rune encodes UTF-8)
+    {
+        strbuf_t buf;
+        strbuf_reset(&buf);
+        strbuf_add_rune(&buf, 'a');
+        strbuf_add_rune(&buf, 0x263A);
+        CHECK(0 == strcmp(strbuf_string(&buf), "a\xE2\x98\xBA"));
+        strbuf_deinit(&buf);
+    }
+
+    TEST(Verify strbuf_cat and strbuf_clear)
+    {
+        strbuf_t a, b;
+        strbuf_reset(&a);
+        strbuf_reset(&b);
+        strbuf_add_string(&a, "foo");
+        strbuf_cat(&a, &b);
+        strbuf_add_string(&b, "bar");
+        strbuf_cat(&a, &b);
+        CHECK(0 == strcmp(strbuf_string(&a), "foobar"));
+        strbuf_clear(&a);
+        CHECK(0 == strcmp(strbuf_string(&a), ""));
+        strbuf_deinit(&a);
+        strbuf_deinit(&b);
+    }
+
+    /* Formatted Appends
+     *************************************************************************/
+    TEST(Verify strbuf_printf formats in place and grows as needed)
+    {
+        strbuf_t buf;
+        strbuf_reset(&buf);
+        strbuf_printf(&buf, "%d-%s", 42, "x");
+        CHECK(0 == strcmp(strbuf_string(&buf), "42-x"));
+        CHECK(strbuf_string(&buf) == buf.small);
+        strbuf_printf(&buf, "|%100d|", 7);
+        CHECK(buf.index == 4 + 102);
+        CHECK(strbuf_string(&buf)[105] == '|');
+        CHECK(strbuf_string(&buf)[104] == '7');
+        CHECK(strlen(strbuf_string(&buf)) == buf.index);
+        strbuf_printf(&buf, "%s", "");
+        CHECK(buf.index == 106);
+        strbuf_deinit(&buf);
+    }
+
+    TEST(Verify strbuf_add_u64 matches printf for every digit count)
+    {
+        strbuf_t buf;
+        char expect[32];
+        uint64_t val = 0;
+        for (int i = 0; i < 22; i++) {
+            strbuf_reset(&buf);
+            strbuf_add_u64(&buf, val);
+            sprintf(expect, "%llu", (unsigned long long)val);
+            CHECK(0 == strcmp(strbuf_string(&buf), expect));
+            strbuf_deinit(&buf);
+            val = (val * 10u) + 9u;
+        }
+        strbuf_reset(&buf);
+        strbuf_add_u64(&buf, UINT64_MAX);
+        CHECK(0 == strcmp(strbuf_string(&buf), "18446744073709551615"));
+        strbuf_deinit(&buf);
+    }
+
+    TEST(Verify strbuf_add_i64 handles negative values and the extremes)
+    {
+        strbuf_t buf;
+        strbuf_reset(&buf);
+        strbuf_add_i64(&buf, -12345);
+        strbuf_add_char(&buf, ' ');
+        strbuf_add_i64(&buf, INT64_MIN);
+        strbuf_add_char(&buf, ' ');
+        strbuf_add_i64(&buf, INT64_MAX);
+        strbuf_add_char(&buf, ' ');
+        strbuf_add_i64(&buf, 0);
+        CHECK(0 == strcmp(strbuf_string(&buf), "-12345 -9223372036854775808 9223372036854775807 0"));
+        strbuf_deinit(&buf);
+    }
+
+    TEST(Verify strbuf_add_double produces short strings that round trip)
+    {
+        strbuf_t buf;
+        double vals[] = { 0.1, 1.0 / 3.0, 123456.789, 1e300, -2.5e-300, 5e-324, 0.0, -42.0, 1e15 };
+        strbuf_reset(&buf);
+        strbuf_add_double(&buf, 0.1);
+        CHECK(0 == strcmp(strbuf_string(&buf), "0.1"));
+        strbuf_deinit(&buf);
+        strbuf_reset(&buf);
+        strbuf_add_double(&buf, -42.0);
+        CHECK(0 == strcmp(strbuf_string(&buf), "-42"));
+        strbuf_deinit(&buf);
+        for (size_t i = 0; i < nelem(vals); i++) {
+            strbuf_reset(&buf);
+            strbuf_add_double(&buf, vals[i]);
+            CHECK(strtod(strbuf_string(&buf), NULL) == vals[i]);
+            CHECK(buf.index <= 24);
+            strbuf_deinit(&buf);
+        }
+    }
+}
@@ -13,6 +13,41 @@ static bool is_rejected(char* seq) {
     return (rune == RUNE_ERR);
 }
 
+/* Decode one rune at a time the way fgetrune does, as the reference for
+ * utf8_decode_buf */
+static size_t decode_each(const char* buf, size_t len, Rune* out) {
+    size_t i = 0, count = 0;
+    while (i < len) {
+        Rune rune = 0;
+        size_t length = 0;
+        while (!utf8decode(&rune, &length, (i < len ? (uint8_t)buf[i++] : EOF)));
+        out[count++] = rune;
+    }
+    return count;
+}
+
+static bool decodes_like_utf8decode(const char* buf, size_t len) {
+    Rune* expect = (Rune*)malloc((len + 1) * sizeof(Rune));
+    Rune* actual = (Rune*)malloc((len + 1) * sizeof(Rune));
+    size_t nexpect = decode_each(buf, len, expect);
+    size_t nactual = utf8_decode_buf(buf, len, actual);
+    bool same = (nexpect == nactual) && (0 == memcmp(expect, actual, nexpect * sizeof(Rune)));
+    free(expect);
+    free(actual);
+    return same;
+}
+
+/* Place seq at offset in a run of ASCII so it lands at different positions
+ * relative to the vector blocks */
+static bool validates_at(const char* seq, size_t offset) {
+    char buf[128];
+    size_t len = strlen(seq);
+    memset(buf, 'a', sizeof(buf));
+    memcpy(buf + offset, seq, len);
+    return utf8_validate(buf, offset + len + 7)
+        && utf8_validate(buf, offset + len);
+}
+
 //-----------------------------------------------------------------------------
 // Begin Unit Tests
 //-----------------------------------------------------------------------------
@@ -61,4 +96,108 @@ TEST_SUITE(Utf8) {
             CHECK(is_rejected((char*)overlong7));
         }
     }
+
+    TEST(Verify utf8_decode_buf round trips the unicode database like utf8decode)
+    {
+        size_t len = 0, count = 0, cap = 4096;
+        char* buf = (char*)malloc(cap);
+        Rune* vals = (Rune*)malloc(cap * sizeof(Rune));
+        FILE* db = fopen("UnicodeData-8.0.0.txt", "r");
+        while (!feof(db)) {
+            char* rec = efreadline(db);
+            if (len + UTF_MAX > cap) {
+                cap *= 2;
+                buf  = (char*)realloc(buf, cap);
+                vals = (Rune*)realloc(vals, cap * sizeof(Rune));
+            }
+            vals[count++] = (Rune)strtoul(rec, NULL, 16);
+            len += utf8encode(buf + len, vals[count-1]);
+            free(rec);
+        }
+        fclose(db);
+        Rune* runes = (Rune*)malloc(len * sizeof(Rune));
+        CHECK(utf8_validate(buf, len));
+        CHECK(count == utf8_decode_buf(buf, len, runes));
+        CHECK(0 == memcmp(vals, runes, count * sizeof(Rune)));
+        CHECK(decodes_like_utf8decode(buf, len));
+        free(runes);
+        free(vals);
+        free(buf);
+    }
+
+    TEST(Verify utf8_decode_buf matches utf8decode on malformed input)
+    {
+        static const char* seqs[] = {
+            "\xC3", "\xC3(", "\x80", "\xBF\xBF", "\xE2\x82", "\xE2\x82(",
+            "\xED\xA0\x80", "\xEF\xBF\xBE", "\xF4\x90\x80\x80", "\xF0\x9F\x98",
+            "\xF8\x88\x80\x80\x80", "\xFC\x84\x80\x80\x80\x80", "\xFE", "\xFF",
+            "\xC0\x80", "\xE0\x80\x80", "\xF0\x80\x80\x80",
+        };
+        for (size_t i = 0; i < nelem(seqs); i++) {
+            char buf[64];
+            size_t len = strlen(seqs[i]);
+            CHECK(decodes_like_utf8decode(seqs[i], len));
+            memset(buf, 'x', sizeof(buf));
+            memcpy(buf + 20, seqs[i], len);
+            CHECK(decodes_like_utf8decode(buf, sizeof(buf)));
+        }
+        for (int round = 0; round < 1000; round++) {
+            char buf[97];
+            for (size_t i = 0; i < sizeof(buf); i++)
+                buf[i] = (char)((rand() & 1) ? (0x80 | rand()) : rand());
+            CHECK(decodes_like_utf8decode(buf, sizeof(buf)));
+        }
+    }
+
+    TEST(Verify utf8_validate accepts well-formed sequences anywhere in the input)
+    {
+        static const char* seqs[] = {
+            "\xC2\x80", "\xDF\xBF", "\xE0\xA0\x80", "\xED\x9F\xBF", "\xEE\x80\x80",
+            "\xEF\xBF\xBF", "\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF",
+        };
+        CHECK(utf8_validate("", 0));
+        for (size_t i = 0; i < nelem(seqs); i++)
+            for (size_t offset = 0; offset < 70; offset++)
+                CHECK(validates_at(seqs[i], offset));
+    }
+
+    TEST(Verify utf8_validate rejects malformed sequences anywhere in the input)
+    {
+        static const char* seqs[] = {
+            "\x80", "\xBF", "\xC0\x80", "\xC1\xBF", "\xC2", "\xC2(", "\xE0\x80\x80",
+            "\xE0\x9F\xBF", "\xE1\x80", "\xED\xA0\x80", "\xED\xBF\xBF", "\xF0\x80\x80\x80",
+            "\xF0\x8F\xBF\xBF", "\xF0\x90\x80", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80",
+            "\xF8\x88\x80\x80\x80", "\xFC\x84\x80\x80\x80\x80", "\xFE", "\xFF",
+            "\xC2\x80\x80", "\xE2\x82\xAC\xAC",
+        };
+        for (size_t i = 0; i < nelem(seqs); i++) {
+            for (size_t offset = 0; offset < 70; offset++) {
+                char buf[128];
+                size_t len = strlen(seqs[i]);
+                memset(buf, 'a', sizeof(buf));
+                memcpy(buf + offset, seqs[i], len);
+                CHECK(!utf8_validate(buf, offset + len));
+                CHECK(!utf8_validate(buf, offset + len + 7));
+            }
+        }
+    }
+
+    TEST(Verify utf8_validate agrees with the scalar check on random input)
+    {
+        static const char* pieces[] = {
+            "a", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\x80", "\xC3",
+            "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xE0\x80\x80",
+        };
+        for (int round = 0; round < 2000; round++) {
+            char buf[256];
+            size_t len = 0;
+            while (len < 200) {
+                /* mostly valid pieces so that errors are rare and isolated */
+                size_t pick = (rand() % 8 == 0 ? (size_t)(rand() % nelem(pieces)) : (size_t)(rand() % 4));
+                memcpy(buf + len, pieces[pick], strlen(pieces[pick]));
+                len += strlen(pieces[pick]);
+            }
+            CHECK(utf8_validate(buf, len) == utf8_validate_scalar((const uint8_t*)buf, len));
+        }
+    }
 }
@@ -0,0 +1,275 @@
+// Unit Test Framework Includes
+#include "atf.h"
+
+// File To Test
+#include <stdc.h>
+#include <vec.h>
+
+typedef struct {
+    int x, y;
+} point_t;
+
+VEC_DEFINE(intvec, int)
+VEC_DEFINE(pointvec, point_t)
+
+static int compare_int(const void* a, const void* b)
+{
+    return *(const int*)a - *(const int*)b;
+}
+
+static bool is_odd(void* elem, void* arg)
+{
+    (void)arg;
+    return (*(int*)elem % 2) != 0;
+}
+
+static bool is_above(void* elem, void* arg)
+{
+    return (*(int*)elem > *(int*)arg);
+}
+
+static void fill_vec(vec_t* vec, int count)
+{
+    vec_init(vec, sizeof(int));
+    for (int i = 0; i < count; i++)
+        vec_push_back(vec, &i);
+}
+
+static bool vec_equals(vec_t* vec, int* expect, size_t count)
+{
+    if (vec_size(vec) != count)
+        return false;
+    for (size_t i = 0; i < count; i++)
+        if (*(int*)vec_at(vec, i) != expect[i])
+            return false;
+    return true;
+}
+
+TEST_SUITE(Vec) {
+    /* Insertion and Erasure
+     *************************************************************************/
+    TEST(Verify vec_insert inserts elements before the index)
+    {
+        vec_t vec;
+        int a = 10, b = 11, c = 12;
+        fill_vec(&vec, 4);
+        CHECK(vec_insert(&vec, 2, 3, &a, &b, &c));
+        CHECK(vec_equals(&vec, (int[]){ 0, 1, 10, 11, 12, 2, 3 }, 7));
+        free(vec.elem_buffer);
+    }
+
+    TEST(Verify vec_insert at the front and back)
+    {
+        vec_t vec;
+        int a = 10, b = 11;
+        fill_vec(&vec, 2);
+        CHECK(vec_insert(&vec, 0, 1, &a));
+        CHECK(vec_insert(&vec, 3, 1, &b));
+        CHECK(vec_equals(&vec, (int[]){ 10, 0, 1, 11 }, 4));
+        free(vec.elem_buffer);
+    }
+
+    TEST(Verify vec_insert fails for an index past the end)
+    {
+        vec_t vec;
+        int a = 10;
+        fill_vec(&vec, 2);
+        CHECK(!vec_insert(&vec, 3, 1, &a));
+        CHECK(vec_equals(&vec, (int[]){ 0, 1 }, 2));
+        free(vec.elem_buffer);
+    }
+
+    TEST(Verify vec_insert_range grows the vector as needed)
+    {
+        vec_t vec;
+        int data[100];
+        for (int i = 0; i < 100; i++)
+            data[i] = 100 + i;
+        fill_vec(&vec, 4);
+        CHECK(vec_insert_range(&vec, 1, data, 100));
+        CHECK(vec_size(&vec) == 104);
+        CHECK(vec_capacity(&vec) >= 104);
+        CHECK(*(int*)vec_at(&vec, 0) == 0);
+        for (int i = 0; i < 100; i++)
+            CHECK(*(int*)vec_at(&vec, i + 1) == 100 + i);
+        CHECK(*(int*)vec_at(&vec, 101) == 1);
+        CHECK(*(int*)vec_at(&vec, 103) == 3);
+        CHECK(!vec_insert_range(&vec, 105, data, 1));
+        free(vec.elem_buffer);
+    }
+
+    TEST(Verify vec_append_range adds elements to the end)
+    {
+        vec_t vec;
+        fill_vec(&vec, 2);
+        vec_append_range(&vec, (int[]){ 5, 6, 7 }, 3);
+        CHECK(vec_equals(&vec, (int[]){ 0, 1, 5, 6, 7 }, 5));
+        free(vec.elem_buffer);
+    }
+
+    TEST(Verify vec_erase removes an inclusive range)
+    {
+        vec_t vec;
+        fill_vec(&vec, 6);
+        CHECK(vec_erase(&vec, 1, 3));
+        CHECK(vec_equals(&vec, (int[]){ 0, 4, 5 }, 3));
+        CHECK(vec_erase(&vec, 2, 2));
+        CHECK(vec_equals(&vec, (int[]){ 0, 4 }, 2));
+        CHECK(vec_erase(&vec, 0, 1));
+        CHECK(vec_empty(&vec));
+        free(vec.elem_buffer);
+    }
+
+    TEST(Verify vec_erase fails for invalid ranges)
+    {
+        vec_t vec;
+        fill_vec(&vec, 4);
+        CHECK(!vec_erase(&vec, 2, 1));
+        CHECK(!vec_erase(&vec, 1, 4));
+        CHECK(vec_equals(&vec, (int[]){ 0, 1, 2, 3 }, 4));
+        free(vec.elem_buffer);
+    }
+
+    TEST(Verify vec_erase_if removes matching elements in order)
+    {
+        vec_t vec;
+        fill_vec(&vec, 8);
+        CHECK(vec_erase_if(&vec, is_odd, NULL) == 4);
+        CHECK(vec_equals(&vec, (int[]){ 0, 2, 4, 6 }, 4));
+        int limit = 2;
+        CHECK(vec_erase_if(&vec, is_above, &limit) == 2);
+        CHECK(vec_equals(&vec, (int[]){ 0, 2 }, 2));
+        limit = 100;
+        CHECK(vec_erase_if(&vec, is_above, &limit) == 0);
+        CHECK(vec_equals(&vec, (int[]){ 0, 2 }, 2));
+        free(vec.elem_buffer);
+    }
+
+    /* Growth Policy
+     *************************************************************************/
+    TEST(Verify vec_push_back only reallocates when capacity is exceeded)
+    {
+        vec_t vec;
+        size_t growths = 0, capacity;
+        vec_init(&vec, sizeof(int));
+        capacity = vec_capacity(&vec);
+        for (int i = 0; i < 100000; i++) {
+            vec_push_back(&vec, &i);
+            if (vec_capacity(&vec) != capacity) {
+                CHECK(vec_capacity(&vec) > capacity);
+                capacity = vec_capacity(&vec);
+                growths++;
+            }
+        }
+        CHECK(growths < 20);
+        CHECK(*(int*)vec_at(&vec, 99999) == 99999);
+        free(vec.elem_buffer);
+    }
+
+    TEST(Verify vec_push_back keeps capacity set by vec_reserve)
+    {
+        vec_t vec;
+        vec_init(&vec, sizeof(int));
+        vec_reserve(&vec, 1000);
+        for (int i = 0; i < 10; i++)
+            vec_push_back(&vec, &i);
+        CHECK(vec_capacity(&vec) == 1000);
+        free(vec.elem_buffer);
+    }
+
+    TEST(Verify vec_emplace_back returns a slot for the new element)
+    {
+        vec_t vec;
+        vec_init(&vec, sizeof(int));
+        for (int i = 0; i < 100; i++)
+            *(int*)vec_emplace_back(&vec) = i * 2;
+        CHECK(vec_size(&vec) == 100);
+        for (int i = 0; i < 100; i++)
+            CHECK(*(int*)vec_at(&vec, i) == i * 2);
+        free(vec.elem_buffer);
+    }
+
+    TEST(Verify VEC_DEFINE emplace_back returns a typed slot)
+    {
+        pointvec_t vec;
+        pointvec_init(&vec);
+        point_t* pt = pointvec_emplace_back(&vec);
+        pt->x = 3;
+        pt->y = 4;
+        CHECK(pointvec_size(&vec) == 1);
+        CHECK(pointvec_at(&vec, 0)->x == 3 && pointvec_at(&vec, 0)->y == 4);
+        pointvec_deinit(&vec);
+    }
+
+    /* Type Specialized Vectors
+     *************************************************************************/
+    TEST(Verify VEC_DEFINE vectors start empty with the default capacity)
+    {
+        intvec_t vec;
+        intvec_init(&vec);
+        CHECK(intvec_empty(&vec));
+        CHECK(intvec_size(&vec) == 0);
+        CHECK(intvec_capacity(&vec) == DEFAULT_VEC_CAPACITY);
+        intvec_deinit(&vec);
+    }
+
+    TEST(Verify VEC_DEFINE push_back and pop_back preserve order)
+    {
+        intvec_t vec;
+        intvec_init(&vec);
+        for (int i = 0; i < 1000; i++)
+            intvec_push_back(&vec, i);
+        CHECK(intvec_size(&vec) == 1000);
+        CHECK(intvec_capacity(&vec) >= 1000);
+        for (int i = 0; i < 1000; i++)
+            CHECK(*intvec_at(&vec, i) == i);
+        for (int i = 999; i >= 0; i--)
+            CHECK(intvec_pop_back(&vec) == i);
+        CHECK(intvec_empty(&vec));
+        intvec_deinit(&vec);
+    }
+
+    TEST(Verify VEC_DEFINE vectors hold structs by value)
+    {
+        pointvec_t vec;
+        pointvec_init(&vec);
+        for (int i = 0; i < 100; i++)
+            pointvec_push_back(&vec, (point_t){ i, -i });
+        pointvec_set(&vec, 50, (point_t){ 7, 8 });
+        CHECK(pointvec_at(&vec, 49)->x == 49 && pointvec_at(&vec, 49)->y == -49);
+        CHECK(pointvec_at(&vec, 50)->x == 7 && pointvec_at(&vec, 50)->y == 8);
+        pointvec_deinit(&vec);
+    }
+
+    TEST(Verify VEC_DEFINE reserve resize and shrink_to_fit)
+    {
+        intvec_t vec;
+        intvec_init(&vec);
+        intvec_reserve(&vec, 100);
+        CHECK(intvec_capacity(&vec) == 100);
+        intvec_resize(&vec, 10, 42);
+        CHECK(intvec_size(&vec) == 10);
+        CHECK(*intvec_at(&vec, 9) == 42);
+        intvec_resize(&vec, 5, 0);
+        CHECK(intvec_size(&vec) == 5);
+        intvec_shrink_to_fit(&vec);
+        CHECK(intvec_capacity(&vec) == 5);
+        intvec_push_back(&vec, 1);
+        CHECK(intvec_size(&vec) == 6);
+        intvec_clear(&vec);
+        CHECK(intvec_empty(&vec));
+        intvec_deinit(&vec);
+    }
+
+    TEST(Verify VEC_DEFINE sort orders the elements)
+    {
+        intvec_t vec;
+        intvec_init(&vec);
+        for (int i = 0; i < 100; i++)
+            intvec_push_back(&vec, (i * 37) % 100);
+        intvec_sort(&vec, compare_int);
+        for (int i = 0; i < 100; i++)
+            CHECK(*intvec_at(&vec, i) == i);
+        intvec_deinit(&vec);
+    }
+}